@@ -60,7 +60,7 @@ int OutputCallback(const void *input, void *output, unsigned long frameCount, co
   PreviewAudioDevice *device = static_cast<PreviewAudioDevice*>(userData);
 
   qint64 max_read = frameCount * device->bytes_per_frame();
-  qint64 read_count = device->read(reinterpret_cast<char*>(output), max_read);
+  qint64 read_count = device->PullSamples(reinterpret_cast<char*>(output), max_read);
   if (read_count < max_read) {
     memset(reinterpret_cast<uint8_t*>(output) + read_count, 0, max_read - read_count);
   }
@@ -92,6 +92,9 @@ bool AudioManager::PushToOutput(const AudioParams &params, const QByteArray &sam
 
     CloseOutputStream();
 
+    // Nothing is pulling from the buffer while the stream is closed
+    output_buffer_->SetParams(output_params_);
+
     PaStreamParameters p = GetPortAudioParams(params, output_device_);
 
     PaError r = Pa_OpenStream(&output_stream_, nullptr, &p, output_params_.sample_rate(), paFramesPerBufferUnspecified, paNoFlag, OutputCallback, output_buffer_);
@@ -101,11 +104,9 @@ bool AudioManager::PushToOutput(const AudioParams &params, const QByteArray &sam
       if (error) *error = Pa_GetErrorText(r);
       return false;
     }
-
-    output_buffer_->set_bytes_per_frame(output_params_.samples_to_bytes(1));
   }
 
-  output_buffer_->write(samples);
+  output_buffer_->PushSamples(samples.constData(), samples.size());
 
   if (!Pa_IsStreamActive(output_stream_)) {
     Pa_StartStream(output_stream_);
@@ -23,6 +23,7 @@
 #include <QDebug>
 #include <QtGlobal>
 
+#include "audiowaveformfile.h"
 #include "config/config.h"
 #include "common/cpuoptimize.h"
 #include "common/functiontimer.h"
@@ -33,13 +34,77 @@ const rational AudioVisualWaveform::kMinimumSampleRate = rational(1, 8);
 const rational AudioVisualWaveform::kMaximumSampleRate = 1024;
 
 AudioVisualWaveform::AudioVisualWaveform() :
-  channels_(0)
+  channels_(0),
+  revision_(0)
 {
   for (rational i=kMinimumSampleRate; i<=kMaximumSampleRate; i*=2) {
     mipmapped_data_.insert({i, Sample()});
   }
 }
 
+void AudioVisualWaveform::SetSource(std::shared_ptr<AudioWaveformFile> source, const rational &offset)
+{
+  revision_++;
+
+  // Sums we had are superseded by the source, no need to keep them in memory
+  for (auto it=mipmapped_data_.begin(); it!=mipmapped_data_.end(); it++) {
+    it->second.clear();
+  }
+
+  source_ = source;
+  source_offset_ = offset;
+
+  if (source_) {
+    channels_ = source_->channel_count();
+    length_ = qMax(rational(0), source_->length() - offset);
+  }
+}
+
+void AudioVisualWaveform::DropSource()
+{
+  if (!source_) {
+    return;
+  }
+
+  // Whatever's about to be written may only cover part of this waveform, so take the source's
+  // sums for all of it into our own mipmaps first
+  std::shared_ptr<AudioWaveformFile> source = source_;
+  source_ = nullptr;
+
+  for (auto it=mipmapped_data_.begin(); it!=mipmapped_data_.end(); it++) {
+    Sample &our_arr = it->second;
+    double rate_dbl = it->first.toDouble();
+
+    rational src_rate;
+    int src_count;
+    const SamplePerChannel *src = source->GetMipmapForScale(rate_dbl, &src_rate, &src_count);
+
+    our_arr.resize(time_to_samples(length_, rate_dbl));
+
+    if (!src || src_rate < it->first) {
+      // Nothing in the source detailed enough for this mipmap, leave it silent
+      continue;
+    }
+
+    // Mipmaps are powers of two so this is always a whole number
+    int chunk_size = qRound(src_rate.toDouble() / rate_dbl);
+    int src_start = time_to_samples(source_offset_, src_rate.toDouble());
+
+    for (int i=0; i<our_arr.size(); i+=channels_) {
+      int src_index = src_start + i * chunk_size;
+      int src_length = qMin(chunk_size * channels_, src_count - src_index);
+
+      if (src_index < 0 || src_length <= 0) {
+        continue;
+      }
+
+      Sample summary = ReSumSamples(&src[src_index], src_length, channels_);
+
+      memcpy(&our_arr.data()[i], summary.constData(), summary.size() * sizeof(SamplePerChannel));
+    }
+  }
+}
+
 void AudioVisualWaveform::OverwriteSamplesFromBuffer(const SampleBuffer &samples, int sample_rate, const rational &start, double target_rate, Sample& data, int &start_index, int &samples_length)
 {
   start_index = time_to_samples(start, target_rate);
@@ -98,6 +163,9 @@ void AudioVisualWaveform::OverwriteSamples(const SampleBuffer &samples, int samp
     return;
   }
 
+  DropSource();
+  revision_++;
+
   // Old less optimized code. Keeping this around as a reference, but the below code is at least
   // 10x faster so this shouldn't be used in production.
   //
@@ -131,6 +199,9 @@ void AudioVisualWaveform::OverwriteSamples(const SampleBuffer &samples, int samp
 
 void AudioVisualWaveform::OverwriteSums(const AudioVisualWaveform &sums, const rational &dest, const rational& offset, const rational& length)
 {
+  revision_++;
+  DropSource();
+
   for (auto it=mipmapped_data_.begin(); it!=mipmapped_data_.end(); it++) {
     rational rate = it->first;
 
@@ -173,6 +244,9 @@ void AudioVisualWaveform::OverwriteSums(const AudioVisualWaveform &sums, const r
 
 void AudioVisualWaveform::OverwriteSilence(const rational &start, const rational &length)
 {
+  revision_++;
+  DropSource();
+
   for (auto it=mipmapped_data_.begin(); it!=mipmapped_data_.end(); it++) {
     rational rate = it->first;
 
@@ -195,6 +269,9 @@ void AudioVisualWaveform::OverwriteSilence(const rational &start, const rational
 
 void AudioVisualWaveform::Shift(const rational &from, const rational &to)
 {
+  revision_++;
+  DropSource();
+
   for (auto it=mipmapped_data_.begin(); it!=mipmapped_data_.end(); it++) {
     rational rate = it->first;
     double rate_dbl = rate.toDouble();
@@ -225,6 +302,12 @@ void AudioVisualWaveform::Shift(const rational &from, const rational &to)
 
 void AudioVisualWaveform::TrimIn(const rational &length)
 {
+  revision_++;
+
+  if (source_) {
+    source_offset_ += length;
+  }
+
   for (auto it=mipmapped_data_.begin(); it!=mipmapped_data_.end(); it++) {
     rational rate = it->first;
     double rate_dbl = rate.toDouble();
@@ -401,19 +484,40 @@ void AudioVisualWaveform::DrawSample(QPainter *painter, const Sample& sample, in
 
 void AudioVisualWaveform::DrawWaveform(QPainter *painter, const QRect& rect, const double& scale, const AudioVisualWaveform &samples, const rational& start_time)
 {
+  DrawWaveform(painter, rect, scale, samples, start_time, OLIVE_CONFIG("RectifiedWaveforms").toBool());
+}
+
+void AudioVisualWaveform::DrawWaveform(QPainter *painter, const QRect& rect, const double& scale, const AudioVisualWaveform &samples, const rational& start_time, bool rectified)
+{
+  if (samples.source_) {
+    rational rate;
+    int count;
+    const SamplePerChannel *arr = samples.source_->GetMipmapForScale(scale, &rate, &count);
+
+    if (arr) {
+      double rate_dbl = rate.toDouble();
+      DrawWaveformInternal(painter, rect, scale, arr, count, samples.channel_count(), rate_dbl,
+                           samples.time_to_samples(start_time + samples.source_offset_, rate_dbl), rectified);
+    }
+    return;
+  }
+
   if (samples.mipmapped_data_.empty()) {
     return;
   }
 
   auto using_mipmap = samples.GetMipmapForScale(scale);
 
-  rational rate = using_mipmap->first;
-  double rate_dbl = rate.toDouble();
+  double rate_dbl = using_mipmap->first.toDouble();
   const Sample& arr = using_mipmap->second;
 
-  int start_sample_index = samples.time_to_samples(start_time, rate_dbl);
+  DrawWaveformInternal(painter, rect, scale, arr.constData(), arr.size(), samples.channel_count(), rate_dbl,
+                       samples.time_to_samples(start_time, rate_dbl), rectified);
+}
 
-  if (start_sample_index >= arr.size()) {
+void AudioVisualWaveform::DrawWaveformInternal(QPainter *painter, const QRect &rect, const double &scale, const SamplePerChannel *arr, int arr_size, int channels, double rate_dbl, int start_sample_index, bool rectified)
+{
+  if (start_sample_index >= arr_size || start_sample_index < 0 || !channels) {
     return;
   }
 
@@ -429,22 +533,20 @@ void AudioVisualWaveform::DrawWaveform(QPainter *painter, const QRect& rect, con
   int start = qMax(rect.x(), -top_left.x());
   int end = qMin(rect.right(), -top_left.x() + viewport.width());
 
-  bool rectified = OLIVE_CONFIG("RectifiedWaveforms").toBool();
-
   for (int i=start;i<end;i++) {
     sample_index = next_sample_index;
 
-    if (sample_index == arr.size()) {
+    if (sample_index == arr_size) {
       break;
     }
 
-    next_sample_index = qMin(arr.size(),
-                             start_sample_index + qFloor(rate_dbl * static_cast<double>(i - rect.x() + 1) / scale) * samples.channel_count());
+    next_sample_index = qMin(arr_size,
+                             start_sample_index + qFloor(rate_dbl * static_cast<double>(i - rect.x() + 1) / scale) * channels);
 
     if (summary_index != sample_index) {
-      summary = AudioVisualWaveform::ReSumSamples(&arr.at(sample_index),
-                                                  qMax(samples.channel_count(), next_sample_index - sample_index),
-                                                  samples.channel_count());
+      summary = AudioVisualWaveform::ReSumSamples(&arr[sample_index],
+                                                  qMax(channels, next_sample_index - sample_index),
+                                                  channels);
       summary_index = sample_index;
     }
 
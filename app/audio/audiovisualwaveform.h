@@ -21,6 +21,7 @@
 #ifndef SUMSAMPLES_H
 #define SUMSAMPLES_H
 
+#include <memory>
 #include <QPainter>
 #include <QVector>
 
@@ -28,6 +29,8 @@
 
 namespace olive {
 
+class AudioWaveformFile;
+
 /**
  * @brief A buffer of data used to store a visual representation of audio
  *
@@ -52,7 +55,20 @@ public:
 
   void set_channel_count(int channels)
   {
-    channels_ = channels;
+    if (channels_ != channels) {
+      channels_ = channels;
+      revision_++;
+    }
+  }
+
+  /**
+   * @brief Incremented every time the contents of this waveform change
+   *
+   * Lets anything caching a drawing of this waveform know when to redraw it.
+   */
+  quint64 revision() const
+  {
+    return revision_;
   }
 
   const rational& length() const
@@ -60,6 +76,19 @@ public:
     return length_;
   }
 
+  /**
+   * @brief Draw this waveform from a range of a waveform file instead of our own sums
+   *
+   * Time `t` in this waveform is read from `offset + t` in `source`. Writing sums or samples into
+   * this waveform afterwards copies the source's sums into this waveform and drops the source.
+   */
+  void SetSource(std::shared_ptr<AudioWaveformFile> source, const rational &offset);
+
+  bool HasSource() const
+  {
+    return source_ != nullptr;
+  }
+
   /**
    * @brief Writes samples into the visual waveform buffer
    *
@@ -105,12 +134,17 @@ public:
   static void DrawSample(QPainter* painter, const Sample &sample, int x, int y, int height, bool rectified);
 
   static void DrawWaveform(QPainter* painter, const QRect &rect, const double &scale, const AudioVisualWaveform& samples, const rational &start_time);
+  static void DrawWaveform(QPainter* painter, const QRect &rect, const double &scale, const AudioVisualWaveform& samples, const rational &start_time, bool rectified);
 
   // Must be a power of 2
   static const rational kMinimumSampleRate;
   static const rational kMaximumSampleRate;
 
 private:
+  static void DrawWaveformInternal(QPainter* painter, const QRect &rect, const double &scale, const SamplePerChannel *arr, int arr_size, int channels, double rate_dbl, int start_sample_index, bool rectified);
+
+  void DropSource();
+
   void OverwriteSamplesFromBuffer(const SampleBuffer &samples, int sample_rate, const rational& start, double target_rate, Sample &data, int &start_index, int &samples_length);
 
   void OverwriteSamplesFromMipmap(const Sample& input, double input_sample_rate, int &input_start, int &input_length, const rational& start, double output_rate, Sample &output_data);
@@ -126,6 +160,14 @@ private:
 
   rational length_;
 
+  std::shared_ptr<AudioWaveformFile> source_;
+
+  rational source_offset_;
+
+  quint64 revision_;
+
+  friend class AudioWaveformFile;
+
 };
 
 }
@@ -0,0 +1,198 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2022 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+#include "audiowaveformfile.h"
+
+#include <QDebug>
+#include <QSaveFile>
+
+namespace olive {
+
+namespace {
+
+// Stored in native byte order, like the conformed PCM these files are generated from
+struct FileHeader {
+  char magic[4];
+  quint32 version;
+  quint32 channels;
+  qint32 length_num;
+  qint32 length_den;
+  quint32 mipmap_count;
+};
+
+struct MipmapHeader {
+  qint32 rate_num;
+  qint32 rate_den;
+  qint64 offset;
+  qint64 count;
+};
+
+}
+
+const char AudioWaveformFile::kMagic[4] = {'O', 'W', 'F', 'M'};
+const quint32 AudioWaveformFile::kVersion = 1;
+QMutex AudioWaveformFile::open_files_lock_;
+QHash<QString, std::weak_ptr<AudioWaveformFile> > AudioWaveformFile::open_files_;
+
+AudioWaveformFile::AudioWaveformFile() :
+  map_(nullptr),
+  channels_(0)
+{
+}
+
+AudioWaveformFile::~AudioWaveformFile()
+{
+  if (map_) {
+    file_.unmap(map_);
+  }
+  file_.close();
+}
+
+bool AudioWaveformFile::Write(const QString &filename, const AudioVisualWaveform &waveform)
+{
+  const std::map<rational, AudioVisualWaveform::Sample> &mipmaps = waveform.mipmapped_data_;
+
+  FileHeader header;
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.channels = waveform.channel_count();
+  header.length_num = waveform.length().numerator();
+  header.length_den = waveform.length().denominator();
+  header.mipmap_count = mipmaps.size();
+
+  // Mipmap data follows the headers, in the same (ascending rate) order
+  QVector<MipmapHeader> mipmap_headers;
+  qint64 offset = sizeof(FileHeader) + sizeof(MipmapHeader) * qint64(mipmaps.size());
+  for (auto it=mipmaps.cbegin(); it!=mipmaps.cend(); it++) {
+    MipmapHeader m;
+    m.rate_num = it->first.numerator();
+    m.rate_den = it->first.denominator();
+    m.offset = offset;
+    m.count = it->second.size();
+    mipmap_headers.append(m);
+
+    offset += m.count * sizeof(AudioVisualWaveform::SamplePerChannel);
+  }
+
+  // Written to a temporary file so a half-written pyramid is never picked up
+  QSaveFile f(filename);
+  if (!f.open(QFile::WriteOnly)) {
+    qWarning() << "Failed to open waveform file for writing:" << filename;
+    return false;
+  }
+
+  f.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
+  f.write(reinterpret_cast<const char*>(mipmap_headers.constData()), sizeof(MipmapHeader) * mipmap_headers.size());
+  for (auto it=mipmaps.cbegin(); it!=mipmaps.cend(); it++) {
+    f.write(reinterpret_cast<const char*>(it->second.constData()), it->second.size() * sizeof(AudioVisualWaveform::SamplePerChannel));
+  }
+
+  return f.commit();
+}
+
+AudioWaveformFilePtr AudioWaveformFile::Get(const QString &filename)
+{
+  QMutexLocker locker(&open_files_lock_);
+
+  AudioWaveformFilePtr file = open_files_.value(filename).lock();
+
+  if (!file) {
+    file = std::make_shared<AudioWaveformFile>();
+
+    if (file->Open(filename)) {
+      open_files_.insert(filename, file);
+    } else {
+      open_files_.remove(filename);
+      file = nullptr;
+    }
+  }
+
+  return file;
+}
+
+const AudioVisualWaveform::SamplePerChannel *AudioWaveformFile::GetMipmapForScale(double scale, rational *rate, int *count) const
+{
+  if (mipmaps_.isEmpty()) {
+    return nullptr;
+  }
+
+  // Same selection as AudioVisualWaveform::GetMipmapForScale
+  const Mipmap *m = &mipmaps_.last();
+  for (int i=0; i<mipmaps_.size(); i++) {
+    if (mipmaps_.at(i).rate.toDouble() >= scale) {
+      m = &mipmaps_.at(i);
+      break;
+    }
+  }
+
+  *rate = m->rate;
+  *count = m->count;
+  return m->data;
+}
+
+bool AudioWaveformFile::Open(const QString &filename)
+{
+  file_.setFileName(filename);
+
+  if (!file_.open(QFile::ReadOnly)) {
+    return false;
+  }
+
+  qint64 file_size = file_.size();
+  if (file_size < qint64(sizeof(FileHeader))) {
+    return false;
+  }
+
+  map_ = file_.map(0, file_size);
+  if (!map_) {
+    return false;
+  }
+
+  const FileHeader *header = reinterpret_cast<const FileHeader*>(map_);
+  if (memcmp(header->magic, kMagic, sizeof(kMagic)) != 0
+      || header->version != kVersion
+      || header->channels == 0
+      || file_size < qint64(sizeof(FileHeader) + sizeof(MipmapHeader) * header->mipmap_count)) {
+    qWarning() << "Invalid waveform file:" << filename;
+    return false;
+  }
+
+  channels_ = header->channels;
+  length_ = rational(header->length_num, header->length_den);
+
+  const MipmapHeader *mipmap_headers = reinterpret_cast<const MipmapHeader*>(map_ + sizeof(FileHeader));
+  mipmaps_.resize(header->mipmap_count);
+  for (int i=0; i<mipmaps_.size(); i++) {
+    const MipmapHeader &m = mipmap_headers[i];
+
+    if (m.offset + m.count * qint64(sizeof(AudioVisualWaveform::SamplePerChannel)) > file_size) {
+      qWarning() << "Truncated waveform file:" << filename;
+      mipmaps_.clear();
+      return false;
+    }
+
+    mipmaps_[i] = {rational(m.rate_num, m.rate_den),
+                   reinterpret_cast<const AudioVisualWaveform::SamplePerChannel*>(map_ + m.offset),
+                   int(m.count)};
+  }
+
+  return true;
+}
+
+}
@@ -0,0 +1,114 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2022 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+#ifndef AUDIOWAVEFORMFILE_H
+#define AUDIOWAVEFORMFILE_H
+
+#include <memory>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QVector>
+
+#include "audiovisualwaveform.h"
+#include "common/define.h"
+
+namespace olive {
+
+class AudioWaveformFile;
+using AudioWaveformFilePtr = std::shared_ptr<AudioWaveformFile>;
+
+/**
+ * @brief A memory-mapped mipmap pyramid of an AudioVisualWaveform stored on disk
+ *
+ * Generated once per conformed footage stream so clips using that stream can draw from it
+ * directly, instead of holding their own copies of the sums in memory and regenerating them
+ * every time the project is opened.
+ */
+class AudioWaveformFile
+{
+public:
+  AudioWaveformFile();
+
+  ~AudioWaveformFile();
+
+  DISABLE_COPY_MOVE(AudioWaveformFile)
+
+  /**
+   * @brief Write all mipmaps of a waveform to a file
+   */
+  static bool Write(const QString &filename, const AudioVisualWaveform &waveform);
+
+  /**
+   * @brief Get a mapped waveform file, shared with anything else already using it
+   *
+   * Returns nullptr if the file doesn't exist or isn't valid. Thread-safe.
+   */
+  static AudioWaveformFilePtr Get(const QString &filename);
+
+  int channel_count() const
+  {
+    return channels_;
+  }
+
+  const rational &length() const
+  {
+    return length_;
+  }
+
+  /**
+   * @brief Get the mipmap to use for drawing at a certain scale
+   *
+   * Returns a pointer to the interleaved per-channel sums of the smallest mipmap whose rate is at
+   * least `scale` (or the largest mipmap), and sets `rate` and `count` (in SamplePerChannel units).
+   */
+  const AudioVisualWaveform::SamplePerChannel *GetMipmapForScale(double scale, rational *rate, int *count) const;
+
+private:
+  bool Open(const QString &filename);
+
+  struct Mipmap {
+    rational rate;
+    const AudioVisualWaveform::SamplePerChannel *data;
+    int count;
+  };
+
+  QFile file_;
+
+  uchar *map_;
+
+  int channels_;
+
+  rational length_;
+
+  QVector<Mipmap> mipmaps_;
+
+  static QMutex open_files_lock_;
+
+  static QHash<QString, std::weak_ptr<AudioWaveformFile> > open_files_;
+
+  static const char kMagic[4];
+
+  static const quint32 kVersion;
+
+};
+
+}
+
+#endif // AUDIOWAVEFORMFILE_H
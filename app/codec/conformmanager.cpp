@@ -16,15 +16,19 @@ ConformManager::Conform ConformManager::GetConformState(const QString &decoder_i
   // Return existing conform if exists
   QVector<QString> filenames = GetConformedFilename(cache_path, stream, params);
   if (AllConformsExist(filenames)) {
-    return {kConformExists, filenames, nullptr};
+    return {kConformExists, filenames, nullptr, TimeRangeList()};
   }
 
   ConformTask *conforming_task = nullptr;
+  QVector<QString> working_filenames;
+  TimeRangeList ready;
 
   foreach (const ConformData &data, conforming_) {
     if (data.stream == stream && data.params == params) {
       // Already creating conform in a task
       conforming_task = data.task;
+      working_filenames = data.working_filename;
+      ready = data.ready;
       break;
     }
   }
@@ -34,47 +38,78 @@ ConformManager::Conform ConformManager::GetConformState(const QString &decoder_i
 
     // We conform to a different filename until it's done to make it clear even across sessions
     // whether this conform is ready or not
-    QVector<QString> working_filenames = filenames;
+    working_filenames = filenames;
     for (int i=0; i<working_filenames.size(); i++) {
       working_filenames[i].append(QStringLiteral(".working"));
     }
 
-    conforming_task = new ConformTask(decoder_id, stream, params, working_filenames);
+    QString finished_waveform = GetWaveformFilename(cache_path, stream, params);
+    QString working_waveform = finished_waveform + QStringLiteral(".working");
+
+    conforming_task = new ConformTask(decoder_id, stream, params, working_filenames, working_waveform);
     connect(conforming_task, &ConformTask::Finished, this, &ConformManager::ConformTaskFinished);
     conforming_task->moveToThread(TaskManager::instance()->thread());
     QMetaObject::invokeMethod(TaskManager::instance(), "AddTask", Qt::QueuedConnection, Q_ARG(Task *, conforming_task));
 
-    conforming_.append({stream, params, conforming_task, working_filenames, filenames});
+    conforming_.append({stream, params, conforming_task, working_filenames, filenames, working_waveform, finished_waveform, TimeRangeList()});
   }
 
   if (wait) {
     do {
       conform_done_condition_.wait(&mutex_);
     } while (!AllConformsExist(filenames));
-    return {kConformExists, filenames, nullptr};
+    return {kConformExists, filenames, nullptr, TimeRangeList()};
   }
 
-  return {kConformGenerating, QVector<QString>(), conforming_task};
+  return {kConformGenerating, working_filenames, conforming_task, ready};
+}
+
+void ConformManager::ConformedRange(ConformTask *task, const TimeRange &range)
+{
+  QMutexLocker locker(&mutex_);
+
+  for (int i=0; i<conforming_.size(); i++) {
+    ConformData &c = conforming_[i];
+    if (c.task == task) {
+      c.ready.insert(range);
+      break;
+    }
+  }
+
+  locker.unlock();
+
+  emit ConformRangeReady(task, range);
 }
 
 QVector<QString> ConformManager::GetConformedFilename(const QString &cache_path, const Decoder::CodecStream &stream, const AudioParams &params)
 {
   QVector<QString> filenames(params.channel_count());
 
+  QString prefix = GetConformedFilenamePrefix(cache_path, stream, params);
+
   for (int i=0; i<filenames.size(); i++) {
-    QString index_fn = QStringLiteral("%1-%2.%3.%4.%5.%6.pcm").arg(FileFunctions::GetUniqueFileIdentifier(stream.filename()),
-                                                                   QString::number(stream.stream()),
-                                                                   QString::number(params.sample_rate()),
-                                                                   QString::number(params.format()),
-                                                                   QString::number(params.channel_layout()),
-                                                                   QString::number(i));
-
-    filenames[i] = QDir(cache_path).filePath(index_fn);
+    filenames[i] = QStringLiteral("%1.%2.pcm").arg(prefix, QString::number(i));
   }
 
   return filenames;
 }
 
+QString ConformManager::GetWaveformFilename(const QString &cache_path, const Decoder::CodecStream &stream, const AudioParams &params)
+{
+  return QStringLiteral("%1.wfm").arg(GetConformedFilenamePrefix(cache_path, stream, params));
+}
+
+QString ConformManager::GetConformedFilenamePrefix(const QString &cache_path, const Decoder::CodecStream &stream, const AudioParams &params)
+{
+  QString index_fn = QStringLiteral("%1-%2.%3.%4.%5").arg(FileFunctions::GetUniqueFileIdentifier(stream.filename()),
+                                                         QString::number(stream.stream()),
+                                                         QString::number(params.sample_rate()),
+                                                         QString::number(params.format()),
+                                                         QString::number(params.channel_layout()));
+
+  return QDir(cache_path).filePath(index_fn);
+}
+
 bool ConformManager::AllConformsExist(const QVector<QString> &filenames)
 {
   foreach (const QString &fn, filenames) {
@@ -112,14 +147,21 @@ void ConformManager::ConformTaskFinished(Task *task, bool succeeded)
       QFile::rename(working, finished);
     }
 
+    // The waveform is optional, clips fall back to generating their own sums without it
+    if (QFileInfo::exists(data.working_waveform)) {
+      QFile::remove(data.finished_waveform);
+      QFile::rename(data.working_waveform, data.finished_waveform);
+    }
+
     conform_done_condition_.wakeAll();
     locker.unlock();
-    emit ConformReady();
+    emit ConformReady(data.task);
   } else {
     // Failed, just delete the working filename if exists
     for (int i=0; i<data.working_filename.size(); i++) {
       QFile::remove(data.working_filename.at(i));
     }
+    QFile::remove(data.working_waveform);
   }
 }
 
@@ -36,10 +36,17 @@ public:
     kConformGenerating
   };
 
+  /**
+   * @brief Conform state
+   *
+   * While generating, `filenames` are the working files and `ready` is the part of the stream that
+   * has already been written to them, so it can be read before the whole conform is done.
+   */
   struct Conform {
     ConformState state;
     QVector<QString> filenames;
     ConformTask *task;
+    TimeRangeList ready;
   };
 
   /**
@@ -49,8 +56,30 @@ public:
    */
   Conform GetConformState(const QString &decoder_id, const QString &cache_path, const Decoder::CodecStream &stream, const AudioParams &params, bool wait);
 
+  /**
+   * @brief Called by a running ConformTask when a range of its output has been written
+   *
+   * Thread-safe.
+   */
+  void ConformedRange(ConformTask *task, const TimeRange &range);
+
+  /**
+   * @brief Get the filename of the waveform generated alongside a conform
+   *
+   * \see AudioWaveformFile
+   */
+  static QString GetWaveformFilename(const QString &cache_path, const Decoder::CodecStream &stream, const AudioParams &params);
+
 signals:
-  void ConformReady();
+  /**
+   * @brief Emitted when a conform has finished entirely
+   */
+  void ConformReady(ConformTask *task);
+
+  /**
+   * @brief Emitted when a range of a conform that's still generating can be read
+   */
+  void ConformRangeReady(ConformTask *task, const olive::TimeRange &range);
 
 private:
   ConformManager() = default;
@@ -67,6 +96,9 @@ private:
     ConformTask *task;
     QVector<QString> working_filename;
     QVector<QString> finished_filename;
+    QString working_waveform;
+    QString finished_waveform;
+    TimeRangeList ready;
   };
 
   QVector<ConformData> conforming_;
@@ -76,6 +108,8 @@ private:
    */
   static QVector<QString> GetConformedFilename(const QString &cache_path, const Decoder::CodecStream &stream, const AudioParams &params);
 
+  static QString GetConformedFilenamePrefix(const QString &cache_path, const Decoder::CodecStream &stream, const AudioParams &params);
+
   static bool AllConformsExist(const QVector<QString> &filenames);
 
 private slots:
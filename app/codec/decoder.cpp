@@ -36,8 +36,11 @@
 namespace olive {
 
 const rational Decoder::kAnyTimecode = RATIONAL_MIN;
+const int64_t Decoder::kSeekRequired = INT64_MAX;
 
-Decoder::Decoder()
+Decoder::Decoder() :
+  conform_next_read_(-1),
+  conform_sequential_(false)
 {
   UpdateLastAccessed();
 }
@@ -86,7 +89,7 @@ bool Decoder::Open(const CodecStream &stream)
   }
 }
 
-TexturePtr Decoder::RetrieveVideo(Renderer *renderer, const rational &timecode, const RetrieveVideoParams &divider, const QAtomicInt *cancelled)
+TexturePtr Decoder::RetrieveVideo(Renderer *renderer, const rational &timecode, const RetrieveVideoParams &divider, const QAtomicInt *cancelled, YUVPlanes *yuv)
 {
   QMutexLocker locker(&mutex_);
 
@@ -106,10 +109,10 @@ TexturePtr Decoder::RetrieveVideo(Renderer *renderer, const rational &timecode,
     return nullptr;
   }
 
-  return RetrieveVideoInternal(renderer, timecode, divider, cancelled);
+  return RetrieveVideoInternal(renderer, timecode, divider, cancelled, yuv);
 }
 
-Decoder::RetrieveAudioStatus Decoder::RetrieveAudio(SampleBuffer &dest, const TimeRange &range, const AudioParams &params, const QString& cache_path, Footage::LoopMode loop_mode, RenderMode::Mode mode)
+Decoder::RetrieveAudioStatus Decoder::RetrieveAudio(SampleBuffer &dest, const TimeRange &range, const AudioParams &params, const QString& cache_path, Footage::LoopMode loop_mode, RenderMode::Mode mode, ConformTask **waiting_for)
 {
   QMutexLocker locker(&mutex_);
 
@@ -127,13 +130,16 @@ Decoder::RetrieveAudioStatus Decoder::RetrieveAudio(SampleBuffer &dest, const Ti
 
   // Get conform state from ConformManager
   ConformManager::Conform conform = ConformManager::instance()->GetConformState(id(), cache_path, stream_, params, (mode == RenderMode::kOnline));
-  if (conform.state == ConformManager::kConformGenerating) {
-    // If we need the task, it's available in `conform.task`
+  bool partial = (conform.state == ConformManager::kConformGenerating);
+  if (partial && !conform.ready.contains(range)) {
+    if (waiting_for) {
+      *waiting_for = conform.task;
+    }
     return kWaitingForConform;
   }
 
-  // See if we got the conform
-  if (RetrieveAudioFromConform(dest, conform.filenames, range, loop_mode, params)) {
+  // See if we got the conform (or at least the part of it we need)
+  if (RetrieveAudioFromConform(dest, conform.filenames, range, loop_mode, params, partial)) {
     return kOK;
   } else {
     return kUnknownError;
@@ -146,6 +152,26 @@ qint64 Decoder::GetLastAccessedTime()
   return last_accessed_;
 }
 
+bool Decoder::GetSeekCost(const rational &time, int64_t *cost)
+{
+  // Don't wait for a decoder that's busy, the caller will prefer another instance
+  if (!mutex_.tryLock()) {
+    return false;
+  }
+
+  if (!stream_.IsValid()) {
+    *cost = kSeekRequired;
+  } else if (time == kAnyTimecode) {
+    *cost = 0;
+  } else {
+    *cost = GetSeekCostInternal(time);
+  }
+
+  mutex_.unlock();
+
+  return true;
+}
+
 void Decoder::Close()
 {
   QMutexLocker locker(&mutex_);
@@ -155,14 +181,26 @@ void Decoder::Close()
   if (stream_.IsValid()) {
     CloseInternal();
     stream_.Reset();
+    conform_file_.close();
   } else {
     qWarning() << "Tried to close a decoder that wasn't open";
   }
 }
 
-bool Decoder::ConformAudio(const QVector<QString> &output_filenames, const AudioParams &params, const QAtomicInt *cancelled)
+bool Decoder::ConformAudio(const QVector<QString> &output_filenames, const AudioParams &params, const TimeRange &range, const QAtomicInt *cancelled)
+{
+  return ConformAudioInternal(output_filenames, params, range, cancelled);
+}
+
+rational Decoder::GetStreamDuration()
 {
-  return ConformAudioInternal(output_filenames, params, cancelled);
+  QMutexLocker locker(&mutex_);
+
+  if (!stream_.IsValid()) {
+    return 0;
+  }
+
+  return GetStreamDurationInternal();
 }
 
 /*
@@ -219,6 +257,11 @@ void Decoder::SignalProcessingProgress(int64_t ts, int64_t duration)
   }
 }
 
+void Decoder::SignalConformedRange(const TimeRange &range)
+{
+  emit AudioConformed(range);
+}
+
 QString Decoder::TransformImageSequenceFileName(const QString &filename, const int64_t& number)
 {
   int digit_count = GetImageSequenceDigitCount(filename);
@@ -264,27 +307,56 @@ int64_t Decoder::GetImageSequenceIndex(const QString &filename)
   return number_only.toLongLong();
 }
 
-TexturePtr Decoder::RetrieveVideoInternal(Renderer *renderer, const rational &timecode, const RetrieveVideoParams &divider, const QAtomicInt *cancelled)
+TexturePtr Decoder::RetrieveVideoInternal(Renderer *renderer, const rational &timecode, const RetrieveVideoParams &divider, const QAtomicInt *cancelled, YUVPlanes *yuv)
 {
   Q_UNUSED(timecode)
   Q_UNUSED(divider)
   Q_UNUSED(cancelled)
+  Q_UNUSED(yuv)
   return nullptr;
 }
 
-bool Decoder::ConformAudioInternal(const QVector<QString> &filenames, const AudioParams &params, const QAtomicInt* cancelled)
+bool Decoder::ConformAudioInternal(const QVector<QString> &filenames, const AudioParams &params, const TimeRange &range, const QAtomicInt* cancelled)
 {
   Q_UNUSED(filenames)
   Q_UNUSED(cancelled)
+  Q_UNUSED(range)
   Q_UNUSED(params)
   return false;
 }
 
-bool Decoder::RetrieveAudioFromConform(SampleBuffer &sample_buffer, const QVector<QString> &conform_filenames, const TimeRange& range, Footage::LoopMode loop_mode, const AudioParams &input_params)
+rational Decoder::GetStreamDurationInternal()
 {
-  PlanarFileDevice input;
-  if (input.open(conform_filenames, QFile::ReadOnly)) {
+  return 0;
+}
+
+int64_t Decoder::GetSeekCostInternal(const rational &time)
+{
+  Q_UNUSED(time)
+  return 0;
+}
+
+bool Decoder::RetrieveAudioFromConform(SampleBuffer &sample_buffer, const QVector<QString> &conform_filenames, const TimeRange& range, Footage::LoopMode loop_mode, const AudioParams &input_params, bool partial)
+{
+  if (partial || conform_file_.filenames() != conform_filenames) {
+    // Working files are still growing, so a previous mapping may be too short for this range
+    conform_file_.close();
+    conform_file_.open(conform_filenames, QFile::ReadOnly);
+    conform_next_read_ = -1;
+    conform_sequential_ = false;
+  }
+
+  PlanarFileDevice &input = conform_file_;
+  if (input.isOpen()) {
     qint64 read_index = input_params.time_to_bytes(range.in()) / input_params.channel_count();
+
+    // Requests that pick up where the last one ended are most likely playback, so let the OS read
+    // ahead aggressively. Anything else (scrubbing) goes back to normal paging.
+    bool sequential = (read_index == conform_next_read_);
+    if (sequential != conform_sequential_) {
+      input.SetSequentialAccess(sequential);
+      conform_sequential_ = sequential;
+    }
     qint64 write_index = 0;
 
     const qint64 buffer_length_in_bytes = sample_buffer.sample_count() * input_params.bytes_per_sample_per_channel();
@@ -320,7 +392,12 @@ bool Decoder::RetrieveAudioFromConform(SampleBuffer &sample_buffer, const QVecto
       write_index += write_count;
     }
 
-    input.close();
+    conform_next_read_ = read_index;
+
+    if (partial) {
+      // Don't hold working files open, the conform manager renames them once they're complete
+      input.close();
+    }
 
     return true;
   }
@@ -26,12 +26,14 @@ extern "C" {
 }
 
 #include <QFileInfo>
+#include <QMatrix4x4>
 #include <QMutex>
 #include <QObject>
 #include <QWaitCondition>
 #include <stdint.h>
 
 #include "codec/frame.h"
+#include "codec/planarfiledevice.h"
 #include "codec/samplebuffer.h"
 #include "common/rational.h"
 #include "node/block/block.h"
@@ -41,6 +43,7 @@ extern "C" {
 
 namespace olive {
 
+class ConformTask;
 class Decoder;
 using DecoderPtr = std::shared_ptr<Decoder>;
 
@@ -182,6 +185,25 @@ public:
     }
   };
 
+  /**
+   * @brief Chroma planes of a frame returned in planar YUV
+   *
+   * When a decoder returns a frame this way, the texture it returns holds the luma plane only.
+   * `matrix` converts a vector of (Y, U, V, 1) as sampled from the three textures into (R, G, B, 1),
+   * accounting for bit depth, range and color matrix.
+   */
+  struct YUVPlanes
+  {
+    TexturePtr u;
+    TexturePtr v;
+    QMatrix4x4 matrix;
+
+    bool IsValid() const
+    {
+      return u && v;
+    }
+  };
+
   /**
    * @brief Retrieves a video frame from footage
    *
@@ -190,9 +212,12 @@ public:
    * return the first frame. Likewise, if it is after the timecode, this function should return the
    * last frame.
    *
+   * If `yuv` is provided, decoders that support it may skip converting planar YUV frames to RGB
+   * and return the planes instead, leaving the conversion to the caller. \see YUVPlanes
+   *
    * This function is thread safe and can only run while the decoder is open. \see Open()
    */
-  TexturePtr RetrieveVideo(Renderer *renderer, const rational& timecode, const RetrieveVideoParams& params, const QAtomicInt *cancelled = nullptr);
+  TexturePtr RetrieveVideo(Renderer *renderer, const rational& timecode, const RetrieveVideoParams& params, const QAtomicInt *cancelled = nullptr, YUVPlanes *yuv = nullptr);
 
   enum RetrieveAudioStatus {
     kInvalid = -1,
@@ -207,15 +232,33 @@ public:
    * This function will always return a sample buffer unless a fatal error occurs (in such case,
    * nullptr will return). The SampleBuffer should always have enough audio for the range provided.
    *
+   * If kWaitingForConform is returned and `waiting_for` is set, it receives the task generating the
+   * conform, which reports through ConformManager::ConformRangeReady() once `range` can be read.
+   *
    * This function is thread safe and can only run while the decoder is open. \see Open()
    */
-  RetrieveAudioStatus RetrieveAudio(SampleBuffer &dest, const TimeRange& range, const AudioParams& params, const QString &cache_path, Footage::LoopMode loop_mode, RenderMode::Mode mode);
+  RetrieveAudioStatus RetrieveAudio(SampleBuffer &dest, const TimeRange& range, const AudioParams& params, const QString &cache_path, Footage::LoopMode loop_mode, RenderMode::Mode mode, ConformTask **waiting_for = nullptr);
 
   /**
    * @brief Determine the last time this decoder instance was used in any way
    */
   qint64 GetLastAccessedTime();
 
+  /**
+   * @brief Returned by GetSeekCost() if retrieving a time would require a seek
+   */
+  static const int64_t kSeekRequired;
+
+  /**
+   * @brief Estimate how much work this decoder would need to do to retrieve a certain time
+   *
+   * Returns FALSE without blocking if this decoder is currently in use by another thread.
+   * Otherwise, returns TRUE and sets `cost` to 0 if the time is already decoded, a positive value
+   * that increases with the amount of decoding required, or kSeekRequired. Costs are only
+   * comparable between decoders of the same stream.
+   */
+  bool GetSeekCost(const rational &time, int64_t *cost);
+
   /**
    * @brief Generate a Footage object from a file
    *
@@ -238,8 +281,20 @@ public:
 
   /**
    * @brief Conform audio stream
+   *
+   * Only the part of the stream inside `range` is conformed, and it's written at its own position
+   * in the output files so several decoders can conform different parts of the same stream at
+   * once. A range ending at RATIONAL_MAX conforms up to the end of the stream. While running,
+   * AudioConformed() is emitted every time another stretch of the output is complete.
    */
-  bool ConformAudio(const QVector<QString> &output_filenames, const AudioParams &params, const QAtomicInt *cancelled = nullptr);
+  bool ConformAudio(const QVector<QString> &output_filenames, const AudioParams &params, const TimeRange &range = TimeRange(0, RATIONAL_MAX), const QAtomicInt *cancelled = nullptr);
+
+  /**
+   * @brief Length of the open stream, or 0 if it can't be determined without decoding it
+   *
+   * This function is thread safe and can only run while the decoder is open. \see Open()
+   */
+  rational GetStreamDuration();
 
   /**
    * @brief Create a Decoder instance using a Decoder ID
@@ -287,12 +342,25 @@ protected:
    * Sub-classes must override this function IF they support video. Function is already mutexed
    * so sub-classes don't need to worry about thread safety.
    */
-  virtual TexturePtr RetrieveVideoInternal(Renderer *renderer, const rational& timecode, const RetrieveVideoParams& params, const QAtomicInt *cancelled);
+  virtual TexturePtr RetrieveVideoInternal(Renderer *renderer, const rational& timecode, const RetrieveVideoParams& params, const QAtomicInt *cancelled, YUVPlanes *yuv);
 
-  virtual bool ConformAudioInternal(const QVector<QString>& filenames, const AudioParams &params, const QAtomicInt* cancelled);
+  virtual bool ConformAudioInternal(const QVector<QString>& filenames, const AudioParams &params, const TimeRange &range, const QAtomicInt* cancelled);
+
+  virtual rational GetStreamDurationInternal();
+
+  /**
+   * @brief Internal seek cost function
+   *
+   * Sub-classes that hold decoding state between retrievals should override this so the decoder
+   * pool can pick the instance nearest to a time. Function is already mutexed. The default
+   * implementation returns 0, meaning any instance is equally suitable.
+   */
+  virtual int64_t GetSeekCostInternal(const rational &time);
 
   void SignalProcessingProgress(int64_t ts, int64_t duration);
 
+  void SignalConformedRange(const TimeRange &range);
+
   /**
    * @brief Return currently open stream
    *
@@ -313,10 +381,17 @@ signals:
    */
   void IndexProgress(double);
 
+  /**
+   * @brief While conforming, this signal will provide each range of the output that is complete
+   *
+   * Emitted from the thread running ConformAudio().
+   */
+  void AudioConformed(const olive::TimeRange &range);
+
 private:
   void UpdateLastAccessed();
 
-  bool RetrieveAudioFromConform(SampleBuffer &sample_buffer, const QVector<QString> &conform_filenames, const TimeRange &range, Footage::LoopMode loop_mode, const AudioParams &params);
+  bool RetrieveAudioFromConform(SampleBuffer &sample_buffer, const QVector<QString> &conform_filenames, const TimeRange &range, Footage::LoopMode loop_mode, const AudioParams &params, bool partial);
 
   CodecStream stream_;
 
@@ -324,6 +399,15 @@ private:
 
   qint64 last_accessed_;
 
+  /**
+   * @brief Conformed audio kept open (and mapped) between requests for the same conform
+   */
+  PlanarFileDevice conform_file_;
+
+  qint64 conform_next_read_;
+
+  bool conform_sequential_;
+
 };
 
 uint qHash(Decoder::CodecStream stream, uint seed = 0);
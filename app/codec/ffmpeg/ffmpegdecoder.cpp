@@ -30,6 +30,7 @@ extern "C" {
 #include <libavutil/pixdesc.h>
 }
 
+#include <limits>
 #include <OpenImageIO/imagebuf.h>
 #include <QDebug>
 #include <QFile>
@@ -54,6 +55,8 @@ namespace olive {
 
 QVariant Yuv2RgbShader;
 
+const rational FFmpegDecoder::kConformReportInterval = rational(2);
+
 FFmpegDecoder::FFmpegDecoder() :
   filter_graph_(nullptr),
   buffersrc_ctx_(nullptr),
@@ -76,6 +79,14 @@ bool FFmpegDecoder::OpenInternal()
     // Store one second in the source's timebase
     second_ts_ = qRound64(av_q2d(av_inv_q(s->time_base)));
 
+    // Use a keyframe index for seeking in video files. Image demuxers open files themselves and
+    // only ever contain one frame, so they're skipped.
+    if (s->codecpar->codec_type == AVMEDIA_TYPE_VIDEO
+        && !(s->disposition & AV_DISPOSITION_ATTACHED_PIC)
+        && !(instance_.fmt_ctx()->iformat->flags & AVFMT_NOFILE)) {
+      keyframe_index_ = FFmpegKeyframeIndex::Get(stream().filename(), stream().stream());
+    }
+
     working_frame_ = av_frame_alloc();
     working_packet_ = av_packet_alloc();
 
@@ -141,7 +152,7 @@ bool FFmpegDecoder::OpenInternal()
   return output_frame;
 }*/
 
-TexturePtr FFmpegDecoder::RetrieveVideoInternal(Renderer *renderer, const rational &timecode, const RetrieveVideoParams &params, const QAtomicInt *cancelled)
+TexturePtr FFmpegDecoder::RetrieveVideoInternal(Renderer *renderer, const rational &timecode, const RetrieveVideoParams &params, const QAtomicInt *cancelled, YUVPlanes *yuv)
 {
   if (AVFramePtr f = RetrieveFrame(timecode, cancelled)) {
     if (cancelled && *cancelled) {
@@ -226,14 +237,24 @@ TexturePtr FFmpegDecoder::RetrieveVideoInternal(Renderer *renderer, const ration
             TexturePtr u_plane = renderer->CreateTexture(plane_params, f->data[1], f->linesize[1] / px_size);
             TexturePtr v_plane = renderer->CreateTexture(plane_params, f->data[2], f->linesize[2] / px_size);
 
-            ShaderJob job;
-            job.Insert(QStringLiteral("y_channel"), NodeValue(NodeValue::kTexture, QVariant::fromValue(y_plane)));
-            job.Insert(QStringLiteral("u_channel"), NodeValue(NodeValue::kTexture, QVariant::fromValue(u_plane)));
-            job.Insert(QStringLiteral("v_channel"), NodeValue(NodeValue::kTexture, QVariant::fromValue(v_plane)));
-            job.Insert(QStringLiteral("bits_per_pixel"), NodeValue(NodeValue::kInt, bits_per_pixel));
+            QMatrix4x4 yuv_matrix = GetYUVToRGBMatrix(f.get(), bits_per_pixel, px_size * 8);
 
-            tex = renderer->CreateTexture(vp);
-            renderer->BlitToTexture(Yuv2RgbShader, job, tex.get(), false);
+            if (yuv) {
+              // Caller will convert to RGB as part of its own shader, so return the planes as-is
+              yuv->u = u_plane;
+              yuv->v = v_plane;
+              yuv->matrix = yuv_matrix;
+              tex = y_plane;
+            } else {
+              ShaderJob job;
+              job.Insert(QStringLiteral("y_channel"), NodeValue(NodeValue::kTexture, QVariant::fromValue(y_plane)));
+              job.Insert(QStringLiteral("u_channel"), NodeValue(NodeValue::kTexture, QVariant::fromValue(u_plane)));
+              job.Insert(QStringLiteral("v_channel"), NodeValue(NodeValue::kTexture, QVariant::fromValue(v_plane)));
+              job.Insert(QStringLiteral("yuv_matrix"), NodeValue(NodeValue::kMatrix, yuv_matrix));
+
+              tex = renderer->CreateTexture(vp);
+              renderer->BlitToTexture(Yuv2RgbShader, job, tex.get(), false);
+            }
           }
         }
       }
@@ -277,6 +298,8 @@ void FFmpegDecoder::CloseInternal()
   ClearFrameCache();
   FreeScaler();
 
+  keyframe_index_ = nullptr;
+
   instance_.Close();
 
   input_fmt_ = AV_PIX_FMT_NONE;
@@ -514,15 +537,22 @@ QString FFmpegDecoder::FFmpegError(int error_code)
   return QStringLiteral("%1 %2").arg(QString::number(error_code), err);
 }
 
-bool FFmpegDecoder::ConformAudioInternal(const QVector<QString> &filenames, const AudioParams &params, const QAtomicInt *cancelled)
+bool FFmpegDecoder::ConformAudioInternal(const QVector<QString> &filenames, const AudioParams &params, const TimeRange &range, const QAtomicInt *cancelled)
 {
   // Iterate through each audio frame and extract the PCM data
 
+  AVStream *avstream = instance_.avstream();
+  int64_t start_time = (avstream->start_time == AV_NOPTS_VALUE) ? 0 : avstream->start_time;
+
   // Seek to starting point
-  instance_.Seek(0);
+  if (range.in() > 0) {
+    instance_.Seek(GetTimeInTimebaseUnits(range.in(), avstream->time_base, start_time));
+  } else {
+    instance_.Seek(0);
+  }
 
   // Handle NULL channel layout
-  uint64_t channel_layout = ValidateChannelLayout(instance_.avstream());
+  uint64_t channel_layout = ValidateChannelLayout(avstream);
   if (!channel_layout) {
     qCritical() << "Failed to determine channel layout of audio file, could not conform";
     return false;
@@ -534,8 +564,8 @@ bool FFmpegDecoder::ConformAudioInternal(const QVector<QString> &filenames, cons
                                              FFmpegUtils::GetFFmpegSampleFormat(params.format()),
                                              params.sample_rate(),
                                              channel_layout,
-                                             static_cast<AVSampleFormat>(instance_.avstream()->codecpar->format),
-                                             instance_.avstream()->codecpar->sample_rate,
+                                             static_cast<AVSampleFormat>(avstream->codecpar->format),
+                                             avstream->codecpar->sample_rate,
                                              0,
                                              nullptr);
 
@@ -547,17 +577,24 @@ bool FFmpegDecoder::ConformAudioInternal(const QVector<QString> &filenames, cons
 
   bool success = false;
 
-  int64_t duration = instance_.avstream()->duration;
-  if (duration == 0 || duration == AV_NOPTS_VALUE) {
-    duration = instance_.fmt_ctx()->duration;
-    if (!(duration == 0 || duration == AV_NOPTS_VALUE)) {
-      // Rescale from AVFormatContext timebase to AVStream timebase
-      duration = av_rescale_q_rnd(duration, {1, AV_TIME_BASE}, instance_.avstream()->time_base, AV_ROUND_UP);
-    }
-  }
+  int64_t duration = GetDurationInTimebase();
+
+  // Output is only written inside [start_sample, end_sample), anything decoded outside of that
+  // belongs to another part of the conform
+  const bool to_end = (range.out() == RATIONAL_MAX);
+  const qint64 start_sample = params.time_to_samples(range.in());
+  const qint64 end_sample = to_end ? std::numeric_limits<qint64>::max() : params.time_to_samples(range.out());
+  const qint64 report_interval = params.time_to_samples(kConformReportInterval);
 
+  // Position (in output samples) of the next sample we receive from the resampler, unknown until
+  // the first frame has been decoded
+  qint64 out_sample = -1;
+  qint64 reported_sample = start_sample;
+  rational reported_time = range.in();
+
+  // Opened without truncating since other decoders may be writing other parts of the same files
   PlanarFileDevice wave_out;
-  if (wave_out.open(filenames, QFile::WriteOnly)) {
+  if (wave_out.open(filenames, QFile::ReadWrite)) {
     int nb_channels = params.channel_count();
     SampleBuffer data;
     data.set_audio_params(params);
@@ -583,6 +620,17 @@ bool FFmpegDecoder::ConformAudioInternal(const QVector<QString> &filenames, cons
 
       }
 
+      if (out_sample == -1) {
+        if (range.in() > 0 && frame->best_effort_timestamp != AV_NOPTS_VALUE) {
+          out_sample = params.time_to_samples(GetTimestampInTimeUnits(frame->best_effort_timestamp, avstream->time_base, start_time));
+        } else {
+          out_sample = 0;
+        }
+
+        // If the seek landed past our starting point, the gap is left silent
+        wave_out.seek(params.samples_to_bytes(qMax(out_sample, start_sample)) / nb_channels);
+      }
+
       // Allocate buffers
       int nb_samples = swr_get_out_samples(resampler, frame->nb_samples);
       int nb_bytes_per_channel = params.samples_to_bytes(nb_samples) / nb_channels;
@@ -598,11 +646,19 @@ bool FFmpegDecoder::ConformAudioInternal(const QVector<QString> &filenames, cons
 
       // If no error, write to files
       if (nb_samples > 0) {
-        // Update byte count for the number of samples we actually received
-        nb_bytes_per_channel = params.samples_to_bytes(nb_samples) / nb_channels;
+        // Only write the samples that fall inside our range
+        qint64 first = qMax(out_sample, start_sample);
+        qint64 last = qMin(out_sample + nb_samples, end_sample);
+
+        if (last > first) {
+          qint64 skip_bytes = params.samples_to_bytes(first - out_sample) / nb_channels;
+          nb_bytes_per_channel = params.samples_to_bytes(last - first) / nb_channels;
+
+          // Write to files
+          wave_out.write(const_cast<const char**>(reinterpret_cast<char**>(data.to_raw_ptrs().data())), nb_bytes_per_channel, skip_bytes);
+        }
 
-        // Write to files
-        wave_out.write(const_cast<const char**>(reinterpret_cast<char**>(data.to_raw_ptrs().data())), nb_bytes_per_channel);
+        out_sample += nb_samples;
       }
 
       // Free buffer
@@ -617,9 +673,28 @@ bool FFmpegDecoder::ConformAudioInternal(const QVector<QString> &filenames, cons
       }
 
       SignalProcessingProgress(frame->best_effort_timestamp, duration);
+
+      if (out_sample >= end_sample) {
+        // Reached the part another decoder is responsible for
+        success = true;
+        break;
+      }
+
+      if (out_sample - reported_sample >= report_interval) {
+        // Let the conform manager know this much is usable now
+        rational t = params.samples_to_time(out_sample);
+        SignalConformedRange(TimeRange(reported_time, t));
+        reported_sample = out_sample;
+        reported_time = t;
+      }
     }
 
     wave_out.close();
+
+    if (success) {
+      // Report the rest of the range, including anything past the end of the stream
+      SignalConformedRange(TimeRange(reported_time, range.out()));
+    }
   } else {
     qWarning() << "Failed to open WAVE output for indexing";
   }
@@ -632,6 +707,31 @@ bool FFmpegDecoder::ConformAudioInternal(const QVector<QString> &filenames, cons
   return success;
 }
 
+rational FFmpegDecoder::GetStreamDurationInternal()
+{
+  int64_t duration = GetDurationInTimebase();
+
+  if (duration == 0 || duration == AV_NOPTS_VALUE) {
+    return 0;
+  }
+
+  return Timecode::timestamp_to_time(duration, instance_.avstream()->time_base);
+}
+
+int64_t FFmpegDecoder::GetDurationInTimebase() const
+{
+  int64_t duration = instance_.avstream()->duration;
+  if (duration == 0 || duration == AV_NOPTS_VALUE) {
+    duration = instance_.fmt_ctx()->duration;
+    if (!(duration == 0 || duration == AV_NOPTS_VALUE)) {
+      // Rescale from AVFormatContext timebase to AVStream timebase
+      duration = av_rescale_q_rnd(duration, {1, AV_TIME_BASE}, instance_.avstream()->time_base, AV_ROUND_UP);
+    }
+  }
+
+  return duration;
+}
+
 VideoParams::Format FFmpegDecoder::GetNativePixelFormat(AVPixelFormat pix_fmt)
 {
   switch (pix_fmt) {
@@ -735,6 +835,42 @@ void FFmpegDecoder::CacheFrameToDisk(AVFrame *f)
 }
 */
 
+int64_t FFmpegDecoder::GetSeekCostInternal(const rational &time)
+{
+  if (!instance_.IsOpen()) {
+    return kSeekRequired;
+  }
+
+  int64_t target_ts = GetTimeInTimebaseUnits(time, instance_.avstream()->time_base, instance_.avstream()->start_time);
+
+  if (IsSeekRequired(target_ts)) {
+    return kSeekRequired;
+  }
+
+  // Otherwise, the cost is the number of timestamps we'd have to decode forward from the last
+  // decoded frame
+  return std::max(int64_t(0), target_ts - cached_frames_.back()->pts);
+}
+
+bool FFmpegDecoder::IsSeekRequired(int64_t target_ts) const
+{
+  if (cached_frames_.empty() || target_ts < cached_frames_.front()->pts) {
+    return true;
+  }
+
+  int64_t last_ts = cached_frames_.back()->pts;
+
+  if (keyframe_index_ && keyframe_index_->IsReady()) {
+    // Decoding forward is cheaper than seeking unless there's a keyframe between the last decoded
+    // frame and the target, in which case seeking to it skips everything in between
+    int64_t keyframe = keyframe_index_->GetKeyframeBefore(target_ts);
+    return keyframe != AV_NOPTS_VALUE && keyframe > last_ts;
+  }
+
+  // Without an index, assume anything too far ahead is better reached by seeking
+  return target_ts > last_ts + 2*second_ts_;
+}
+
 void FFmpegDecoder::ClearFrameCache()
 {
   if (!cached_frames_.empty()) {
@@ -752,10 +888,17 @@ AVFramePtr FFmpegDecoder::RetrieveFrame(const rational& time, const QAtomicInt *
   int64_t seek_ts = std::max(min_seek, target_ts - MaximumQueueSize());
   bool still_seeking = false;
 
+  if (keyframe_index_ && keyframe_index_->IsReady()) {
+    // Seek straight to the keyframe the target depends on
+    int64_t keyframe = keyframe_index_->GetKeyframeBefore(target_ts);
+    if (keyframe != AV_NOPTS_VALUE) {
+      seek_ts = std::max(min_seek, keyframe);
+    }
+  }
+
   if (time != kAnyTimecode) {
     // If the frame wasn't in the frame cache, see if this frame cache is too old to use
-    if (cached_frames_.empty()
-        || (target_ts < cached_frames_.front()->pts || target_ts > cached_frames_.back()->pts + 2*second_ts_)) {
+    if (IsSeekRequired(target_ts)) {
       ClearFrameCache();
 
       // Filter graph may rely on "continuous" video frames, so we free the scaler here
@@ -876,6 +1019,75 @@ AVFramePtr FFmpegDecoder::RetrieveFrame(const rational& time, const QAtomicInt *
   return return_frame;
 }
 
+QMatrix4x4 FFmpegDecoder::GetYUVToRGBMatrix(AVFrame *frame, int bits_per_pixel, int storage_bits)
+{
+  // Luma coefficients for the frame's color matrix
+  double kr, kb;
+  AVColorSpace colorspace = frame->colorspace;
+  if (colorspace == AVCOL_SPC_UNSPECIFIED) {
+    // Follow the usual convention of guessing from the resolution
+    colorspace = (frame->height >= 720) ? AVCOL_SPC_BT709 : AVCOL_SPC_BT470BG;
+  }
+
+  switch (colorspace) {
+  case AVCOL_SPC_BT709:
+    kr = 0.2126;
+    kb = 0.0722;
+    break;
+  case AVCOL_SPC_BT2020_NCL:
+  case AVCOL_SPC_BT2020_CL:
+    kr = 0.2627;
+    kb = 0.0593;
+    break;
+  case AVCOL_SPC_SMPTE240M:
+    kr = 0.212;
+    kb = 0.087;
+    break;
+  default:
+    // BT.601
+    kr = 0.299;
+    kb = 0.114;
+    break;
+  }
+
+  double kg = 1.0 - kr - kb;
+
+  // Range of each component, normalized to the maximum value of the frame's bit depth
+  double max_value = (1 << bits_per_pixel) - 1;
+  double depth_scale = (1 << (bits_per_pixel - 8)) / max_value;
+  double chroma_center = 128.0 * depth_scale;
+  double luma_offset, luma_range, chroma_range;
+  if (frame->color_range == AVCOL_RANGE_JPEG) {
+    luma_offset = 0.0;
+    luma_range = 1.0;
+    chroma_range = 1.0;
+  } else {
+    luma_offset = 16.0 * depth_scale;
+    luma_range = 219.0 * depth_scale;
+    chroma_range = 224.0 * depth_scale;
+  }
+
+  // Textures are normalized to their storage bit depth rather than the frame's (e.g. 10-bit
+  // values are stored in 16-bit textures), so scale them back up first
+  double storage_scale = ((1 << storage_bits) - 1) / max_value;
+
+  double y_scale = storage_scale / luma_range;
+  double c_scale = storage_scale / chroma_range;
+
+  // Y'CbCr to R'G'B' with scale and offset folded in
+  QMatrix4x4 to_rgb(1.0, 0.0,                          2.0 * (1.0 - kr),             0.0,
+                    1.0, -2.0 * kb * (1.0 - kb) / kg,  -2.0 * kr * (1.0 - kr) / kg,  0.0,
+                    1.0, 2.0 * (1.0 - kb),             0.0,                          0.0,
+                    0.0, 0.0,                          0.0,                          1.0);
+
+  QMatrix4x4 normalize(y_scale, 0.0,     0.0,     -luma_offset / luma_range,
+                       0.0,     c_scale, 0.0,     -chroma_center / chroma_range,
+                       0.0,     0.0,     c_scale, -chroma_center / chroma_range,
+                       0.0,     0.0,     0.0,     1.0);
+
+  return to_rgb * normalize;
+}
+
 bool FFmpegDecoder::InitScaler(AVFrame *input, const RetrieveVideoParams& params)
 {
   if (params == filter_params_ && filter_graph_ && input_fmt_ == input->format) {
@@ -37,6 +37,7 @@ extern "C" {
 #include <QWaitCondition>
 
 #include "codec/decoder.h"
+#include "codec/ffmpeg/ffmpegkeyframeindex.h"
 
 namespace olive {
 
@@ -68,9 +69,11 @@ public:
 
 protected:
   virtual bool OpenInternal() override;
-  virtual TexturePtr RetrieveVideoInternal(Renderer *renderer, const rational& timecode, const RetrieveVideoParams& params, const QAtomicInt *cancelled) override;
-  virtual bool ConformAudioInternal(const QVector<QString>& filenames, const AudioParams &params, const QAtomicInt* cancelled) override;
+  virtual TexturePtr RetrieveVideoInternal(Renderer *renderer, const rational& timecode, const RetrieveVideoParams& params, const QAtomicInt *cancelled, YUVPlanes *yuv) override;
+  virtual bool ConformAudioInternal(const QVector<QString>& filenames, const AudioParams &params, const TimeRange &range, const QAtomicInt* cancelled) override;
+  virtual rational GetStreamDurationInternal() override;
   virtual void CloseInternal() override;
+  virtual int64_t GetSeekCostInternal(const rational &time) override;
 
 private:
   class Instance
@@ -147,16 +150,38 @@ private:
 
   static const char* GetInterlacingModeInFFmpeg(VideoParams::Interlacing interlacing);
 
+  /**
+   * @brief Get a matrix converting sampled Y, U and V planes of a frame to RGB
+   *
+   * `storage_bits` is the bit depth of the textures the planes were uploaded to.
+   */
+  static QMatrix4x4 GetYUVToRGBMatrix(AVFrame *frame, int bits_per_pixel, int storage_bits);
+
   AVFramePtr GetFrameFromCache(const int64_t &t) const;
 
   void ClearFrameCache();
 
+  /**
+   * @brief Determine whether retrieving a timestamp should seek rather than decode forward
+   */
+  bool IsSeekRequired(int64_t target_ts) const;
+
   AVFramePtr RetrieveFrame(const rational &time, const QAtomicInt *cancelled);
 
   void RemoveFirstFrame();
 
   static int MaximumQueueSize();
 
+  /**
+   * @brief Length of the stream in its own timebase, or AV_NOPTS_VALUE/0 if unknown
+   */
+  int64_t GetDurationInTimebase() const;
+
+  /**
+   * @brief How much contiguous audio a conform writes before reporting it as ready
+   */
+  static const rational kConformReportInterval;
+
   RetrieveVideoParams filter_params_;
   AVFilterGraph* filter_graph_;
   AVFilterContext* buffersrc_ctx_;
@@ -178,6 +203,8 @@ private:
 
   Instance instance_;
 
+  FFmpegKeyframeIndexPtr keyframe_index_;
+
 };
 
 }
@@ -0,0 +1,241 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2022 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "ffmpegkeyframeindex.h"
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+#include <algorithm>
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QStandardPaths>
+#include <QtConcurrent/QtConcurrent>
+
+#include "common/filefunctions.h"
+
+namespace olive {
+
+QMutex FFmpegKeyframeIndex::registry_lock_;
+QHash<QString, std::weak_ptr<FFmpegKeyframeIndex> > FFmpegKeyframeIndex::registry_;
+const quint32 FFmpegKeyframeIndex::kIndexMagic = 0x4f4b4958; // "OKIX"
+const quint32 FFmpegKeyframeIndex::kIndexVersion = 1;
+
+FFmpegKeyframeIndex::FFmpegKeyframeIndex(const QString &filename, int stream) :
+  filename_(filename),
+  stream_(stream)
+{
+}
+
+FFmpegKeyframeIndex::~FFmpegKeyframeIndex()
+{
+  // If nothing is using this index anymore, there's no need to finish building it
+  cancelled_.storeRelease(1);
+  build_future_.waitForFinished();
+}
+
+FFmpegKeyframeIndexPtr FFmpegKeyframeIndex::Get(const QString &filename, int stream)
+{
+  QString key = QStringLiteral("%1:%2").arg(filename, QString::number(stream));
+
+  QMutexLocker locker(&registry_lock_);
+
+  FFmpegKeyframeIndexPtr index = registry_.value(key).lock();
+
+  if (!index) {
+    index = std::make_shared<FFmpegKeyframeIndex>(filename, stream);
+
+    if (index->Load()) {
+      index->ready_.storeRelease(1);
+    } else {
+      // Demuxing a long file can take a while, so do it without holding up the decoder
+      FFmpegKeyframeIndex *raw = index.get();
+      index->build_future_ = QtConcurrent::run([raw]{
+        raw->Build();
+      });
+    }
+
+    registry_.insert(key, index);
+  }
+
+  return index;
+}
+
+int64_t FFmpegKeyframeIndex::GetKeyframeBefore(int64_t ts) const
+{
+  if (!IsReady()) {
+    return AV_NOPTS_VALUE;
+  }
+
+  // Find the first keyframe after ts, the one we want is right before it
+  auto it = std::upper_bound(keyframes_.cbegin(), keyframes_.cend(), ts);
+
+  if (it == keyframes_.cbegin()) {
+    return AV_NOPTS_VALUE;
+  }
+
+  return *(it - 1);
+}
+
+QString FFmpegKeyframeIndex::GetCacheFilename(const QString &filename, int stream)
+{
+  QString id = FileFunctions::GetUniqueFileIdentifier(filename);
+
+  if (id.isEmpty()) {
+    return QString();
+  }
+
+  // Store alongside the footage metadata cache (see Footage::Reprobe)
+  return QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).filePath(QStringLiteral("%1.%2.kfidx").arg(id, QString::number(stream)));
+}
+
+bool FFmpegKeyframeIndex::Load()
+{
+  QString cache_filename = GetCacheFilename(filename_, stream_);
+  if (cache_filename.isEmpty()) {
+    return false;
+  }
+
+  QFile file(cache_filename);
+  if (!file.open(QFile::ReadOnly)) {
+    return false;
+  }
+
+  QDataStream ds(&file);
+
+  quint32 magic, version;
+  ds >> magic >> version;
+  if (magic != kIndexMagic || version != kIndexVersion) {
+    return false;
+  }
+
+  qint32 count;
+  ds >> count;
+  if (count < 0) {
+    return false;
+  }
+
+  keyframes_.resize(count);
+  for (qint32 i=0; i<count; i++) {
+    qint64 ts;
+    ds >> ts;
+    keyframes_[i] = ts;
+  }
+
+  if (ds.status() != QDataStream::Ok) {
+    keyframes_.clear();
+    return false;
+  }
+
+  return true;
+}
+
+bool FFmpegKeyframeIndex::Save() const
+{
+  QString cache_filename = GetCacheFilename(filename_, stream_);
+  if (cache_filename.isEmpty()) {
+    return false;
+  }
+
+  QDir().mkpath(QFileInfo(cache_filename).path());
+
+  QFile file(cache_filename);
+  if (!file.open(QFile::WriteOnly)) {
+    return false;
+  }
+
+  QDataStream ds(&file);
+
+  ds << kIndexMagic << kIndexVersion << qint32(keyframes_.size());
+  foreach (int64_t ts, keyframes_) {
+    ds << qint64(ts);
+  }
+
+  return ds.status() == QDataStream::Ok;
+}
+
+void FFmpegKeyframeIndex::Build()
+{
+  AVFormatContext *fmt_ctx = nullptr;
+
+  if (avformat_open_input(&fmt_ctx, filename_.toUtf8(), nullptr, nullptr) != 0) {
+    return;
+  }
+
+  if (avformat_find_stream_info(fmt_ctx, nullptr) < 0
+      || stream_ < 0 || stream_ >= int(fmt_ctx->nb_streams)) {
+    avformat_close_input(&fmt_ctx);
+    return;
+  }
+
+  // Ignore every other stream so the demuxer can skip over their packets
+  for (unsigned int i=0; i<fmt_ctx->nb_streams; i++) {
+    if (int(i) != stream_) {
+      fmt_ctx->streams[i]->discard = AVDISCARD_ALL;
+    }
+  }
+
+  QVector<int64_t> keyframes;
+  AVPacket *pkt = av_packet_alloc();
+  bool reached_eof = false;
+
+  while (!cancelled_.loadAcquire()) {
+    int ret = av_read_frame(fmt_ctx, pkt);
+
+    if (ret < 0) {
+      reached_eof = (ret == AVERROR_EOF);
+      break;
+    }
+
+    if (pkt->stream_index == stream_ && (pkt->flags & AV_PKT_FLAG_KEY)) {
+      int64_t ts = (pkt->pts != AV_NOPTS_VALUE) ? pkt->pts : pkt->dts;
+
+      if (ts != AV_NOPTS_VALUE) {
+        keyframes.append(ts);
+      }
+    }
+
+    av_packet_unref(pkt);
+  }
+
+  av_packet_free(&pkt);
+  avformat_close_input(&fmt_ctx);
+
+  if (!reached_eof) {
+    // Either cancelled or hit an error, a partial index could send seeks to the wrong keyframe
+    return;
+  }
+
+  std::sort(keyframes.begin(), keyframes.end());
+  keyframes.erase(std::unique(keyframes.begin(), keyframes.end()), keyframes.end());
+
+  keyframes_ = keyframes;
+
+  if (!Save()) {
+    qWarning() << "Failed to save keyframe index for" << filename_;
+  }
+
+  ready_.storeRelease(1);
+}
+
+}
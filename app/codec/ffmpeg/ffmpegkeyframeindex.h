@@ -0,0 +1,107 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2022 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef FFMPEGKEYFRAMEINDEX_H
+#define FFMPEGKEYFRAMEINDEX_H
+
+#include <memory>
+#include <QAtomicInt>
+#include <QFuture>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+#include <stdint.h>
+
+#include "common/define.h"
+
+namespace olive {
+
+class FFmpegKeyframeIndex;
+using FFmpegKeyframeIndexPtr = std::shared_ptr<FFmpegKeyframeIndex>;
+
+/**
+ * @brief Sorted list of keyframe timestamps for one stream of a media file
+ *
+ * Indexes are shared between every decoder open on the same stream. If an index hasn't been
+ * cached on disk yet, it's built in the background by demuxing (but not decoding) the whole
+ * stream, and saved next to the footage metadata cache when finished. Until then, IsReady()
+ * returns false and decoders should fall back to seeking without it.
+ */
+class FFmpegKeyframeIndex
+{
+public:
+  FFmpegKeyframeIndex(const QString &filename, int stream);
+
+  ~FFmpegKeyframeIndex();
+
+  DISABLE_COPY_MOVE(FFmpegKeyframeIndex)
+
+  /**
+   * @brief Get the shared index for a stream, loading or starting to build it if necessary
+   */
+  static FFmpegKeyframeIndexPtr Get(const QString &filename, int stream);
+
+  bool IsReady() const
+  {
+    return ready_.loadAcquire();
+  }
+
+  /**
+   * @brief Find the timestamp of the last keyframe at or before `ts`
+   *
+   * Returns AV_NOPTS_VALUE if the index isn't ready or `ts` is before the first keyframe.
+   */
+  int64_t GetKeyframeBefore(int64_t ts) const;
+
+private:
+  static QString GetCacheFilename(const QString &filename, int stream);
+
+  bool Load();
+
+  bool Save() const;
+
+  void Build();
+
+  QString filename_;
+
+  int stream_;
+
+  QVector<int64_t> keyframes_;
+
+  QAtomicInt ready_;
+
+  QAtomicInt cancelled_;
+
+  QFuture<void> build_future_;
+
+  static QMutex registry_lock_;
+
+  static QHash<QString, std::weak_ptr<FFmpegKeyframeIndex> > registry_;
+
+  static const quint32 kIndexMagic;
+
+  static const quint32 kIndexVersion;
+
+};
+
+}
+
+#endif // FFMPEGKEYFRAMEINDEX_H
@@ -116,10 +116,11 @@ bool OIIODecoder::OpenInternal()
   return OpenImageHandler(stream().filename(), stream().stream());
 }
 
-TexturePtr OIIODecoder::RetrieveVideoInternal(Renderer *renderer, const rational &timecode, const RetrieveVideoParams &params, const QAtomicInt *cancelled)
+TexturePtr OIIODecoder::RetrieveVideoInternal(Renderer *renderer, const rational &timecode, const RetrieveVideoParams &params, const QAtomicInt *cancelled, YUVPlanes *yuv)
 {
   Q_UNUSED(timecode)
   Q_UNUSED(cancelled)
+  Q_UNUSED(yuv)
 
   VideoParams vp = GetVideoParamsFromImageSpec(image_->spec());
   vp.set_divider(params.divider);
@@ -20,10 +20,16 @@
 
 #include "planarfiledevice.h"
 
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#endif
+
 namespace olive {
 
 PlanarFileDevice::PlanarFileDevice(QObject *parent) :
-  QObject(parent)
+  QObject(parent),
+  map_size_(0),
+  pos_(0)
 {
 
 }
@@ -51,14 +57,51 @@ bool PlanarFileDevice::open(const QVector<QString> &filenames, QIODevice::OpenMo
     }
   }
 
+  filenames_ = filenames;
+  pos_ = 0;
+
+  if (mode == QIODevice::ReadOnly && !files_.isEmpty()) {
+    // Every channel is the same length, so they can all share one size
+    map_size_ = files_.first()->size();
+
+    if (map_size_ > 0) {
+      maps_.resize(files_.size());
+      for (int i=0; i<files_.size(); i++) {
+        maps_[i] = files_[i]->map(0, map_size_);
+        if (!maps_[i]) {
+          // Fall back to regular reads
+          UnmapInternal();
+          break;
+        }
+      }
+    }
+  }
+
   return true;
 }
 
+void PlanarFileDevice::SetSequentialAccess(bool e)
+{
+#ifdef Q_OS_UNIX
+  for (int i=0; i<maps_.size(); i++) {
+    posix_madvise(maps_.at(i), map_size_, e ? POSIX_MADV_SEQUENTIAL : POSIX_MADV_NORMAL);
+  }
+#else
+  Q_UNUSED(e)
+#endif
+}
+
 qint64 PlanarFileDevice::read(char **data, qint64 bytes_per_channel, qint64 offset)
 {
   qint64 ret = -1;
 
-  if (isOpen()) {
+  if (isMapped()) {
+    ret = qMax(qint64(0), qMin(bytes_per_channel, map_size_ - pos_));
+    for (int i=0; i<maps_.size(); i++) {
+      memcpy(data[i] + offset, maps_.at(i) + pos_, ret);
+    }
+    pos_ += ret;
+  } else if (isOpen()) {
     for (int i=0; i<files_.size(); i++) {
       // Kind of clunky but should be largely fine
       ret = files_[i]->read(data[i] + offset, bytes_per_channel);
@@ -84,7 +127,9 @@ qint64 PlanarFileDevice::write(const char **data, qint64 bytes_per_channel, qint
 
 qint64 PlanarFileDevice::size() const
 {
-  if (isOpen()) {
+  if (isMapped()) {
+    return map_size_;
+  } else if (isOpen()) {
     return files_.first()->size();
   } else {
     return 0;
@@ -93,6 +138,11 @@ qint64 PlanarFileDevice::size() const
 
 bool PlanarFileDevice::seek(qint64 pos)
 {
+  if (isMapped()) {
+    pos_ = pos;
+    return pos >= 0 && pos <= map_size_;
+  }
+
   bool ret = true;
 
   for (int i=0; i<files_.size(); i++) {
@@ -104,6 +154,8 @@ bool PlanarFileDevice::seek(qint64 pos)
 
 void PlanarFileDevice::close()
 {
+  UnmapInternal();
+
   for (int i=0; i<files_.size(); i++) {
     QFile *f = files_.at(i);
     if (f) {
@@ -114,6 +166,18 @@ void PlanarFileDevice::close()
     }
   }
   files_.clear();
+  filenames_.clear();
+}
+
+void PlanarFileDevice::UnmapInternal()
+{
+  for (int i=0; i<maps_.size(); i++) {
+    if (maps_.at(i)) {
+      files_.at(i)->unmap(maps_.at(i));
+    }
+  }
+  maps_.clear();
+  map_size_ = 0;
 }
 
 }
@@ -42,8 +42,37 @@ public:
     return !files_.isEmpty();
   }
 
+  /**
+   * @brief Open one file per channel
+   *
+   * Files opened ReadOnly are memory-mapped where possible, so reads become a single memcpy per
+   * channel (or no copy at all through channel_data()) rather than a seek and read syscall each.
+   */
   bool open(const QVector<QString> &filenames, QIODevice::OpenMode mode);
 
+  const QVector<QString> &filenames() const
+  {
+    return filenames_;
+  }
+
+  bool isMapped() const
+  {
+    return !maps_.isEmpty();
+  }
+
+  /**
+   * @brief Direct read-only view of a channel's data, only valid while mapped
+   */
+  const char *channel_data(int channel) const
+  {
+    return reinterpret_cast<const char*>(maps_.at(channel));
+  }
+
+  /**
+   * @brief Hint to the OS that the mapped data is about to be read front-to-back (e.g. playback)
+   */
+  void SetSequentialAccess(bool e);
+
   qint64 read(char **data, qint64 bytes_per_channel, qint64 offset = 0);
 
   qint64 write(const char **data, qint64 bytes_per_channel, qint64 offset = 0);
@@ -55,8 +84,18 @@ public:
   void close();
 
 private:
+  void UnmapInternal();
+
   QVector<QFile*> files_;
 
+  QVector<QString> filenames_;
+
+  QVector<uchar*> maps_;
+
+  qint64 map_size_;
+
+  qint64 pos_;
+
 };
 
 }
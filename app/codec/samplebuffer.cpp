@@ -20,10 +20,165 @@
 
 #include "samplebuffer.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include "common/cpuoptimize.h"
+#include "samplebufferkernels.h"
 
 namespace olive {
 
+namespace {
+
+// Every channel starts on a cache line, which also satisfies SSE/NEON and AVX alignment
+const int kChannelAlignment = 64;
+const int kChannelAlignmentFloats = kChannelAlignment / sizeof(float);
+
+/*
+ * Each operation runs the widest vector kernel the CPU supports over as much of the buffer as it
+ * can and finishes the remainder with the scalar kernel.
+ */
+
+void Scale(float *d, int n, float v)
+{
+  int start = 0;
+#ifdef SAMPLEBUFFER_AVX2
+  if (CPUSupportsAVX2()) {
+    start = ScaleAVX2(d, n, v);
+  }
+#endif
+#ifdef SAMPLEBUFFER_SSE
+  if (!start) {
+    start = ScaleSSE(d, n, v);
+  }
+#endif
+  ScaleScalar(d, start, n, v);
+}
+
+void MulAdd(float *d, const float *s, int n, float v)
+{
+  int start = 0;
+#ifdef SAMPLEBUFFER_AVX2
+  if (CPUSupportsAVX2()) {
+    start = MulAddAVX2(d, s, n, v);
+  }
+#endif
+#ifdef SAMPLEBUFFER_SSE
+  if (!start) {
+    start = MulAddSSE(d, s, n, v);
+  }
+#endif
+  MulAddScalar(d, s, start, n, v);
+}
+
+void Ramp(float *d, int n, float from, float step)
+{
+  int start = 0;
+#ifdef SAMPLEBUFFER_AVX2
+  if (CPUSupportsAVX2()) {
+    start = RampAVX2(d, n, from, step);
+  }
+#endif
+#ifdef SAMPLEBUFFER_SSE
+  if (!start) {
+    start = RampSSE(d, n, from, step);
+  }
+#endif
+  RampScalar(d, start, n, from, step);
+}
+
+void Clamp(float *d, int n, float lo, float hi)
+{
+  int start = 0;
+#ifdef SAMPLEBUFFER_AVX2
+  if (CPUSupportsAVX2()) {
+    start = ClampAVX2(d, n, lo, hi);
+  }
+#endif
+#ifdef SAMPLEBUFFER_SSE
+  if (!start) {
+    start = ClampSSE(d, n, lo, hi);
+  }
+#endif
+  ClampScalar(d, start, n, lo, hi);
+}
+
+void Reverse(float *d, int n)
+{
+  int lo = 0;
+  int hi = n;
+#ifdef SAMPLEBUFFER_SSE
+  // Swap four samples from each end at a time, reversing each group as we go
+  while (hi - lo >= 8) {
+    __m128 a = _mm_loadu_ps(d + lo);
+    __m128 b = _mm_loadu_ps(d + hi - 4);
+    _mm_storeu_ps(d + lo, _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 1, 2, 3)));
+    _mm_storeu_ps(d + hi - 4, _mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 1, 2, 3)));
+    lo += 4;
+    hi -= 4;
+  }
+#endif
+  std::reverse(d + lo, d + hi);
+}
+
+float Peak(const float *d, int n)
+{
+  int start = 0;
+  float peak = 0.0f;
+#ifdef SAMPLEBUFFER_AVX2
+  if (CPUSupportsAVX2()) {
+    start = PeakAVX2(d, n, &peak);
+  }
+#endif
+#ifdef SAMPLEBUFFER_SSE
+  if (!start) {
+    start = PeakSSE(d, n, &peak);
+  }
+#endif
+  return PeakScalar(d, start, n, peak);
+}
+
+double SumSquares(const float *d, int n)
+{
+  int start = 0;
+  double sum = 0;
+#ifdef SAMPLEBUFFER_AVX2
+  if (CPUSupportsAVX2()) {
+    start = SumSquaresAVX2(d, n, &sum);
+  }
+#endif
+#ifdef SAMPLEBUFFER_SSE
+  if (!start) {
+    start = SumSquaresSSE(d, n, &sum);
+  }
+#endif
+  return SumSquaresScalar(d, start, n, sum);
+}
+
+}
+
+SampleBuffer::Storage::Storage(int channels, int samples_per_channel)
+{
+  // Round each channel up to a whole number of cache lines so the next one stays aligned
+  stride_ = ((samples_per_channel + kChannelAlignmentFloats - 1) / kChannelAlignmentFloats) * kChannelAlignmentFloats;
+
+  // Audio buffers vary in length too much for FrameManager's exact size pool to find reuse, and
+  // the allocator is fast enough for blocks this size
+  size_t size = size_t(stride_) * channels * sizeof(float);
+  data_ = static_cast<float*>(qMallocAligned(size, kChannelAlignment));
+  memset(data_, 0, size);
+
+  pointers_.resize(channels);
+  for (int i=0; i<channels; i++) {
+    pointers_[i] = data_ + i * stride_;
+  }
+}
+
+SampleBuffer::Storage::~Storage()
+{
+  qFreeAligned(data_);
+}
+
 SampleBuffer::SampleBuffer() :
   sample_count_per_channel_(0)
 {
@@ -75,7 +230,7 @@ void SampleBuffer::set_sample_count(const int &sample_count)
 
 bool SampleBuffer::is_allocated() const
 {
-  return !data_.isEmpty();
+  return storage_ != nullptr;
 }
 
 void SampleBuffer::allocate()
@@ -95,15 +250,26 @@ void SampleBuffer::allocate()
     return;
   }
 
-  data_.resize(audio_params_.channel_count());
-  for (int i=0; i<audio_params_.channel_count(); i++) {
-    data_[i].resize(sample_count_per_channel_);
-  }
+  storage_ = std::make_shared<Storage>(audio_params_.channel_count(), sample_count_per_channel_);
 }
 
 void SampleBuffer::destroy()
 {
-  data_.clear();
+  storage_ = nullptr;
+}
+
+void SampleBuffer::detach()
+{
+  if (storage_ && storage_.use_count() > 1) {
+    // Another buffer shares our data, take our own copy before writing to it
+    std::shared_ptr<Storage> copy = std::make_shared<Storage>(audio_params_.channel_count(), sample_count_per_channel_);
+
+    for (int i=0; i<audio_params_.channel_count(); i++) {
+      memcpy(copy->channel(i), storage_->channel(i), sample_count_per_channel_ * sizeof(float));
+    }
+
+    storage_ = copy;
+  }
 }
 
 void SampleBuffer::reverse()
@@ -113,14 +279,10 @@ void SampleBuffer::reverse()
     return;
   }
 
-  int half_nb_sample = sample_count_per_channel_ / 2;
-
-  for (int i=0;i<half_nb_sample;i++) {
-    int opposite_ind = sample_count_per_channel_ - i - 1;
+  detach();
 
-    for (int j=0;j<audio_params_.channel_count();j++) {
-      std::swap(data_[j][i], data_[j][opposite_ind]);
-    }
+  for (int i=0; i<audio_params_.channel_count(); i++) {
+    Reverse(storage_->channel(i), sample_count_per_channel_);
   }
 }
 
@@ -131,24 +293,28 @@ void SampleBuffer::speed(double speed)
     return;
   }
 
+  int input_count = sample_count_per_channel_;
+
   sample_count_per_channel_ = qRound(static_cast<double>(sample_count_per_channel_) / speed);
 
-  QVector< QVector<float> > output_data;
+  std::shared_ptr<Storage> output = std::make_shared<Storage>(audio_params_.channel_count(), sample_count_per_channel_);
 
-  output_data.resize(audio_params_.channel_count());
-  for (int i=0; i<audio_params_.channel_count(); i++) {
-    output_data[i].resize(sample_count_per_channel_);
+  // Work out the source index of each output sample once rather than once per channel
+  std::vector<int> input_index(sample_count_per_channel_);
+  for (int i=0; i<sample_count_per_channel_; i++) {
+    input_index[i] = qMin(qFloor(static_cast<double>(i) * speed), input_count - 1);
   }
 
-  for (int i=0;i<sample_count_per_channel_;i++) {
-    int input_index = qFloor(static_cast<double>(i) * speed);
+  for (int j=0; j<audio_params_.channel_count(); j++) {
+    const float *in = storage_->channel(j);
+    float *out = output->channel(j);
 
-    for (int j=0;j<audio_params_.channel_count();j++) {
-      output_data[j][i] = data_[j][input_index];
+    for (int i=0; i<sample_count_per_channel_; i++) {
+      out[i] = in[input_index[i]];
     }
   }
 
-  data_ = output_data;
+  storage_ = output;
 }
 
 void SampleBuffer::transform_volume(float f)
@@ -160,23 +326,7 @@ void SampleBuffer::transform_volume(float f)
 
 void SampleBuffer::transform_volume_for_channel(int channel, float volume)
 {
-  float *cdat = data_[channel].data();
-  int unopt_start = 0;
-
-#if defined(Q_PROCESSOR_X86) || defined(Q_PROCESSOR_ARM)
-  __m128 mult = _mm_load1_ps(&volume);
-  unopt_start = (sample_count_per_channel_ / 4) * 4;
-  for (int j=0; j<unopt_start; j+=4) {
-    float *here = cdat + j;
-    __m128 samples = _mm_loadu_ps(here);
-    __m128 multiplied = _mm_mul_ps(samples, mult);
-    _mm_storeu_ps(here, multiplied);
-  }
-#endif
-
-  for (int j=unopt_start; j<sample_count_per_channel_; j++) {
-    cdat[j] *= volume;
-  }
+  Scale(data(channel), sample_count_per_channel_, volume);
 }
 
 void SampleBuffer::transform_volume_for_sample(int sample_index, float volume)
@@ -188,7 +338,36 @@ void SampleBuffer::transform_volume_for_sample(int sample_index, float volume)
 
 void SampleBuffer::transform_volume_for_sample_on_channel(int sample_index, int channel, float volume)
 {
-  data_[channel][sample_index] *= volume;
+  data(channel)[sample_index] *= volume;
+}
+
+void SampleBuffer::transform_volume_ramp(float from, float to)
+{
+  if (!is_allocated()) {
+    qWarning() << "Tried to ramp an unallocated sample buffer";
+    return;
+  }
+
+  float step = (sample_count_per_channel_ > 1) ? (to - from) / (sample_count_per_channel_ - 1) : 0.0f;
+
+  for (int i=0; i<channel_count(); i++) {
+    Ramp(data(i), sample_count_per_channel_, from, step);
+  }
+}
+
+void SampleBuffer::mix(const SampleBuffer &other, float volume)
+{
+  if (!is_allocated() || !other.is_allocated()) {
+    qWarning() << "Tried to mix an unallocated sample buffer";
+    return;
+  }
+
+  int count = qMin(sample_count_per_channel_, other.sample_count());
+  int channels = qMin(channel_count(), other.channel_count());
+
+  for (int i=0; i<channels; i++) {
+    MulAdd(data(i), other.data(i), count, volume);
+  }
 }
 
 void SampleBuffer::clamp()
@@ -198,6 +377,20 @@ void SampleBuffer::clamp()
   }
 }
 
+float SampleBuffer::peak(int channel) const
+{
+  return Peak(data(channel), sample_count_per_channel_);
+}
+
+float SampleBuffer::rms(int channel) const
+{
+  if (!sample_count_per_channel_) {
+    return 0.0f;
+  }
+
+  return std::sqrt(SumSquares(data(channel), sample_count_per_channel_) / sample_count_per_channel_);
+}
+
 void SampleBuffer::silence()
 {
   silence(0, sample_count_per_channel_);
@@ -216,7 +409,7 @@ void SampleBuffer::silence_bytes(int start_byte, int end_byte)
   }
 
   for (int i=0;i<audio_params().channel_count();i++) {
-    memset(reinterpret_cast<char*>(data_[i].data()) + start_byte, 0, end_byte - start_byte);
+    memset(reinterpret_cast<char*>(data(i)) + start_byte, 0, end_byte - start_byte);
   }
 }
 
@@ -227,37 +420,12 @@ void SampleBuffer::set(int channel, const float *data, int sample_offset, int sa
     return;
   }
 
-  memcpy(&data_[channel].data()[sample_offset], data, sizeof(float) * sample_length);
+  memcpy(this->data(channel) + sample_offset, data, sizeof(float) * sample_length);
 }
 
 void SampleBuffer::clamp_channel(int channel)
 {
-  const float min = -1.0f;
-  const float max = 1.0f;
-
-  float *cdat = data_[channel].data();
-  int unopt_start = 0;
-
-#if defined(Q_PROCESSOR_X86) || defined(Q_PROCESSOR_ARM)
-  __m128 min_sse = _mm_load1_ps(&min);
-  __m128 max_sse = _mm_load1_ps(&max);
-
-  unopt_start = (sample_count_per_channel_ / 4) * 4;
-  for (int j=0; j<unopt_start; j+=4) {
-    float *here = cdat + j;
-    __m128 samples = _mm_loadu_ps(here);
-
-    samples = _mm_max_ps(samples, min_sse);
-    samples = _mm_min_ps(samples, max_sse);
-
-    _mm_storeu_ps(here, samples);
-  }
-#endif
-
-  for (int sample=unopt_start; sample<sample_count(); sample++) {
-    float &s = data(channel)[sample];
-    s = std::clamp(s, min, max);
-  }
+  Clamp(data(channel), sample_count_per_channel_, -1.0f, 1.0f);
 }
 
 }
@@ -23,6 +23,7 @@
 
 #include <memory>
 
+#include "common/define.h"
 #include "render/audioparams.h"
 
 namespace olive {
@@ -34,6 +35,11 @@ namespace olive {
  * rendering code. This replaces the old system of using QByteArrays (containing packed audio) and while SampleBuffer
  * replaces many of those in the rendering/processing side of things, QByteArrays are currently still in use for
  * playback, including reading to and from the cache.
+ *
+ * All channels live in a single aligned allocation, each one starting on a 64-byte boundary so the
+ * kernels below can use aligned vector loads. Copies share that allocation and the buffer detaches
+ * the first time a shared copy is written to (i.e. non-const data() or any transform), so prefer
+ * const access when only reading.
  */
 class SampleBuffer
 {
@@ -54,24 +60,22 @@ public:
 
   float* data(int channel)
   {
-    return data_[channel].data();
+    detach();
+    return storage_->channel(channel);
   }
 
   const float* data(int channel) const
   {
-    return data_.at(channel).constData();
+    return storage_->channel(channel);
   }
 
   QVector<float *> to_raw_ptrs()
   {
-    QVector<float *> r(data_.size());
-    for (int i=0; i<r.size(); i++) {
-      r[i] = data_[i].data();
-    }
-    return r;
+    detach();
+    return storage_->pointers();
   }
 
-  int channel_count() const { return data_.size(); }
+  int channel_count() const { return storage_ ? audio_params_.channel_count() : 0; }
 
   bool is_allocated() const;
   void allocate();
@@ -84,8 +88,28 @@ public:
   void transform_volume_for_sample(int sample_index, float volume);
   void transform_volume_for_sample_on_channel(int sample_index, int channel, float volume);
 
+  /**
+   * @brief Linearly ramp volume from `from` at the first sample to `to` at the last
+   */
+  void transform_volume_ramp(float from, float to);
+
+  /**
+   * @brief Add `other` (scaled by `volume`) into this buffer, up to the shorter of the two lengths
+   */
+  void mix(const SampleBuffer &other, float volume = 1.0f);
+
   void clamp();
 
+  /**
+   * @brief Return the absolute peak of a channel
+   */
+  float peak(int channel) const;
+
+  /**
+   * @brief Return the root mean square level of a channel
+   */
+  float rms(int channel) const;
+
   void silence();
   void silence(int start_sample, int end_sample);
   void silence_bytes(int start_byte, int end_byte);
@@ -97,13 +121,48 @@ public:
   }
 
 private:
+  class Storage
+  {
+  public:
+    Storage(int channels, int samples_per_channel);
+
+    ~Storage();
+
+    DISABLE_COPY_MOVE(Storage)
+
+    float *channel(int c) const
+    {
+      return pointers_.at(c);
+    }
+
+    const QVector<float*> &pointers() const
+    {
+      return pointers_;
+    }
+
+    int stride() const
+    {
+      return stride_;
+    }
+
+  private:
+    float *data_;
+
+    int stride_;
+
+    QVector<float*> pointers_;
+
+  };
+
+  void detach();
+
   void clamp_channel(int channel);
 
   AudioParams audio_params_;
 
   int sample_count_per_channel_;
 
-  QVector< QVector<float> > data_;
+  std::shared_ptr<Storage> storage_;
 
 };
 
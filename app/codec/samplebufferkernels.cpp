@@ -0,0 +1,234 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2022 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "samplebufferkernels.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "common/cpuoptimize.h"
+
+#ifdef SAMPLEBUFFER_AVX2
+#include <immintrin.h>
+#endif
+
+namespace olive {
+
+void ScaleScalar(float *d, int start, int n, float v)
+{
+  for (int i=start; i<n; i++) {
+    d[i] *= v;
+  }
+}
+
+void MulAddScalar(float *d, const float *s, int start, int n, float v)
+{
+  for (int i=start; i<n; i++) {
+    d[i] += s[i] * v;
+  }
+}
+
+void RampScalar(float *d, int start, int n, float from, float step)
+{
+  for (int i=start; i<n; i++) {
+    d[i] *= from + step * i;
+  }
+}
+
+void ClampScalar(float *d, int start, int n, float lo, float hi)
+{
+  for (int i=start; i<n; i++) {
+    d[i] = std::clamp(d[i], lo, hi);
+  }
+}
+
+float PeakScalar(const float *d, int start, int n, float peak)
+{
+  for (int i=start; i<n; i++) {
+    peak = std::max(peak, std::abs(d[i]));
+  }
+  return peak;
+}
+
+double SumSquaresScalar(const float *d, int start, int n, double sum)
+{
+  for (int i=start; i<n; i++) {
+    sum += d[i] * d[i];
+  }
+  return sum;
+}
+
+#ifdef SAMPLEBUFFER_SSE
+int ScaleSSE(float *d, int n, float v)
+{
+  int end = (n / 4) * 4;
+  __m128 m = _mm_set1_ps(v);
+  for (int i=0; i<end; i+=4) {
+    _mm_store_ps(d + i, _mm_mul_ps(_mm_load_ps(d + i), m));
+  }
+  return end;
+}
+
+int MulAddSSE(float *d, const float *s, int n, float v)
+{
+  int end = (n / 4) * 4;
+  __m128 m = _mm_set1_ps(v);
+  for (int i=0; i<end; i+=4) {
+    _mm_store_ps(d + i, _mm_add_ps(_mm_load_ps(d + i), _mm_mul_ps(_mm_load_ps(s + i), m)));
+  }
+  return end;
+}
+
+int RampSSE(float *d, int n, float from, float step)
+{
+  int end = (n / 4) * 4;
+  __m128 gain = _mm_add_ps(_mm_set1_ps(from), _mm_mul_ps(_mm_set_ps(3, 2, 1, 0), _mm_set1_ps(step)));
+  __m128 inc = _mm_set1_ps(step * 4);
+  for (int i=0; i<end; i+=4) {
+    _mm_store_ps(d + i, _mm_mul_ps(_mm_load_ps(d + i), gain));
+    gain = _mm_add_ps(gain, inc);
+  }
+  return end;
+}
+
+int ClampSSE(float *d, int n, float lo, float hi)
+{
+  int end = (n / 4) * 4;
+  __m128 l = _mm_set1_ps(lo);
+  __m128 h = _mm_set1_ps(hi);
+  for (int i=0; i<end; i+=4) {
+    _mm_store_ps(d + i, _mm_min_ps(_mm_max_ps(_mm_load_ps(d + i), l), h));
+  }
+  return end;
+}
+
+int PeakSSE(const float *d, int n, float *peak)
+{
+  int end = (n / 4) * 4;
+  __m128 sign = _mm_set1_ps(-0.0f);
+  __m128 m = _mm_setzero_ps();
+  for (int i=0; i<end; i+=4) {
+    m = _mm_max_ps(m, _mm_andnot_ps(sign, _mm_load_ps(d + i)));
+  }
+  alignas(16) float r[4];
+  _mm_store_ps(r, m);
+  *peak = *std::max_element(r, r + 4);
+  return end;
+}
+
+int SumSquaresSSE(const float *d, int n, double *sum)
+{
+  int end = (n / 4) * 4;
+  __m128 acc = _mm_setzero_ps();
+  for (int i=0; i<end; i+=4) {
+    __m128 x = _mm_load_ps(d + i);
+    acc = _mm_add_ps(acc, _mm_mul_ps(x, x));
+  }
+  alignas(16) float r[4];
+  _mm_store_ps(r, acc);
+  *sum = double(r[0]) + r[1] + r[2] + r[3];
+  return end;
+}
+#endif
+
+#ifdef SAMPLEBUFFER_AVX2
+bool CPUSupportsAVX2()
+{
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  return has_avx2;
+}
+
+SAMPLEBUFFER_AVX2_TARGET int ScaleAVX2(float *d, int n, float v)
+{
+  int end = (n / 8) * 8;
+  __m256 m = _mm256_set1_ps(v);
+  for (int i=0; i<end; i+=8) {
+    _mm256_store_ps(d + i, _mm256_mul_ps(_mm256_load_ps(d + i), m));
+  }
+  return end;
+}
+
+SAMPLEBUFFER_AVX2_TARGET int MulAddAVX2(float *d, const float *s, int n, float v)
+{
+  int end = (n / 8) * 8;
+  __m256 m = _mm256_set1_ps(v);
+  for (int i=0; i<end; i+=8) {
+    _mm256_store_ps(d + i, _mm256_add_ps(_mm256_load_ps(d + i), _mm256_mul_ps(_mm256_load_ps(s + i), m)));
+  }
+  return end;
+}
+
+SAMPLEBUFFER_AVX2_TARGET int RampAVX2(float *d, int n, float from, float step)
+{
+  int end = (n / 8) * 8;
+  __m256 gain = _mm256_add_ps(_mm256_set1_ps(from),
+                              _mm256_mul_ps(_mm256_set_ps(7, 6, 5, 4, 3, 2, 1, 0), _mm256_set1_ps(step)));
+  __m256 inc = _mm256_set1_ps(step * 8);
+  for (int i=0; i<end; i+=8) {
+    _mm256_store_ps(d + i, _mm256_mul_ps(_mm256_load_ps(d + i), gain));
+    gain = _mm256_add_ps(gain, inc);
+  }
+  return end;
+}
+
+SAMPLEBUFFER_AVX2_TARGET int ClampAVX2(float *d, int n, float lo, float hi)
+{
+  int end = (n / 8) * 8;
+  __m256 l = _mm256_set1_ps(lo);
+  __m256 h = _mm256_set1_ps(hi);
+  for (int i=0; i<end; i+=8) {
+    _mm256_store_ps(d + i, _mm256_min_ps(_mm256_max_ps(_mm256_load_ps(d + i), l), h));
+  }
+  return end;
+}
+
+SAMPLEBUFFER_AVX2_TARGET int PeakAVX2(const float *d, int n, float *peak)
+{
+  int end = (n / 8) * 8;
+  __m256 sign = _mm256_set1_ps(-0.0f);
+  __m256 m = _mm256_setzero_ps();
+  for (int i=0; i<end; i+=8) {
+    m = _mm256_max_ps(m, _mm256_andnot_ps(sign, _mm256_load_ps(d + i)));
+  }
+  alignas(32) float r[8];
+  _mm256_store_ps(r, m);
+  *peak = *std::max_element(r, r + 8);
+  return end;
+}
+
+SAMPLEBUFFER_AVX2_TARGET int SumSquaresAVX2(const float *d, int n, double *sum)
+{
+  int end = (n / 8) * 8;
+  __m256 acc = _mm256_setzero_ps();
+  for (int i=0; i<end; i+=8) {
+    __m256 x = _mm256_load_ps(d + i);
+    acc = _mm256_add_ps(acc, _mm256_mul_ps(x, x));
+  }
+  alignas(32) float r[8];
+  _mm256_store_ps(r, acc);
+  *sum = 0;
+  for (int i=0; i<8; i++) {
+    *sum += r[i];
+  }
+  return end;
+}
+#endif
+
+}
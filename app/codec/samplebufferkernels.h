@@ -0,0 +1,79 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2022 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef SAMPLEBUFFERKERNELS_H
+#define SAMPLEBUFFERKERNELS_H
+
+#include <QtGlobal>
+
+#if defined(Q_PROCESSOR_X86) || defined(Q_PROCESSOR_ARM)
+#define SAMPLEBUFFER_SSE
+#endif
+
+#if defined(Q_PROCESSOR_X86) && (defined(__GNUC__) || defined(__clang__))
+#define SAMPLEBUFFER_AVX2
+#define SAMPLEBUFFER_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+
+namespace olive {
+
+/*
+ * Per-channel kernels behind SampleBuffer. These are internal to SampleBuffer and only live in
+ * their own header so each vector path can be tested directly.
+ *
+ * The vector kernels require `d` (and `s`) to be aligned to their vector width, which every
+ * SampleBuffer channel is. They process as many whole vectors as fit into `n` samples and return
+ * the index they stopped at, and the scalar kernel of the same name finishes the rest from there.
+ */
+
+void ScaleScalar(float *d, int start, int n, float v);
+void MulAddScalar(float *d, const float *s, int start, int n, float v);
+void RampScalar(float *d, int start, int n, float from, float step);
+void ClampScalar(float *d, int start, int n, float lo, float hi);
+float PeakScalar(const float *d, int start, int n, float peak);
+double SumSquaresScalar(const float *d, int start, int n, double sum);
+
+#ifdef SAMPLEBUFFER_SSE
+// Also covers ARM through sse2neon
+int ScaleSSE(float *d, int n, float v);
+int MulAddSSE(float *d, const float *s, int n, float v);
+int RampSSE(float *d, int n, float from, float step);
+int ClampSSE(float *d, int n, float lo, float hi);
+int PeakSSE(const float *d, int n, float *peak);
+int SumSquaresSSE(const float *d, int n, double *sum);
+#endif
+
+#ifdef SAMPLEBUFFER_AVX2
+/**
+ * @brief Returns whether the CPU we're running on can run the AVX2 kernels
+ */
+bool CPUSupportsAVX2();
+
+SAMPLEBUFFER_AVX2_TARGET int ScaleAVX2(float *d, int n, float v);
+SAMPLEBUFFER_AVX2_TARGET int MulAddAVX2(float *d, const float *s, int n, float v);
+SAMPLEBUFFER_AVX2_TARGET int RampAVX2(float *d, int n, float from, float step);
+SAMPLEBUFFER_AVX2_TARGET int ClampAVX2(float *d, int n, float lo, float hi);
+SAMPLEBUFFER_AVX2_TARGET int PeakAVX2(const float *d, int n, float *peak);
+SAMPLEBUFFER_AVX2_TARGET int SumSquaresAVX2(const float *d, int n, double *sum);
+#endif
+
+}
+
+#endif // SAMPLEBUFFERKERNELS_H
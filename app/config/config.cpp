@@ -135,6 +135,7 @@ void Config::SetDefaults()
 
   SetEntryInternal(QStringLiteral("DiskCacheBehind"), NodeValue::kRational, QVariant::fromValue(rational(0)));
   SetEntryInternal(QStringLiteral("DiskCacheAhead"), NodeValue::kRational, QVariant::fromValue(rational(60)));
+  SetEntryInternal(QStringLiteral("DiskCacheDeduplicate"), NodeValue::kBoolean, true);
 
   SetEntryInternal(QStringLiteral("DefaultSequenceWidth"), NodeValue::kInt, 1920);
   SetEntryInternal(QStringLiteral("DefaultSequenceHeight"), NodeValue::kInt, 1080);
@@ -148,6 +148,9 @@ void Core::Start()
   // Initialize RenderManager
   RenderManager::CreateInstance();
 
+  // Start compiling every node type's shaders while the rest of the application starts up
+  RenderManager::instance()->PrecompileShaders(NodeFactory::GetLibrary());
+
   // Initialize FrameManager
   FrameManager::CreateInstance();
 
@@ -517,6 +520,7 @@ bool Core::AddOpenProjectFromTask(Task *task)
 
     if (ValidateFootageInLoadedProject(project, project->GetSavedURL())) {
       AddOpenProject(project);
+      RenderManager::instance()->PrecompileShaders(project->nodes());
       main_window_->LoadLayout(project->GetLayoutInfo());
 
       return true;
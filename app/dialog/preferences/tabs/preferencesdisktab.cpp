@@ -82,6 +82,12 @@ PreferencesDiskTab::PreferencesDiskTab()
   cache_behind_slider_->SetValue(OLIVE_CONFIG("DiskCacheBehind").value<rational>().toDouble());
   cache_behavior_layout->addWidget(cache_behind_slider_, row, 3);
 
+  row++;
+
+  cache_deduplicate_ = new QCheckBox(tr("Share cached images between identical frames"));
+  cache_deduplicate_->setChecked(OLIVE_CONFIG("DiskCacheDeduplicate").toBool());
+  cache_behavior_layout->addWidget(cache_deduplicate_, row, 0, 1, 4);
+
   outer_layout->addStretch();
 }
 
@@ -117,6 +123,7 @@ void PreferencesDiskTab::Accept(MultiUndoCommand *command)
 
   OLIVE_CONFIG("DiskCacheBehind") = QVariant::fromValue(rational::fromDouble(cache_behind_slider_->GetValue()));
   OLIVE_CONFIG("DiskCacheAhead") = QVariant::fromValue(rational::fromDouble(cache_ahead_slider_->GetValue()));
+  OLIVE_CONFIG("DiskCacheDeduplicate") = cache_deduplicate_->isChecked();
 }
 
 }
@@ -49,6 +49,8 @@ private:
 
   FloatSlider* cache_behind_slider_;
 
+  QCheckBox* cache_deduplicate_;
+
   DiskCacheFolder* default_disk_cache_folder_;
 
 };
@@ -85,7 +85,9 @@ void PanNode::Value(const NodeValueRow &value, const NodeGlobals &globals, NodeV
         table->Push(NodeValue(NodeValue::kSamples, samples, this));
       } else {
         // Requires job
-        table->Push(NodeValue::kSamples, SampleJob(kSamplesInput, value), this);
+        SampleJob job(kSamplesInput, value);
+        job.Insert(kPanningInput, value);
+        table->Push(NodeValue::kSamples, QVariant::fromValue(job), this);
       }
     } else {
       // Pass right through
@@ -94,18 +96,35 @@ void PanNode::Value(const NodeValueRow &value, const NodeGlobals &globals, NodeV
   }
 }
 
-void PanNode::ProcessSamples(const NodeValueRow &values, const SampleBuffer &input, SampleBuffer &output, int index) const
+void PanNode::ProcessSamples(const SampleAutomationRow &automation, const SampleBuffer &input, SampleBuffer &output) const
 {
-  float pan_val = values[kPanningInput].toDouble();
+  int count = output.sample_count();
 
   for (int i=0;i<input.audio_params().channel_count();i++) {
-    output.data(i)[index] = input.data(i)[index];
+    memcpy(output.data(i), input.data(i), count * sizeof(float));
   }
 
-  if (pan_val > 0) {
-    output.data(0)[index] *= (1.0F - pan_val);
-  } else if (pan_val < 0) {
-    output.data(1)[index] *= (1.0F - qAbs(pan_val));
+  SampleAutomation pan = automation.value(kPanningInput);
+  if (!pan.IsValid()) {
+    return;
+  }
+
+  if (pan.IsConstant()) {
+    float pan_val = pan.GetConstant();
+    if (pan_val > 0) {
+      output.transform_volume_for_channel(0, 1.0f - pan_val);
+    } else if (pan_val < 0) {
+      output.transform_volume_for_channel(1, 1.0f + pan_val);
+    }
+  } else {
+    // Positive pan attenuates the left channel, negative attenuates the right
+    const float *pan_val = pan.data();
+    float *left = output.data(0);
+    float *right = output.data(1);
+    for (int j=0;j<count;j++) {
+      left[j] *= 1.0f - qMax(0.0f, pan_val[j]);
+      right[j] *= 1.0f + qMin(0.0f, pan_val[j]);
+    }
   }
 }
 
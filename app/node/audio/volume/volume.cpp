@@ -87,9 +87,9 @@ void VolumeNode::Value(const NodeValueRow &value, const NodeGlobals &globals, No
   }
 }
 
-void VolumeNode::ProcessSamples(const NodeValueRow &values, const SampleBuffer &input, SampleBuffer &output, int index) const
+void VolumeNode::ProcessSamples(const SampleAutomationRow &automation, const SampleBuffer &input, SampleBuffer &output) const
 {
-  return ProcessSamplesInternal(values, kOpMultiply, kSamplesInput, kVolumeInput, input, output, index);
+  return ProcessSamplesInternal(automation, kOpMultiply, kSamplesInput, kVolumeInput, input, output);
 }
 
 void VolumeNode::Retranslate()
@@ -35,10 +35,13 @@ const QString ClipBlock::kSpeedInput = QStringLiteral("speed_in");
 const QString ClipBlock::kReverseInput = QStringLiteral("reverse_in");
 const QString ClipBlock::kMaintainAudioPitchInput = QStringLiteral("maintain_audio_pitch_in");
 
+QAtomicInt ClipBlock::next_audio_revision_ = 0;
+
 ClipBlock::ClipBlock() :
   in_transition_(nullptr),
   out_transition_(nullptr),
-  connected_viewer_(nullptr)
+  connected_viewer_(nullptr),
+  audio_revision_(next_audio_revision_.fetchAndAddOrdered(1))
 {
   AddInput(kMediaInInput, NodeValue::kRational, InputFlags(kInputFlagNotConnectable | kInputFlagNotKeyframable));
   SetInputProperty(kMediaInInput, QStringLiteral("view"), RationalSlider::kTime);
@@ -185,6 +188,8 @@ void ClipBlock::InvalidateCache(const TimeRange& range, const QString& from, int
 {
   Q_UNUSED(element)
 
+  audio_revision_.storeRelease(next_audio_revision_.fetchAndAddOrdered(1));
+
   // If signal is from texture input, transform all times from media time to sequence time
   if (from == kBufferIn) {
     // Adjust range from media time to sequence time
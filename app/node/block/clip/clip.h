@@ -119,6 +119,25 @@ public:
     return connected_viewer_;
   }
 
+  /**
+   * @brief Value that changes whenever anything that affects this clip's output is invalidated
+   *
+   * State kept across render tickets for this clip (e.g. tempo streams) compares against this to
+   * know whether it's still valid.
+   */
+  int audio_revision() const
+  {
+    return audio_revision_.loadAcquire();
+  }
+
+  /**
+   * @brief Used by render snapshots to mirror the revision of the node they were copied from
+   */
+  void set_audio_revision(int r)
+  {
+    audio_revision_.storeRelease(r);
+  }
+
   static const QString kBufferIn;
   static const QString kMediaInInput;
   static const QString kSpeedInput;
@@ -140,6 +159,10 @@ private:
 
   ViewerOutput *connected_viewer_;
 
+  QAtomicInt audio_revision_;
+
+  static QAtomicInt next_audio_revision_;
+
 private:
   AudioVisualWaveform waveform_;
 
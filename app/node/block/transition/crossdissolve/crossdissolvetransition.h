@@ -42,6 +42,11 @@ public:
 
   virtual ShaderCode GetShaderCode(const ShaderRequest &request) const override;
 
+  virtual QStringList GetShaderIDs() const override
+  {
+    return {QString()};
+  }
+
 protected:
   virtual void ShaderJobEvent(const NodeValueRow &value, ShaderJob& job) const override;
 
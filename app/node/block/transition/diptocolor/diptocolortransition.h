@@ -40,6 +40,11 @@ public:
 
   virtual ShaderCode GetShaderCode(const ShaderRequest &request) const override;
 
+  virtual QStringList GetShaderIDs() const override
+  {
+    return {QString()};
+  }
+
   static const QString kColorInput;
 
 protected:
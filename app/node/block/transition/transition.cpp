@@ -216,6 +216,13 @@ void TransitionBlock::Value(const NodeValueRow &value, const NodeGlobals &global
   }
 }
 
+void TransitionBlock::Hash(QCryptographicHash &hash, const TimeRange &range) const
+{
+  // Transition progress is derived from the time
+  hash.addData(range.in().toString().toUtf8());
+  hash.addData(range.out().toString().toUtf8());
+}
+
 void TransitionBlock::InvalidateCache(const TimeRange &range, const QString &from, int element, InvalidateCacheOptions options)
 {
   TimeRange r = range;
@@ -64,6 +64,11 @@ public:
 
   virtual ShaderCode GetShaderCode(const ShaderRequest &request) const override;
 
+  virtual QStringList GetShaderIDs() const override
+  {
+    return {QString()};
+  }
+
   virtual void UpdateGizmoPositions(const NodeValueRow &row, const NodeGlobals &globals) override;
 
   static const QString kTextureInput;
@@ -41,6 +41,11 @@ public:
   virtual void Retranslate() override;
 
   virtual ShaderCode GetShaderCode(const ShaderRequest &request) const override;
+  virtual QStringList GetShaderIDs() const override
+  {
+    return {QString()};
+  }
+
   virtual void Value(const NodeValueRow& value, const NodeGlobals &globals, NodeValueTable *table) const override;
 
   static const QString kTextureInput;
@@ -55,6 +55,11 @@ public:
 
   virtual ShaderCode GetShaderCode(const ShaderRequest &request) const override;
 
+  virtual QStringList GetShaderIDs() const override
+  {
+    return {QStringLiteral("mrg"), QStringLiteral("feather")};
+  }
+
   virtual void Retranslate() override;
 
   virtual void Value(const NodeValueRow& value, const NodeGlobals &globals, NodeValueTable *table) const override;
@@ -68,6 +68,11 @@ public:
 
   virtual ShaderCode GetShaderCode(const ShaderRequest &request) const override;
 
+  virtual QStringList GetShaderIDs() const override
+  {
+    return {QString()};
+  }
+
   enum AutoScaleType {
     kAutoScaleNone,
     kAutoScaleFit,
@@ -98,6 +98,14 @@ public:
 
   static Node* CreateFromFactoryIndex(const InternalID& id);
 
+  /**
+   * @brief One instance of every node type
+   */
+  static QVector<Node*> GetLibrary()
+  {
+    return library_.toVector();
+  }
+
 private:
   static QList<Node*> library_;
 
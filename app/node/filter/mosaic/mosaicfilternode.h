@@ -58,6 +58,11 @@ public:
   virtual void Value(const NodeValueRow& value, const NodeGlobals &globals, NodeValueTable *table) const override;
   virtual ShaderCode GetShaderCode(const ShaderRequest &request) const override;
 
+  virtual QStringList GetShaderIDs() const override
+  {
+    return {QString()};
+  }
+
   static const QString kTextureInput;
   static const QString kHorizInput;
   static const QString kVertInput;
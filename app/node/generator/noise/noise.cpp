@@ -87,4 +87,10 @@ void NoiseGeneratorNode::Value(const NodeValueRow &value, const NodeGlobals &glo
 
   table->Push(NodeValue::kTexture, QVariant::fromValue(job), this);
 }
+
+void NoiseGeneratorNode::Hash(QCryptographicHash &hash, const TimeRange &range) const
+{
+  // Noise is seeded by time so every frame is different
+  hash.addData(range.in().toString().toUtf8());
+}
 }
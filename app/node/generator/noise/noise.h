@@ -40,8 +40,15 @@ class NoiseGeneratorNode : public Node {
   virtual void Retranslate() override;
 
   virtual ShaderCode GetShaderCode(const ShaderRequest &request) const override;
+  virtual QStringList GetShaderIDs() const override
+  {
+    return {QString()};
+  }
+
   virtual void Value(const NodeValueRow &value, const NodeGlobals &globals, NodeValueTable *table) const override;
 
+  virtual void Hash(QCryptographicHash &hash, const TimeRange &range) const override;
+
   static const QString kBaseIn;
   static const QString kColorInput;
   static const QString kStrengthInput;
@@ -35,6 +35,11 @@ public:
 
   virtual ShaderCode GetShaderCode(const ShaderRequest &request) const override;
 
+  virtual QStringList GetShaderIDs() const override
+  {
+    return {QStringLiteral("mrg")};
+  }
+
   static const QString kBaseInput;
 
 protected:
@@ -46,6 +46,11 @@ public:
   virtual void Retranslate() override;
 
   virtual ShaderCode GetShaderCode(const ShaderRequest &request) const override;
+  virtual QStringList GetShaderIDs() const override
+  {
+    return {QStringLiteral("shape"), QStringLiteral("mrg")};
+  }
+
   virtual void Value(const NodeValueRow& value, const NodeGlobals &globals, NodeValueTable *table) const override;
 
   static QString kTypeInput;
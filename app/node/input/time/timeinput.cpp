@@ -57,4 +57,10 @@ void TimeInput::Value(const NodeValueRow &value, const NodeGlobals &globals, Nod
               QStringLiteral("time"));
 }
 
+void TimeInput::Hash(QCryptographicHash &hash, const TimeRange &range) const
+{
+  // Our output is the time itself
+  hash.addData(range.in().toString().toUtf8());
+}
+
 }
@@ -109,9 +109,9 @@ void MathNode::Value(const NodeValueRow &value, const NodeGlobals &globals, Node
                        table);
 }
 
-void MathNode::ProcessSamples(const NodeValueRow &values, const SampleBuffer &input, SampleBuffer &output, int index) const
+void MathNode::ProcessSamples(const SampleAutomationRow &automation, const SampleBuffer &input, SampleBuffer &output) const
 {
-  return ProcessSamplesInternal(values, GetOperation(), kParamAIn, kParamBIn, input, output, index);
+  return ProcessSamplesInternal(automation, GetOperation(), kParamAIn, kParamBIn, input, output);
 }
 
 }
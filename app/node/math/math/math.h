@@ -54,7 +54,7 @@ public:
 
   virtual void Value(const NodeValueRow& value, const NodeGlobals &globals, NodeValueTable *table) const override;
 
-  virtual void ProcessSamples(const NodeValueRow &values, const SampleBuffer &input, SampleBuffer &output, int index) const override;
+  virtual void ProcessSamples(const SampleAutomationRow &automation, const SampleBuffer &input, SampleBuffer &output) const override;
 
   static const QString kMethodIn;
   static const QString kParamAIn;
@@ -174,6 +174,38 @@ void MathNodeBase::PerformAllOnFloatBuffer(Operation operation, float *a, float
   }
 }
 
+void MathNodeBase::PerformAllOnFloatBuffers(Operation operation, float *dst, const float *a, const float *b, int count)
+{
+  // Switch outside the loops so each one is simple enough for the compiler to vectorize
+  switch (operation) {
+  case kOpAdd:
+    for (int j=0;j<count;j++) {
+      dst[j] = a[j] + b[j];
+    }
+    break;
+  case kOpSubtract:
+    for (int j=0;j<count;j++) {
+      dst[j] = a[j] - b[j];
+    }
+    break;
+  case kOpMultiply:
+    for (int j=0;j<count;j++) {
+      dst[j] = a[j] * b[j];
+    }
+    break;
+  case kOpDivide:
+    for (int j=0;j<count;j++) {
+      dst[j] = a[j] / b[j];
+    }
+    break;
+  case kOpPower:
+    for (int j=0;j<count;j++) {
+      dst[j] = PerformAll(operation, a[j], b[j]);
+    }
+    break;
+  }
+}
+
 #if defined(Q_PROCESSOR_X86) || defined(Q_PROCESSOR_ARM)
 void MathNodeBase::PerformAllOnFloatBufferSSE(Operation operation, float *a, float b, int start, int end)
 {
@@ -298,8 +330,9 @@ void MathNodeBase::ValueInternal(Operation operation, Pairing pairing, const QSt
 
   case kPairSampleSample:
   {
-    SampleBuffer samples_a = val_a.toSamples();
-    SampleBuffer samples_b = val_b.toSamples();
+    // Const so reading doesn't detach the buffers from their other owners
+    const SampleBuffer samples_a = val_a.toSamples();
+    const SampleBuffer samples_b = val_b.toSamples();
 
     int max_samples = qMax(samples_a.sample_count(), samples_b.sample_count());
     int min_samples = qMin(samples_a.sample_count(), samples_b.sample_count());
@@ -308,9 +341,7 @@ void MathNodeBase::ValueInternal(Operation operation, Pairing pairing, const QSt
 
     for (int i=0;i<mixed_samples.audio_params().channel_count();i++) {
       // Mix samples that are in both buffers
-      for (int j=0;j<min_samples;j++) {
-        mixed_samples.data(i)[j] = PerformAll<float, float>(operation, samples_a.data(i)[j], samples_b.data(i)[j]);
-      }
+      PerformAllOnFloatBuffers(operation, mixed_samples.data(i), samples_a.data(i), samples_b.data(i), min_samples);
     }
 
     if (max_samples > min_samples) {
@@ -427,23 +458,32 @@ void MathNodeBase::ValueInternal(Operation operation, Pairing pairing, const QSt
   }
 }
 
-void MathNodeBase::ProcessSamplesInternal(const NodeValueRow &values, MathNodeBase::Operation operation, const QString &param_a_in, const QString &param_b_in, const olive::SampleBuffer &input, olive::SampleBuffer &output, int index) const
+void MathNodeBase::ProcessSamplesInternal(const SampleAutomationRow &automation, MathNodeBase::Operation operation, const QString &param_a_in, const QString &param_b_in, const olive::SampleBuffer &input, olive::SampleBuffer &output) const
 {
   // This function is only used for sample+number pairing
-  NodeValue number_val = values[param_a_in];
+  SampleAutomation number = automation.value(param_a_in);
 
-  if (number_val.type() == NodeValue::kNone) {
-    number_val = values[param_b_in];
+  if (!number.IsValid()) {
+    number = automation.value(param_b_in);
 
-    if (number_val.type() == NodeValue::kNone) {
+    if (!number.IsValid()) {
       return;
     }
   }
 
-  float number_flt = RetrieveNumber(number_val);
+  int count = output.sample_count();
 
   for (int i=0;i<output.audio_params().channel_count();i++) {
-    output.data(i)[index] = PerformAll<float, float>(operation, input.data(i)[index], number_flt);
+    if (number.IsConstant()) {
+      memcpy(output.data(i), input.data(i), count * sizeof(float));
+#if defined(Q_PROCESSOR_X86) || defined(Q_PROCESSOR_ARM)
+      PerformAllOnFloatBufferSSE(operation, output.data(i), number.GetConstant(), 0, count);
+#else
+      PerformAllOnFloatBuffer(operation, output.data(i), number.GetConstant(), 0, count);
+#endif
+    } else {
+      PerformAllOnFloatBuffers(operation, output.data(i), input.data(i), number.data(), count);
+    }
   }
 }
 
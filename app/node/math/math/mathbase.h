@@ -101,6 +101,8 @@ protected:
 
   static void PerformAllOnFloatBuffer(Operation operation, float *a, float b, int start, int end);
 
+  static void PerformAllOnFloatBuffers(Operation operation, float *dst, const float *a, const float *b, int count);
+
 #if defined(Q_PROCESSOR_X86) || defined(Q_PROCESSOR_ARM)
   static void PerformAllOnFloatBufferSSE(Operation operation, float *a, float b, int start, int end);
 #endif
@@ -121,7 +123,7 @@ protected:
 
   void ValueInternal(Operation operation, Pairing pairing, const QString& param_a_in, const NodeValue &val_a, const QString& param_b_in, const NodeValue& val_b, const NodeGlobals &globals, NodeValueTable *output) const;
 
-  void ProcessSamplesInternal(const NodeValueRow &values, Operation operation, const QString& param_a_in, const QString& param_b_in, const SampleBuffer &input, SampleBuffer &output, int index) const;
+  void ProcessSamplesInternal(const SampleAutomationRow &automation, Operation operation, const QString& param_a_in, const QString& param_b_in, const SampleBuffer &input, SampleBuffer &output) const;
 
 };
 
@@ -49,7 +49,8 @@ Node::Node() :
   override_color_(-1),
   folder_(nullptr),
   cache_result_(false),
-  flags_(kNone)
+  flags_(kNone),
+  cache_identity_(nullptr)
 {
   AddInput(kEnabledInput, NodeValue::kBoolean, true);
 
@@ -927,6 +928,13 @@ void Node::Value(const NodeValueRow& value, const NodeGlobals &globals, NodeValu
   Q_UNUSED(table)
 }
 
+void Node::Hash(QCryptographicHash &hash, const TimeRange &range) const
+{
+  // Do nothing
+  Q_UNUSED(hash)
+  Q_UNUSED(range)
+}
+
 void Node::InvalidateCache(const TimeRange &range, const QString &from, int element, InvalidateCacheOptions options)
 {
   Q_UNUSED(from)
@@ -1510,7 +1518,12 @@ ShaderCode Node::GetShaderCode(const ShaderRequest &request) const
   return ShaderCode(QString(), QString());
 }
 
-void Node::ProcessSamples(const NodeValueRow &, const SampleBuffer &, SampleBuffer &, int) const
+QStringList Node::GetShaderIDs() const
+{
+  return QStringList();
+}
+
+void Node::ProcessSamples(const SampleAutomationRow &, const SampleBuffer &, SampleBuffer &) const
 {
 }
 
@@ -22,6 +22,7 @@
 #define NODE_H
 
 #include <map>
+#include <QCryptographicHash>
 #include <QMutex>
 #include <QObject>
 #include <QPainter>
@@ -130,6 +131,22 @@ public:
 
   Project* project() const;
 
+  /**
+   * @brief Node that long-lived render caches should key this node's state on
+   *
+   * Render snapshots point each copy at the node it was copied from, so cached state survives the
+   * copy being replaced by a newer snapshot. Defaults to the node itself.
+   */
+  const Node *cache_identity() const
+  {
+    return cache_identity_ ? cache_identity_ : this;
+  }
+
+  void set_cache_identity(const Node *n)
+  {
+    cache_identity_ = n;
+  }
+
   const uint64_t &GetFlags() const
   {
     return flags_;
@@ -696,9 +713,20 @@ public:
   virtual ShaderCode GetShaderCode(const ShaderRequest &request) const;
 
   /**
-   * @brief If Value() pushes a ShaderJob, this is the function that will process them.
+   * @brief IDs of the shaders this Node requests from GetShaderCode(), so they can be compiled early
+   *
+   * Defaults to none. Nodes that build IDs at runtime should leave out anything that can't be known
+   * up front, those shaders are compiled on first use instead.
    */
-  virtual void ProcessSamples(const NodeValueRow &values, const SampleBuffer &input, SampleBuffer &output, int index) const;
+  virtual QStringList GetShaderIDs() const;
+
+  /**
+   * @brief If Value() pushes a SampleJob, this is the function that will process them.
+   *
+   * Called once per block. Every value inserted into the job is provided in `automation`, already
+   * evaluated for each sample in the block (or as a single constant if it doesn't change).
+   */
+  virtual void ProcessSamples(const SampleAutomationRow &automation, const SampleBuffer &input, SampleBuffer &output) const;
 
   /**
    * @brief If Value() pushes a GenerateJob, override this function for the image to create
@@ -873,6 +901,15 @@ public:
    */
   virtual void Value(const NodeValueRow& value, const NodeGlobals &globals, NodeValueTable *table) const;
 
+  /**
+   * @brief Add anything that affects this node's output but isn't one of its input values
+   *
+   * Used to fingerprint frames so that identical frames can share one cached image. Input values
+   * and connections are already hashed by the caller, so only nodes whose output depends on the
+   * time itself or on data outside the graph (e.g. footage) need to override this.
+   */
+  virtual void Hash(QCryptographicHash &hash, const TimeRange &range) const;
+
   bool HasGizmos() const
   {
     return !gizmos_.isEmpty();
@@ -1396,6 +1433,8 @@ private:
 
   uint64_t flags_;
 
+  const Node *cache_identity_;
+
   QVector<NodeGizmo*> gizmos_;
 
   QString effect_input_;
@@ -38,11 +38,14 @@ const double Track::kTrackHeightInterval = 0.5;
 const QString Track::kBlockInput = QStringLiteral("block_in");
 const QString Track::kMutedInput = QStringLiteral("muted_in");
 
+QAtomicInt Track::next_audio_revision_ = 0;
+
 Track::Track() :
   track_type_(Track::kNone),
   index_(-1),
   locked_(false),
-  sequence_(nullptr)
+  sequence_(nullptr),
+  audio_revision_(next_audio_revision_.fetchAndAddOrdered(1))
 {
   AddInput(kBlockInput, NodeValue::kNone, InputFlags(kInputFlagArray | kInputFlagNotKeyframable | kInputFlagHidden));
 
@@ -200,7 +203,7 @@ void Track::InputConnectedEvent(const QString &input, int element, Node *output)
     connect(block, &Block::LengthChanged, this, &Track::BlockLengthChanged);
 
     // Invalidate cache now that block should have an in point
-    Node::InvalidateCache(TimeRange(block->in(), track_length()), kBlockInput);
+    InvalidateTrackCache(TimeRange(block->in(), track_length()), kBlockInput);
 
     // Emit block added signal
     emit BlockAdded(block);
@@ -257,7 +260,7 @@ void Track::InputDisconnectedEvent(const QString &input, int element, Node *outp
 
     disconnect(b, &Block::LengthChanged, this, &Track::BlockLengthChanged);
 
-    Node::InvalidateCache(invalidate_range, kBlockInput);
+    InvalidateTrackCache(invalidate_range, kBlockInput);
   }
 }
 
@@ -430,7 +433,7 @@ void Track::InvalidateCache(const TimeRange& range, const QString& from, int ele
   //       to keep it
   options.remove(QStringLiteral("lengthevent"));
 
-  Node::InvalidateCache(limited, from, element, options);
+  InvalidateTrackCache(limited, from, element, options);
 }
 
 void Track::InsertBlockBefore(Block* block, Block* after)
@@ -465,7 +468,7 @@ void Track::PrependBlock(Block *block)
   Node::ConnectEdge(block, NodeInput(this, kBlockInput, 0));
 
   // Everything has shifted at this point
-  Node::InvalidateCache(TimeRange(0, track_length()), kBlockInput);
+  InvalidateTrackCache(TimeRange(0, track_length()), kBlockInput);
 }
 
 void Track::InsertBlockAtIndex(Block *block, int index)
@@ -474,7 +477,7 @@ void Track::InsertBlockAtIndex(Block *block, int index)
   InputArrayInsert(kBlockInput, insert_index);
   Node::ConnectEdge(block, NodeInput(this, kBlockInput, insert_index));
 
-  Node::InvalidateCache(TimeRange(block->in(), track_length()), kBlockInput);
+  InvalidateTrackCache(TimeRange(block->in(), track_length()), kBlockInput);
 }
 
 void Track::AppendBlock(Block *block)
@@ -483,7 +486,7 @@ void Track::AppendBlock(Block *block)
   Node::ConnectEdge(block, NodeInput(this, kBlockInput, InputArraySize(kBlockInput) - 1));
 
   // Invalidate area that block was added to
-  Node::InvalidateCache(TimeRange(block->in(), block->out()), kBlockInput);
+  InvalidateTrackCache(TimeRange(block->in(), block->out()), kBlockInput);
 }
 
 void Track::RippleRemoveBlock(Block *block)
@@ -493,7 +496,7 @@ void Track::RippleRemoveBlock(Block *block)
 
   InputArrayRemove(kBlockInput, GetArrayIndexFromBlock(block));
 
-  Node::InvalidateCache(TimeRange(remove_in, qMax(track_length(), remove_out)), kBlockInput);
+  InvalidateTrackCache(TimeRange(remove_in, qMax(track_length(), remove_out)), kBlockInput);
 }
 
 void Track::ReplaceBlock(Block *old, Block *replace)
@@ -505,9 +508,9 @@ void Track::ReplaceBlock(Block *old, Block *replace)
   ConnectEdge(replace, NodeInput(this, kBlockInput, index_of_old_block));
 
   if (old->length() == replace->length()) {
-    Node::InvalidateCache(TimeRange(replace->in(), replace->out()), kBlockInput);
+    InvalidateTrackCache(TimeRange(replace->in(), replace->out()), kBlockInput);
   } else {
-    Node::InvalidateCache(TimeRange(replace->in(), track_length()), kBlockInput);
+    InvalidateTrackCache(TimeRange(replace->in(), track_length()), kBlockInput);
   }
 }
 
@@ -579,6 +582,14 @@ int Track::GetCacheIndexFromArrayIndex(int index) const
   return block_array_indexes_.indexOf(index);
 }
 
+void Track::InvalidateTrackCache(const TimeRange &range, const QString &from, int element, InvalidateCacheOptions options)
+{
+  // Take a revision no other track has used so stale audio can't match after a node is replaced
+  audio_revision_.storeRelease(next_audio_revision_.fetchAndAddOrdered(1));
+
+  Node::InvalidateCache(range, from, element, options);
+}
+
 void Track::BlockLengthChanged()
 {
   // Assumes sender is a Block
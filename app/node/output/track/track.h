@@ -21,6 +21,8 @@
 #ifndef TRACK_H
 #define TRACK_H
 
+#include <QAtomicInt>
+
 #include "node/block/block.h"
 #include "timeline/timelinecommon.h"
 
@@ -395,6 +397,25 @@ public:
 
   int GetArrayIndexFromBlock(Block* block) const;
 
+  /**
+   * @brief Value that changes whenever anything that affects this track's output is invalidated
+   *
+   * Revisions are unique across all tracks, so audio rendered from this track can be cached and
+   * later checked for staleness by comparing against the revision it was rendered at.
+   */
+  int audio_revision() const
+  {
+    return audio_revision_.loadAcquire();
+  }
+
+  /**
+   * @brief Used by render snapshots to mirror the revision of the node they were copied from
+   */
+  void set_audio_revision(int r)
+  {
+    audio_revision_.storeRelease(r);
+  }
+
   Sequence *sequence() const
   {
     return sequence_;
@@ -467,6 +488,8 @@ private:
 
   int GetCacheIndexFromArrayIndex(int index) const;
 
+  void InvalidateTrackCache(const TimeRange& range, const QString& from, int element = -1, InvalidateCacheOptions options = InvalidateCacheOptions());
+
   TimeRangeList block_length_pending_invalidations_;
 
   QVector<Block*> blocks_;
@@ -482,6 +505,10 @@ private:
 
   Sequence *sequence_;
 
+  QAtomicInt audio_revision_;
+
+  static QAtomicInt next_audio_revision_;
+
 private slots:
   void BlockLengthChanged();
 
@@ -299,6 +299,26 @@ void Footage::Value(const NodeValueRow &value, const NodeGlobals &globals, NodeV
   }
 }
 
+void Footage::Hash(QCryptographicHash &hash, const TimeRange &range) const
+{
+  // The file on disk may be replaced without the filename changing
+  hash.addData(QString::number(QFileInfo(filename()).lastModified().toMSecsSinceEpoch()).toUtf8());
+
+  // Identify which frame of each video stream would be shown at this time, for stills this is
+  // always the same frame
+  for (int i=0; i<GetTotalStreamCount(); i++) {
+    Track::Reference ref = GetReferenceFromRealIndex(i);
+
+    if (ref.type() == Track::kVideo) {
+      VideoParams vp = GetVideoParams(ref.index());
+
+      rational footage_time = AdjustTimeByLoopMode(range.in(), loop_mode(), GetLength(), vp.video_type(), vp.frame_rate_as_time_base());
+
+      hash.addData(footage_time.toString().toUtf8());
+    }
+  }
+}
+
 QString Footage::GetStreamTypeName(Track::Type type)
 {
   switch (type) {
@@ -177,6 +177,8 @@ public:
 
   virtual void Value(const NodeValueRow& value, const NodeGlobals &globals, NodeValueTable *table) const override;
 
+  virtual void Hash(QCryptographicHash &hash, const TimeRange &range) const override;
+
   static QString GetStreamTypeName(Track::Type type);
 
   virtual Node *GetConnectedTextureOutput() override;
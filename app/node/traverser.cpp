@@ -261,7 +261,8 @@ NodeValueTable NodeTraverser::ProcessInput(const Node* node, const QString& inpu
 NodeTraverser::NodeTraverser() :
   cancel_(nullptr),
   heard_cancel_(false),
-  transform_(nullptr)
+  transform_(nullptr),
+  next_origin_(0)
 {
 }
 
@@ -288,8 +289,34 @@ NodeValueTable NodeTraverser::GenerateTable(const Node *n, const TimeRange& rang
     return GenerateBlockTable(track, range);
   }
 
-  // FIXME: Cache certain values here if we've already processed them before
+  // A node that outputs to more than one input can be reached through several paths in the graph,
+  // so we cache its table to avoid processing its whole upstream graph again. Transform traversals
+  // rely on visiting the path node-by-node so they never use the cache.
+  bool can_memoize = !transform_ && n->output_connections().size() > 1;
+  MemoKey key = {n, range, GetCurrentBlock()};
+
+  if (can_memoize) {
+    auto it = table_memo_.find(key);
+    if (it != table_memo_.end()) {
+      NodeValueTable table = it.value();
+      if (ReleasePlannedUse(key)) {
+        table_memo_.erase(it);
+      }
+      return table;
+    }
+  }
+
+  NodeValueTable table = GenerateNodeTable(n, range, next_node);
 
+  if (can_memoize && !IsCancelled() && !ReleasePlannedUse(key)) {
+    table_memo_.insert(key, table);
+  }
+
+  return table;
+}
+
+NodeValueTable NodeTraverser::GenerateNodeTable(const Node *n, const TimeRange &range, const Node *next_node)
+{
   // Generate row for node
   NodeValueDatabase database = GenerateDatabase(n, range);
 
@@ -312,6 +339,13 @@ NodeValueTable NodeTraverser::GenerateTable(const Node *n, const TimeRange& rang
     NodeGlobals globals = GenerateGlobals(video_params_, range);
     n->Value(row, globals, &table);
 
+    // Give everything this node produced its own origin so copies of it can be recognized later
+    for (int i=0; i<table.Count(); i++) {
+      if (table.at(i).source() == n && !table.at(i).origin()) {
+        table[i].set_origin(++next_origin_);
+      }
+    }
+
     // `transform_now_` is the next node in the path that needs to be traversed. It only ever goes
     // "down" the graph so that any traversing going back up doesn't unnecessarily transform
     // from unrelated nodes or the same node twice
@@ -367,6 +401,25 @@ QVector2D NodeTraverser::GenerateResolution() const
 void NodeTraverser::ResolveJobs(NodeValue &val, const TimeRange &range)
 {
   if (val.type() == NodeValue::kTexture || val.type() == NodeValue::kSamples) {
+    // Copies of the same job resolved at the same time always give the same result, so if it's
+    // already been resolved through another path in this render, we can just re-use it
+    JobMemoKey key = {val.origin(), range, GetCurrentBlock()};
+
+    if (val.origin()) {
+      if (val.type() == NodeValue::kTexture) {
+        if (TexturePtr tex = texture_job_memo_.value(key).lock()) {
+          val.set_value(tex);
+          return;
+        }
+      } else {
+        auto it = job_memo_.constFind(key);
+        if (it != job_memo_.constEnd()) {
+          val.set_value(it.value());
+          return;
+        }
+      }
+    }
+
     if (val.canConvert<ShaderJob>()) {
 
       ShaderJob job = val.value<ShaderJob>();
@@ -486,6 +539,19 @@ void NodeTraverser::ResolveJobs(NodeValue &val, const TimeRange &range)
       ProcessSamples(output_buffer, val.source(), range, job);
       val.set_value(QVariant::fromValue(output_buffer));
 
+    } else {
+
+      // Not a job, nothing to resolve
+      return;
+
+    }
+
+    if (val.origin() && !IsCancelled()) {
+      if (val.type() == NodeValue::kTexture) {
+        texture_job_memo_.insert(key, val.toTexture());
+      } else {
+        job_memo_.insert(key, val.value<QVariant>());
+      }
     }
 
   }
@@ -509,4 +575,77 @@ TexturePtr NodeTraverser::CreateDummyTexture(const VideoParams &p)
   return std::make_shared<Texture>(p);
 }
 
+void NodeTraverser::ClearMemo()
+{
+  table_memo_.clear();
+  job_memo_.clear();
+  texture_job_memo_.clear();
+  planned_uses_.clear();
+}
+
+void NodeTraverser::PlanTraversal(const Node *n, const TimeRange &range)
+{
+  PlanTable(n, range, GetCurrentBlock());
+}
+
+void NodeTraverser::PlanTable(const Node *n, const TimeRange &range, const Block *block)
+{
+  // Mirrors the default traversal in GenerateTable(), GenerateBlockTable() and ProcessInput()
+  if (const Track *track = dynamic_cast<const Track*>(n)) {
+    if (Block *active_block = track->BlockAtTime(range.in())) {
+      PlanTable(active_block, Track::TransformRangeForBlock(active_block, range), active_block);
+    }
+    return;
+  }
+
+  if (n->output_connections().size() > 1) {
+    // Only the first visit traverses upstream, every later one is served from the memo
+    if (planned_uses_[{n, range, block}]++ > 0) {
+      return;
+    }
+  }
+
+  foreach (const QString &input, n->inputs()) {
+    if (n->IsInputConnected(input)) {
+      PlanTable(n->GetConnectedOutput(input), n->InputTimeAdjustment(input, -1, range), block);
+    } else if (n->InputIsArray(input)) {
+      int sz = n->InputArraySize(input);
+      for (int i=0; i<sz; i++) {
+        if (n->IsInputConnected(input, i)) {
+          PlanTable(n->GetConnectedOutput(input, i), n->InputTimeAdjustment(input, i, range), block);
+        }
+      }
+    }
+  }
+}
+
+bool NodeTraverser::ReleasePlannedUse(const MemoKey &key)
+{
+  auto it = planned_uses_.find(key);
+
+  if (it == planned_uses_.end()) {
+    // Not planned, keep it until the memo is cleared
+    return false;
+  }
+
+  it.value()--;
+
+  if (it.value() > 0) {
+    return false;
+  }
+
+  planned_uses_.erase(it);
+  return true;
+}
+
+uint qHash(const NodeTraverser::MemoKey &k, uint seed)
+{
+  return ::qHash(k.node, seed) ^ qHash(k.range, seed) ^ ::qHash(k.block, seed);
+}
+
+uint qHash(const NodeTraverser::JobMemoKey &k, uint seed)
+{
+  return ::qHash(k.origin, seed) ^ qHash(k.range, seed) ^ ::qHash(k.block, seed);
+}
+
 }
@@ -66,6 +66,7 @@ public:
   void SetCacheVideoParams(const VideoParams& params)
   {
     video_params_ = params;
+    ClearMemo();
   }
 
   const AudioParams& GetCacheAudioParams() const
@@ -76,12 +77,49 @@ public:
   void SetCacheAudioParams(const AudioParams& params)
   {
     audio_params_ = params;
+    ClearMemo();
   }
 
   static int GetChannelCountFromJob(const GenerateJob& job);
 
   static TexturePtr GetMainTextureFromJob(const GenerateJob& job);
 
+  /**
+   * @brief Key used to identify a node's output at a certain time for memoization
+   *
+   * The block is included because footage decoding depends on the block currently being traversed.
+   */
+  struct MemoKey
+  {
+    const Node *node;
+    TimeRange range;
+    const Block *block;
+
+    bool operator==(const MemoKey &rhs) const
+    {
+      return node == rhs.node && range == rhs.range && block == rhs.block;
+    }
+  };
+
+  /**
+   * @brief Key used to identify a job resolved for a certain time
+   *
+   * Jobs are identified by their value's origin rather than their source node, since the same node
+   * can produce different jobs at different times and nodes like TimeOffset pass those jobs through
+   * unchanged.
+   */
+  struct JobMemoKey
+  {
+    quint64 origin;
+    TimeRange range;
+    const Block *block;
+
+    bool operator==(const JobMemoKey &rhs) const
+    {
+      return origin == rhs.origin && range == rhs.range && block == rhs.block;
+    }
+  };
+
 protected:
   NodeValueTable ProcessInput(const Node *node, const QString &input, const TimeRange &range);
 
@@ -156,11 +194,29 @@ protected:
     return block_stack_.empty() ? nullptr : block_stack_.back();
   }
 
+  void ClearMemo();
+
+  /**
+   * @brief Count how many times each memoizable node will be reached when traversing from `n`
+   *
+   * Call this before GenerateTable() with the same node and range. Once a memoized table has been
+   * handed to its last planned consumer it's dropped from the memo, releasing any textures it
+   * references so they can be reused by the rest of the traversal rather than living until
+   * ClearMemo(). Nodes reached in ways the plan didn't predict simply stay memoized until then.
+   */
+  void PlanTraversal(const Node *n, const TimeRange &range);
+
 private:
   void PreProcessRow(const TimeRange &range, NodeValueRow &row);
 
+  NodeValueTable GenerateNodeTable(const Node *n, const TimeRange &range, const Node *next_node);
+
   TexturePtr CreateDummyTexture(const VideoParams &p);
 
+  void PlanTable(const Node *n, const TimeRange &range, const Block *block);
+
+  bool ReleasePlannedUse(const MemoKey &key);
+
   VideoParams video_params_;
 
   AudioParams audio_params_;
@@ -174,8 +230,27 @@ private:
 
   std::list<Block*> block_stack_;
 
+  QHash<MemoKey, NodeValueTable> table_memo_;
+
+  QHash<JobMemoKey, QVariant> job_memo_;
+
+  /**
+   * @brief Resolved textures, only kept alive by whatever is still using them
+   *
+   * Textures are large, so unlike other job results we don't keep them around after their last
+   * consumer has released them.
+   */
+  QHash<JobMemoKey, std::weak_ptr<Texture> > texture_job_memo_;
+
+  quint64 next_origin_;
+
+  QHash<MemoKey, int> planned_uses_;
+
 };
 
+uint qHash(const NodeTraverser::MemoKey &k, uint seed = 0);
+uint qHash(const NodeTraverser::JobMemoKey &k, uint seed = 0);
+
 }
 
 #endif // NODETRAVERSER_H
@@ -194,7 +194,8 @@ public:
   NodeValue() :
     type_(kNone),
     from_(nullptr),
-    array_(false)
+    array_(false),
+    origin_(0)
   {
   }
 
@@ -203,7 +204,8 @@ public:
     type_(type),
     from_(from),
     tag_(tag),
-    array_(array)
+    array_(array),
+    origin_(0)
   {
     set_value(data);
   }
@@ -246,6 +248,22 @@ public:
     return array_;
   }
 
+  /**
+   * @brief Identifies where in a traversal this value was produced
+   *
+   * Copies of a value (e.g. from a memoized table or a node passing its input through) share the
+   * same origin, so they're known to hold the same job. 0 means the origin is unknown.
+   */
+  quint64 origin() const
+  {
+    return origin_;
+  }
+
+  void set_origin(quint64 origin)
+  {
+    origin_ = origin;
+  }
+
   bool operator==(const NodeValue& rhs) const
   {
     return type_ == rhs.type_ && tag_ == rhs.tag_ && data_ == rhs.data_;
@@ -333,6 +351,7 @@ private:
   const Node* from_;
   QString tag_;
   bool array_;
+  quint64 origin_;
 
 };
 
@@ -388,6 +407,11 @@ public:
   {
     return values_.at(index);
   }
+  NodeValue &operator[](int index)
+  {
+    return values_[index];
+  }
+
   NodeValue TakeAt(int index)
   {
     return values_.takeAt(index);
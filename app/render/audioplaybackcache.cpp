@@ -31,6 +31,7 @@
 namespace olive {
 
 const qint64 AudioPlaybackCache::kDefaultSegmentSizePerChannel = 10 * 1024 * 1024;
+const rational AudioPlaybackCache::kDefaultReadAhead = rational(2);
 
 AudioPlaybackCache::AudioPlaybackCache(QObject* parent) :
   PlaybackCache(parent)
@@ -91,42 +92,34 @@ void AudioPlaybackCache::WritePCM(const TimeRange &range, const TimeRangeList &v
         rational this_write_out_point = qMin(r.out(), this_segment_out);
 
         for (int i=0; i<(*it).channels(); i++) {
-          QFile seg_file((*it).filename(i));
+          const SegmentFilePtr &seg_file = (*it).file(i);
 
-          if (seg_file.open(QFile::ReadWrite)) {
-            // Calculate what the byte offsets are going to be in this segment file
-            rational in_point_relative = this_write_in_point - this_segment_in;
-            qint64 dst_offset = params_.time_to_bytes_per_channel(in_point_relative);
+          // Calculate what the byte offsets are going to be in this segment file
+          rational in_point_relative = this_write_in_point - this_segment_in;
+          qint64 dst_offset = params_.time_to_bytes_per_channel(in_point_relative);
 
-            // Calculate where to retrieve data from in the source buffer
-            qint64 src_offset = params_.time_to_bytes_per_channel(this_write_in_point - range.in());
+          // Calculate where to retrieve data from in the source buffer
+          qint64 src_offset = params_.time_to_bytes_per_channel(this_write_in_point - range.in());
 
-            // Determine how many bytes need to be written
-            qint64 total_write_length = params_.time_to_bytes_per_channel(this_write_out_point - this_write_in_point);
+          // Determine how many bytes need to be written
+          qint64 total_write_length = params_.time_to_bytes_per_channel(this_write_out_point - this_write_in_point);
 
-            // Determine how many bytes we actually have in the source buffer
-            qint64 possible_write_length = qMin(qMax(qint64(0), buffer_size_per_channel - src_offset), total_write_length);
+          // Determine how many bytes we actually have in the source buffer
+          qint64 possible_write_length = qMin(qMax(qint64(0), buffer_size_per_channel - src_offset), total_write_length);
 
-            // Seek to our start offset
-            seg_file.seek(dst_offset);
-
-            // If we have source bytes to write, write them here
-            if (possible_write_length > 0) {
-              // Assume `samples` is valid if we're here, or else `buffer_size_per_channel` and
-              // therefore `possible_write_length` will be 0.
-              seg_file.write(reinterpret_cast<const char*>(samples.data(i)) + src_offset, possible_write_length);
-            }
-
-            if (possible_write_length < total_write_length) {
-              // Fill remaining space with silence
-              QByteArray s(total_write_length - possible_write_length, 0x00);
-              seg_file.write(s);
+          // If we have source bytes to write, write them here
+          if (possible_write_length > 0) {
+            // Assume `samples` is valid if we're here, or else `buffer_size_per_channel` and
+            // therefore `possible_write_length` will be 0.
+            if (seg_file->write(reinterpret_cast<const char*>(samples.data(i)) + src_offset, dst_offset, possible_write_length) < possible_write_length) {
+              qWarning() << "Failed to write PCM data to" << seg_file->filename();
+              succeeded = false;
             }
+          }
 
-            seg_file.close();
-          } else {
-            qWarning() << "Failed to write PCM data to" << seg_file.fileName();
-            succeeded = false;
+          if (possible_write_length < total_write_length) {
+            // Fill remaining space with silence
+            seg_file->fill(0x00, dst_offset + possible_write_length, total_write_length - possible_write_length);
           }
         }
 
@@ -176,12 +169,18 @@ AudioPlaybackCache::Segment AudioPlaybackCache::CloneSegment(const AudioPlayback
 
   new_seg.set_channels(s.channels());
 
-  // Copy data to a new file
+  // Copy only the data the segment uses to a new file
+  QByteArray buf(qMin(s.size(), kDefaultSegmentSizePerChannel), Qt::Uninitialized);
+
   for (int i=0; i<s.channels(); i++) {
-    QString new_filename = GenerateSegmentFilename();
-    QFile::copy(s.filename(i), new_filename);
+    SegmentFilePtr new_file = std::make_shared<SegmentFile>(GenerateSegmentFilename(), s.size());
 
-    new_seg.set_filename(i, new_filename);
+    for (qint64 j=0; j<s.size(); j+=buf.size()) {
+      qint64 len = s.file(i)->read(buf.data(), j, qMin(qint64(buf.size()), s.size() - j));
+      new_file->write(buf.constData(), j, len);
+    }
+
+    new_seg.set_file(i, new_file);
   }
 
   return new_seg;
@@ -194,17 +193,8 @@ AudioPlaybackCache::Segment AudioPlaybackCache::CreateSegment(const qint64 &size
   s.set_channels(params_.channel_count());
 
   for (int i=0; i<params_.channel_count(); i++) {
-    // Generate random unused filename for this segment
-    QString fn = GenerateSegmentFilename();
-
-    // Set it for this segment/channel
-    s.set_filename(i, fn);
-
-    // Create empty file
-    QFile f(fn);
-    if (f.open(QFile::WriteOnly)) {
-      f.close();
-    }
+    // Create a file with a random unused filename for this segment/channel
+    s.set_file(i, std::make_shared<SegmentFile>(GenerateSegmentFilename(), size));
   }
 
   s.set_offset(offset);
@@ -226,31 +216,6 @@ QString AudioPlaybackCache::GenerateSegmentFilename() const
   return new_seg_filename;
 }
 
-void AudioPlaybackCache::TrimSegmentIn(AudioPlaybackCache::Segment *s, qint64 new_length)
-{
-  // Read filename
-  for (int i=0; i<s->channels(); i++) {
-    QFile f(s->filename(i));
-    if (f.open(QFile::ReadWrite)) {
-      // Read segment into memory, according to the size we acknowledge
-      QByteArray data = f.read(s->size());
-
-      // Trim to new length
-      data = data.right(new_length);
-
-      // Seek to start and write
-      f.seek(0);
-
-      // Write trimmed data
-      f.write(data);
-
-      f.close();
-    }
-  }
-
-  s->set_size(new_length);
-}
-
 void AudioPlaybackCache::TrimSegmentOut(AudioPlaybackCache::Segment *s, qint64 new_length)
 {
   // For efficiency, we don't truncate the file, we just truncate our usage of it
@@ -259,20 +224,12 @@ void AudioPlaybackCache::TrimSegmentOut(AudioPlaybackCache::Segment *s, qint64 n
 
 void AudioPlaybackCache::RemoveSegmentFromArray(int index)
 {
-  const Segment &s = playlist_.at(index);
-  for (int i=0; i<s.channels(); i++) {
-    QFile::remove(s.filename(i));
-  }
+  // Files delete themselves once nothing refers to them anymore
   playlist_.removeAt(index);
 }
 
 void AudioPlaybackCache::ClearPlaylist()
 {
-  foreach (const Segment& s, playlist_) {
-    for (int i=0; i<s.channels(); i++) {
-      QFile::remove(s.filename(i));
-    }
-  }
   playlist_.clear();
 }
 
@@ -306,12 +263,100 @@ AudioPlaybackCache::PlaybackDevice *AudioPlaybackCache::CreatePlaybackDevice(QOb
     d->SetDataLimit(params_.time_to_bytes_per_channel(viewer->GetAudioLength()));
   }
 
+  d->SetReadAheadWindow(params_.time_to_bytes_per_channel(kDefaultReadAhead));
+
   return d;
 }
 
-AudioPlaybackCache::Segment::Segment(qint64 size)
+AudioPlaybackCache::SegmentFile::SegmentFile(const QString &filename, qint64 size) :
+  file_(filename),
+  map_(nullptr),
+  size_(size)
+{
+  if (!file_.open(QFile::ReadWrite)) {
+    qWarning() << "Failed to open audio cache segment" << filename;
+    size_ = 0;
+    return;
+  }
+
+  // Size the file up front so the whole segment can be mapped, most filesystems won't actually
+  // use the space until it's written to
+  if (file_.size() < size_) {
+    file_.resize(size_);
+  }
+
+  if (size_ > 0) {
+    map_ = file_.map(0, size_);
+  }
+}
+
+AudioPlaybackCache::SegmentFile::~SegmentFile()
+{
+  if (map_) {
+    file_.unmap(map_);
+  }
+
+  // Segments are volatile, so delete the file once nothing uses it
+  file_.remove();
+}
+
+qint64 AudioPlaybackCache::SegmentFile::read(char *data, qint64 offset, qint64 length)
+{
+  length = qMax(qint64(0), qMin(length, size_ - offset));
+
+  if (length == 0) {
+    return 0;
+  }
+
+  if (map_) {
+    memcpy(data, map_ + offset, length);
+    return length;
+  }
+
+  QMutexLocker locker(&mutex_);
+  file_.seek(offset);
+  return file_.read(data, length);
+}
+
+qint64 AudioPlaybackCache::SegmentFile::write(const char *data, qint64 offset, qint64 length)
+{
+  length = qMax(qint64(0), qMin(length, size_ - offset));
+
+  if (length == 0) {
+    return 0;
+  }
+
+  if (map_) {
+    memcpy(map_ + offset, data, length);
+    return length;
+  }
+
+  QMutexLocker locker(&mutex_);
+  file_.seek(offset);
+  return file_.write(data, length);
+}
+
+void AudioPlaybackCache::SegmentFile::fill(char c, qint64 offset, qint64 length)
+{
+  length = qMax(qint64(0), qMin(length, size_ - offset));
+
+  if (length == 0) {
+    return;
+  }
+
+  if (map_) {
+    memset(map_ + offset, c, length);
+  } else {
+    QMutexLocker locker(&mutex_);
+    file_.seek(offset);
+    file_.write(QByteArray(length, c));
+  }
+}
+
+AudioPlaybackCache::Segment::Segment(qint64 size) :
+  size_(size),
+  offset_(0)
 {
-  size_ = size;
 }
 
 AudioPlaybackCache::PlaybackDevice::PlaybackDevice(const AudioPlaybackCache::Playlist &playlist, int sample_sz, QObject *parent) :
@@ -320,15 +365,38 @@ AudioPlaybackCache::PlaybackDevice::PlaybackDevice(const AudioPlaybackCache::Pla
   current_segment_(0),
   segment_read_index_(0),
   sample_size_(sample_sz),
-  limit_(INT64_MAX)
+  limit_(INT64_MAX),
+  read_ahead_window_(0),
+  read_ahead_(nullptr)
 {
 }
 
 AudioPlaybackCache::PlaybackDevice::~PlaybackDevice()
 {
+  SetReadAheadWindow(0);
+
   close();
 }
 
+void AudioPlaybackCache::PlaybackDevice::SetReadAheadWindow(qint64 bytes_per_channel)
+{
+  read_ahead_window_ = bytes_per_channel;
+
+  if (read_ahead_window_ > 0) {
+    if (!read_ahead_) {
+      read_ahead_ = new ReadAheadThread(this);
+      read_ahead_->start(QThread::LowPriority);
+    }
+
+    UpdateReadAhead();
+  } else if (read_ahead_) {
+    read_ahead_->Stop();
+    read_ahead_->wait();
+    delete read_ahead_;
+    read_ahead_ = nullptr;
+  }
+}
+
 bool AudioPlaybackCache::PlaybackDevice::seek(qint64 pos)
 {
   // Default behavior
@@ -345,6 +413,8 @@ bool AudioPlaybackCache::PlaybackDevice::seek(qint64 pos)
   // Find position in segment
   segment_read_index_ = pos - playlist_.at(current_segment_).offset();
 
+  UpdateReadAhead();
+
   return true;
 }
 
@@ -352,6 +422,9 @@ qint64 AudioPlaybackCache::PlaybackDevice::readData(char *data, qint64 maxSize)
 {
   qint64 read_size = 0;
 
+  // Only used for segment files that couldn't be mapped
+  QByteArray fallback;
+
   while (read_size < maxSize
          && current_segment_ >= 0
          && current_segment_ < playlist_.size()
@@ -363,65 +436,51 @@ qint64 AudioPlaybackCache::PlaybackDevice::readData(char *data, qint64 maxSize)
       current_segment_sz = limit_ - cs.offset();
     }
 
-    QVector<QFile*> segment_files(cs.channels());
-    segment_files.fill(nullptr);
-
-    bool all_files_opened = true;
-
-    // Open all file handles
-    for (int i=0; i<cs.channels(); i++) {
-      QFile *f = new QFile(cs.filename(i));
-      segment_files[i] = f;
+    // Determine how many samples per channel to interleave from this segment
+    qint64 frame_sz = sample_size_ * cs.channels();
+    qint64 sample_count = qMin((current_segment_sz - segment_read_index_) / sample_size_, (maxSize - read_size) / frame_sz);
 
-      if (f->open(QFile::ReadOnly)) {
-        // Seek to our stored index of this segment
-        f->seek(segment_read_index_);
+    if (sample_count <= 0) {
+      if (current_segment_sz - segment_read_index_ < sample_size_) {
+        // Less than a sample left in this segment, move onto the next
+        segment_read_index_ = 0;
+        current_segment_++;
+        continue;
       } else {
-        all_files_opened = false;
+        // No room left for a whole frame
         break;
       }
     }
 
-    // If all file handles opened successfully, time to interleave and send them out
-    if (all_files_opened) {
-      // Determine how many bytes to read
-      qint64 this_read_length = qMin((current_segment_sz - segment_read_index_) * cs.channels(), maxSize - read_size);
-
-      qint64 target = read_size + this_read_length;
-
-      while (read_size < target) {
-        for (int i=0; i<cs.channels(); i++) {
-          QFile *segment_file = segment_files.at(i);
-
-          // Read those bytes
-          segment_file->read(data + read_size, sample_size_);
-
-          // Add to the read size
-          read_size += sample_size_;
-        }
+    for (int i=0; i<cs.channels(); i++) {
+      const SegmentFilePtr &f = cs.file(i);
+      const char *src = f->data();
 
-        // Add to the read index
-        segment_read_index_ += sample_size_;
+      if (src) {
+        src += segment_read_index_;
+      } else {
+        fallback.resize(sample_count * sample_size_);
+        fallback.fill(0);
+        f->read(fallback.data(), segment_read_index_, fallback.size());
+        src = fallback.constData();
       }
 
-      // If we've reached the end of this segment, tick the counter over to the next segment
-      if (segment_read_index_ == current_segment_sz) {
-        // Jump to the next file
-        segment_read_index_ = 0;
-        current_segment_++;
+      char *dst = data + read_size + i * sample_size_;
+      for (qint64 j=0; j<sample_count; j++) {
+        memcpy(dst, src, sample_size_);
+        src += sample_size_;
+        dst += frame_sz;
       }
     }
 
-    // Close and delete file handles
-    for (int i=0; i<cs.channels(); i++) {
-      QFile *f = segment_files.at(i);
+    read_size += sample_count * frame_sz;
+    segment_read_index_ += sample_count * sample_size_;
 
-      if (f) {
-        if (f->isOpen()) {
-          f->close();
-        }
-        delete f;
-      }
+    // If we've reached the end of this segment, tick the counter over to the next segment
+    if (segment_read_index_ == current_segment_sz) {
+      // Jump to the next file
+      segment_read_index_ = 0;
+      current_segment_++;
     }
   }
 
@@ -430,10 +489,115 @@ qint64 AudioPlaybackCache::PlaybackDevice::readData(char *data, qint64 maxSize)
     memset(data + read_size, 0, maxSize - read_size);
   }
 
+  UpdateReadAhead();
+
   //return read_size;
   return maxSize;
 }
 
+void AudioPlaybackCache::PlaybackDevice::UpdateReadAhead()
+{
+  if (read_ahead_ && current_segment_ >= 0 && current_segment_ < playlist_.size()) {
+    read_ahead_->SetPosition(playlist_.at(current_segment_).offset() + segment_read_index_);
+  }
+}
+
+void AudioPlaybackCache::PlaybackDevice::PageIn(qint64 from, qint64 to)
+{
+  static const qint64 kPageSize = 4096;
+
+  to = qMin(to, limit_);
+
+  // Touch each page so the OS reads it in now rather than when playback gets there
+  volatile char sink = 0;
+  QByteArray fallback;
+
+  for (int i=qMax(0, playlist_.GetIndexOfPosition(from)); i<playlist_.size(); i++) {
+    const Segment &s = playlist_.at(i);
+
+    if (s.offset() >= to) {
+      break;
+    }
+
+    qint64 start = qMax(from, s.offset()) - s.offset();
+    qint64 end = qMin(to, s.end()) - s.offset();
+
+    for (int j=0; j<s.channels(); j++) {
+      const SegmentFilePtr &f = s.file(j);
+
+      if (const char *d = f->data()) {
+        for (qint64 k=start; k<end; k+=kPageSize) {
+          sink = sink + d[k];
+        }
+      } else {
+        fallback.resize(end - start);
+        f->read(fallback.data(), start, fallback.size());
+      }
+    }
+  }
+
+  Q_UNUSED(sink)
+}
+
+AudioPlaybackCache::PlaybackDevice::ReadAheadThread::ReadAheadThread(PlaybackDevice *device) :
+  device_(device),
+  position_(-1),
+  stop_(false)
+{
+}
+
+void AudioPlaybackCache::PlaybackDevice::ReadAheadThread::SetPosition(qint64 pos)
+{
+  QMutexLocker locker(&mutex_);
+  position_ = pos;
+  wait_cond_.wakeAll();
+}
+
+void AudioPlaybackCache::PlaybackDevice::ReadAheadThread::Stop()
+{
+  QMutexLocker locker(&mutex_);
+  stop_ = true;
+  wait_cond_.wakeAll();
+}
+
+void AudioPlaybackCache::PlaybackDevice::ReadAheadThread::run()
+{
+  // Range that's already been paged in since the last seek
+  qint64 paged_from = -1;
+  qint64 paged_to = -1;
+
+  QMutexLocker locker(&mutex_);
+
+  while (!stop_) {
+    qint64 pos = position_;
+
+    if (pos >= 0) {
+      qint64 to = qMin(pos + device_->read_ahead_window_, device_->playlist_.GetLength());
+      qint64 from = pos;
+
+      if (pos >= paged_from && pos <= paged_to) {
+        // Continuing from where we were, only page in what's new
+        from = paged_to;
+      } else {
+        paged_from = pos;
+      }
+
+      if (to > from) {
+        locker.unlock();
+        device_->PageIn(from, to);
+        locker.relock();
+
+        paged_to = to;
+
+        // Position may have moved while we were paging, check again before sleeping
+        continue;
+      }
+    }
+
+    wait_cond_.wait(&mutex_);
+  }
+}
+
 int AudioPlaybackCache::Playlist::GetIndexOfPosition(qint64 pos)
 {
   if (this->isEmpty()
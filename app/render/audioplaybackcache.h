@@ -21,6 +21,12 @@
 #ifndef AUDIOPLAYBACKCACHE_H
 #define AUDIOPLAYBACKCACHE_H
 
+#include <memory>
+#include <QFile>
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+
 #include "audio/audiovisualwaveform.h"
 #include "common/timerange.h"
 #include "codec/samplebuffer.h"
@@ -50,6 +56,11 @@ namespace olive {
  * AudioPlaybackCache also provides a playback device (accessible from CreatePlaybackDevice()) that
  * acts identically to a file-based IO device, transparently joining segments together and acting
  * like one contiguous file.
+ *
+ * Segment files are sized up front and kept memory-mapped for as long as anything refers to them,
+ * so writing and playing back are plain memory copies rather than an open, seek and read per
+ * call. A file is only deleted once the last segment (including any playback device's copy of
+ * the playlist) referencing it is gone.
  */
 class AudioPlaybackCache : public PlaybackCache
 {
@@ -72,6 +83,54 @@ public:
 
   void WriteSilence(const TimeRange &range);
 
+  /**
+   * @brief One channel's file of a segment, memory-mapped while open
+   *
+   * Falls back to regular file IO if the file can't be mapped.
+   */
+  class SegmentFile
+  {
+  public:
+    SegmentFile(const QString &filename, qint64 size);
+
+    ~SegmentFile();
+
+    DISABLE_COPY_MOVE(SegmentFile)
+
+    QString filename() const
+    {
+      return file_.fileName();
+    }
+
+    qint64 size() const
+    {
+      return size_;
+    }
+
+    const char *data() const
+    {
+      return reinterpret_cast<const char*>(map_);
+    }
+
+    qint64 read(char *data, qint64 offset, qint64 length);
+
+    qint64 write(const char *data, qint64 offset, qint64 length);
+
+    void fill(char c, qint64 offset, qint64 length);
+
+  private:
+    QFile file_;
+
+    uchar *map_;
+
+    qint64 size_;
+
+    QMutex mutex_;
+
+  };
+
+  using SegmentFilePtr = std::shared_ptr<SegmentFile>;
+
   class Segment
   {
   public:
@@ -99,22 +158,27 @@ public:
 
     int channels() const
     {
-      return filenames_.size();
+      return files_.size();
     }
 
     void set_channels(int index)
     {
-      filenames_.resize(index);
+      files_.resize(index);
+    }
+
+    QString filename(int index) const
+    {
+      return files_.at(index)->filename();
     }
 
-    const QString& filename(int index) const
+    const SegmentFilePtr &file(int index) const
     {
-      return filenames_.at(index);
+      return files_.at(index);
     }
 
-    void set_filename(int index, const QString& filename)
+    void set_file(int index, const SegmentFilePtr &file)
     {
-      filenames_[index] = filename;
+      files_[index] = file;
     }
 
     qint64 end() const
@@ -123,7 +187,7 @@ public:
     }
 
   private:
-    QVector<QString> filenames_;
+    QVector<SegmentFilePtr> files_;
 
     qint64 size_;
 
@@ -152,6 +216,14 @@ public:
       limit_ = limit;
     }
 
+    /**
+     * @brief Set how many bytes per channel ahead of the read position are kept paged in
+     *
+     * Segment data is touched on a background thread ahead of playback so reads never have to
+     * wait on the disk (or network, if the cache directory is on one). Set to 0 to disable.
+     */
+    void SetReadAheadWindow(qint64 bytes_per_channel);
+
     virtual ~PlaybackDevice() override;
 
     virtual bool isSequential() const override
@@ -177,6 +249,35 @@ public:
     }
 
   private:
+    class ReadAheadThread : public QThread
+    {
+    public:
+      ReadAheadThread(PlaybackDevice *device);
+
+      void SetPosition(qint64 pos);
+
+      void Stop();
+
+    protected:
+      virtual void run() override;
+
+    private:
+      PlaybackDevice *device_;
+
+      QMutex mutex_;
+
+      QWaitCondition wait_cond_;
+
+      qint64 position_;
+
+      bool stop_;
+
+    };
+
+    void PageIn(qint64 from, qint64 to);
+
+    void UpdateReadAhead();
+
     Playlist playlist_;
 
     int current_segment_;
@@ -187,6 +288,10 @@ public:
 
     qint64 limit_;
 
+    qint64 read_ahead_window_;
+
+    ReadAheadThread *read_ahead_;
+
   };
 
   /**
@@ -211,14 +316,14 @@ signals:
 private:
   static const qint64 kDefaultSegmentSizePerChannel;
 
+  static const rational kDefaultReadAhead;
+
   Segment CloneSegment(const Segment& s) const;
 
   Segment CreateSegment(const qint64 &size, const qint64 &offset) const;
 
   QString GenerateSegmentFilename() const;
 
-  void TrimSegmentIn(Segment* s, qint64 new_length);
-
   void TrimSegmentOut(Segment* s, qint64 new_length);
 
   void RemoveSegmentFromArray(int index);
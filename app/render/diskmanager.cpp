@@ -242,6 +242,12 @@ void DiskCacheFolder::CreatedFile(const QString &filename)
 {
   qint64 file_size = QFile(filename).size();
 
+  // Packs are appended to repeatedly, so replace whatever size we had recorded before
+  auto existing = disk_data_.constFind(filename);
+  if (existing != disk_data_.constEnd()) {
+    consumption_ -= existing->file_size;
+  }
+
   disk_data_.insert(filename, {file_size, QDateTime::currentMSecsSinceEpoch()});
 
   consumption_ += file_size;
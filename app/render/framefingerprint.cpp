@@ -0,0 +1,158 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2022 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "framefingerprint.h"
+
+#include <QMatrix4x4>
+
+#include "node/color/colormanager/colormanager.h"
+#include "node/output/track/track.h"
+
+namespace olive {
+
+const QCryptographicHash::Algorithm FrameFingerprint::kAlgorithm = QCryptographicHash::Sha1;
+
+QByteArray FrameFingerprint::Generate(const Node *node, const TimeRange &range, const VideoParams &params, const ColorManager *color_manager)
+{
+  FrameFingerprint fp;
+  QCryptographicHash hash(kAlgorithm);
+
+  AddParams(hash, params);
+
+  if (node) {
+    fp.AddNode(hash, node, range);
+  } else {
+    hash.addData(QByteArrayLiteral("null"));
+  }
+
+  // The color config is part of the project graph but not upstream of the output
+  if (color_manager) {
+    fp.AddNode(hash, color_manager, range);
+  }
+
+  return hash.result();
+}
+
+void FrameFingerprint::AddNode(QCryptographicHash &hash, const Node *node, const TimeRange &range)
+{
+  QPair<const Node*, TimeRange> key(node, range);
+
+  auto it = memo_.constFind(key);
+  if (it != memo_.constEnd()) {
+    hash.addData(it.value());
+    return;
+  }
+
+  QCryptographicHash node_hash(kAlgorithm);
+
+  if (const Track *track = dynamic_cast<const Track*>(node)) {
+    // Tracks only ever follow the block at the in point, see NodeTraverser::GenerateBlockTable
+    Block *active_block = track->BlockAtTime(range.in());
+
+    if (active_block) {
+      AddNode(node_hash, active_block, Track::TransformRangeForBlock(active_block, range));
+    } else {
+      node_hash.addData(QByteArrayLiteral("empty"));
+    }
+  } else {
+    node_hash.addData(node->id().toUtf8());
+
+    foreach (const QString &input, node->inputs()) {
+      node_hash.addData(input.toUtf8());
+
+      if (!node->IsInputConnected(input) && node->InputIsArray(input)) {
+        int sz = node->InputArraySize(input);
+        node_hash.addData(QByteArray::number(sz));
+
+        for (int i=0; i<sz; i++) {
+          AddInput(node_hash, node, input, i, range);
+        }
+      } else {
+        AddInput(node_hash, node, input, -1, range);
+      }
+    }
+
+    node->Hash(node_hash, range);
+  }
+
+  QByteArray result = node_hash.result();
+  memo_.insert(key, result);
+  hash.addData(result);
+}
+
+void FrameFingerprint::AddInput(QCryptographicHash &hash, const Node *node, const QString &input, int element, const TimeRange &range)
+{
+  TimeRange adjusted_range = node->InputTimeAdjustment(input, element, range);
+
+  if (Node *output = node->GetConnectedOutput(input, element)) {
+    // Which value is pulled from the connected node's table depends on the hint
+    Node::ValueHint hint = node->GetValueHintForInput(input, element);
+    foreach (NodeValue::Type t, hint.types()) {
+      hash.addData(QByteArray::number(t));
+    }
+    hash.addData(QByteArray::number(hint.index()));
+    hash.addData(hint.tag().toUtf8());
+
+    AddNode(hash, output, adjusted_range);
+  } else {
+    NodeValue::Type type = node->GetInputDataType(input);
+    QVariant v = node->GetValueAtTime(input, adjusted_range.in(), element);
+
+    AddValue(hash, type, v, adjusted_range);
+  }
+}
+
+void FrameFingerprint::AddValue(QCryptographicHash &hash, NodeValue::Type type, const QVariant &value, const TimeRange &range)
+{
+  switch (type) {
+  case NodeValue::kMatrix:
+  {
+    QMatrix4x4 m = value.value<QMatrix4x4>();
+    hash.addData(reinterpret_cast<const char*>(m.constData()), 16 * sizeof(float));
+    break;
+  }
+  case NodeValue::kVideoParams:
+    AddParams(hash, value.value<VideoParams>());
+    break;
+  case NodeValue::kAudioParams:
+  case NodeValue::kSubtitleParams:
+    // No string representation for these, assume they're different at every time so that we never
+    // share frames that might not be the same
+    hash.addData(range.in().toString().toUtf8());
+    break;
+  default:
+    hash.addData(NodeValue::ValueToString(type, value, false).toUtf8());
+    break;
+  }
+}
+
+void FrameFingerprint::AddParams(QCryptographicHash &hash, const VideoParams &params)
+{
+  hash.addData(QStringLiteral("%1:%2:%3:%4:%5:%6:%7:%8").arg(QString::number(params.width()),
+                                                             QString::number(params.height()),
+                                                             QString::number(params.depth()),
+                                                             QString::number(params.format()),
+                                                             QString::number(params.channel_count()),
+                                                             params.pixel_aspect_ratio().toString(),
+                                                             QString::number(params.divider()),
+                                                             QString::number(params.interlacing())).toUtf8());
+}
+
+}
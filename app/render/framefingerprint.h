@@ -0,0 +1,73 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2022 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef FRAMEFINGERPRINT_H
+#define FRAMEFINGERPRINT_H
+
+#include <QCryptographicHash>
+#include <QHash>
+
+#include "node/node.h"
+#include "render/videoparams.h"
+
+namespace olive {
+
+class ColorManager;
+
+/**
+ * @brief Identifies the content of a frame without rendering it
+ *
+ * Walks the graph the same way NodeTraverser does, hashing every input value, connection and
+ * value hint at the times the traverser would evaluate them, plus anything nodes add through
+ * Node::Hash(). Two frames with the same fingerprint render to the same image, so the disk cache
+ * can store that image once and reference it from every time that produces it (e.g. a held title
+ * or still image).
+ */
+class FrameFingerprint
+{
+public:
+  /**
+   * @brief Generate a fingerprint for `node` rendered over `range` with these parameters
+   */
+  static QByteArray Generate(const Node *node, const TimeRange &range, const VideoParams &params, const ColorManager *color_manager);
+
+private:
+  FrameFingerprint() = default;
+
+  void AddNode(QCryptographicHash &hash, const Node *node, const TimeRange &range);
+
+  void AddInput(QCryptographicHash &hash, const Node *node, const QString &input, int element, const TimeRange &range);
+
+  static void AddValue(QCryptographicHash &hash, NodeValue::Type type, const QVariant &value, const TimeRange &range);
+
+  static void AddParams(QCryptographicHash &hash, const VideoParams &params);
+
+  /**
+   * @brief Digests of nodes already visited, a node reached through several paths is hashed once
+   */
+  QHash<QPair<const Node*, TimeRange>, QByteArray> memo_;
+
+  static const QCryptographicHash::Algorithm kAlgorithm;
+
+};
+
+}
+
+#endif // FRAMEFINGERPRINT_H
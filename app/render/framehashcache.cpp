@@ -25,19 +25,131 @@
 #include <OpenEXR/ImfHeader.h>
 #include <OpenEXR/ImfInputFile.h>
 #include <OpenEXR/ImfIntAttribute.h>
+#include <OpenEXR/ImfIO.h>
 #include <OpenEXR/ImfOutputFile.h>
 #include <OpenEXR/ImfChannelList.h>
 #include <QDir>
 #include <QFileInfo>
+#include <stdexcept>
+#include <utility>
 
 #include "codec/frame.h"
 #include "common/filefunctions.h"
 #include "render/diskmanager.h"
+#include "render/framepackfile.h"
 
 namespace olive {
 
 const QString FrameHashCache::kCacheFormatExtension = QStringLiteral(".exr");
 
+namespace {
+
+// OpenEXR 2.x uses Imath::Int64 for stream positions while 3.x uses uint64_t
+using ExrStreamPos = decltype(std::declval<Imf::OStream&>().tellp());
+
+/**
+ * @brief Lets OpenEXR encode into a memory buffer so the result can be appended to a pack
+ */
+class ByteArrayOStream : public Imf::OStream
+{
+public:
+  ByteArrayOStream(QByteArray *buffer) :
+    Imf::OStream("cache frame"),
+    buffer_(buffer),
+    pos_(0)
+  {
+  }
+
+  virtual void write(const char c[], int n) override
+  {
+    qint64 end = pos_ + n;
+    if (end > buffer_->size()) {
+      buffer_->resize(end);
+    }
+    memcpy(buffer_->data() + pos_, c, n);
+    pos_ = end;
+  }
+
+  virtual ExrStreamPos tellp() override
+  {
+    return pos_;
+  }
+
+  virtual void seekp(ExrStreamPos pos) override
+  {
+    pos_ = pos;
+  }
+
+private:
+  QByteArray *buffer_;
+
+  qint64 pos_;
+
+};
+
+/**
+ * @brief Lets OpenEXR decode straight out of a memory-mapped pack without an intermediate copy
+ */
+class MappedIStream : public Imf::IStream
+{
+public:
+  MappedIStream(const char *data, qint64 size) :
+    Imf::IStream("cache frame"),
+    data_(data),
+    size_(size),
+    pos_(0)
+  {
+  }
+
+  virtual bool isMemoryMapped() const override
+  {
+    return true;
+  }
+
+  virtual char *readMemoryMapped(int n) override
+  {
+    CheckRead(n);
+    char *p = const_cast<char*>(data_ + pos_);
+    pos_ += n;
+    return p;
+  }
+
+  virtual bool read(char c[], int n) override
+  {
+    CheckRead(n);
+    memcpy(c, data_ + pos_, n);
+    pos_ += n;
+    return pos_ < size_;
+  }
+
+  virtual ExrStreamPos tellg() override
+  {
+    return pos_;
+  }
+
+  virtual void seekg(ExrStreamPos pos) override
+  {
+    pos_ = pos;
+  }
+
+private:
+  void CheckRead(int n) const
+  {
+    if (pos_ + n > size_) {
+      throw std::runtime_error("Unexpected end of cached frame");
+    }
+  }
+
+  const char *data_;
+
+  qint64 size_;
+
+  qint64 pos_;
+
+};
+
+}
+
 #define super PlaybackCache
 
 FrameHashCache::FrameHashCache(QObject *parent) :
@@ -70,7 +182,7 @@ bool FrameHashCache::SaveCacheFrame(const int64_t &time, FramePtr frame) const
   return SaveCacheFrame(GetCacheDirectory(), GetUuid(), time, frame);
 }
 
-bool FrameHashCache::SaveCacheFrame(const QString &cache_path, const QUuid &uuid, const int64_t &time, FramePtr frame)
+bool FrameHashCache::SaveCacheFrame(const QString &cache_path, const QUuid &uuid, const int64_t &time, FramePtr frame, const QByteArray &fingerprint, uint64_t version)
 {
   if (cache_path.isEmpty()) {
     qWarning() << "Failed to save cache frame with empty path";
@@ -79,9 +191,19 @@ bool FrameHashCache::SaveCacheFrame(const QString &cache_path, const QUuid &uuid
 
   QString fn = CachePathName(cache_path, uuid, time);
 
-  bool ret = SaveCacheFrame(fn, frame);
+  // Ensure directory is created
+  if (!FileFunctions::DirectoryIsValid(QFileInfo(fn).dir())) {
+    return false;
+  }
 
-  // Register frame with the disk manager
+  QByteArray encoded;
+  if (!EncodeFrame(frame, &encoded)) {
+    return false;
+  }
+
+  bool ret = FramePackFile::Append(fn, time, encoded, fingerprint, version);
+
+  // Register (or re-measure) the pack with the disk manager
   if (ret) {
     QMetaObject::invokeMethod(DiskManager::instance(), "CreatedFile", Q_ARG(QString, cache_path), Q_ARG(QString, fn));
   }
@@ -89,18 +211,32 @@ bool FrameHashCache::SaveCacheFrame(const QString &cache_path, const QUuid &uuid
   return ret;
 }
 
-bool FrameHashCache::SaveCacheFrame(const QString &cache_path, const QUuid &uuid, const rational &time, const rational &tb, FramePtr frame)
+bool FrameHashCache::SaveCacheFrame(const QString &cache_path, const QUuid &uuid, const rational &time, const rational &tb, FramePtr frame, const QByteArray &fingerprint, uint64_t version)
 {
   if (cache_path.isEmpty()) {
     qWarning() << "Failed to save cache frame with empty path";
     return false;
   }
 
-  QString fn = CachePathName(cache_path, uuid, time, tb);
+  return SaveCacheFrame(cache_path, uuid, Timecode::time_to_timestamp(time, tb, Timecode::kRound), frame, fingerprint, version);
+}
 
-  bool ret = SaveCacheFrame(fn, frame);
+bool FrameHashCache::SaveCacheFrameReference(const QString &cache_path, const QUuid &uuid, const rational &time, const rational &tb, const QByteArray &fingerprint, uint64_t version)
+{
+  if (cache_path.isEmpty() || fingerprint.isEmpty()) {
+    return false;
+  }
+
+  int64_t timestamp = Timecode::time_to_timestamp(time, tb, Timecode::kRound);
+  QString fn = CachePathName(cache_path, uuid, timestamp);
+
+  // Ensure directory is created
+  if (!FileFunctions::DirectoryIsValid(QFileInfo(fn).dir())) {
+    return false;
+  }
+
+  bool ret = FramePackFile::AppendReference(fn, timestamp, fingerprint, version);
 
-  // Register frame with the disk manager
   if (ret) {
     QMetaObject::invokeMethod(DiskManager::instance(), "CreatedFile", Q_ARG(QString, cache_path), Q_ARG(QString, fn));
   }
@@ -120,7 +256,23 @@ FramePtr FrameHashCache::LoadCacheFrame(const QString &cache_path, const QUuid &
     return nullptr;
   }
 
-  return LoadCacheFrame(filename);
+  FramePackFile::Reader reader(filename, time);
+  if (!reader.IsValid()) {
+    if (reader.IsBrokenReference()) {
+      // The frame this one shared was evicted, delete the pack so these frames get invalidated
+      QMetaObject::invokeMethod(DiskManager::instance(), "DeleteSpecificFile", Q_ARG(QString, filename));
+    }
+    return nullptr;
+  }
+
+  FramePtr frame = DecodeFrame(reader.data(), reader.size());
+
+  if (!frame) {
+    // Assume this pack is corrupt in some way and delete it
+    QMetaObject::invokeMethod(DiskManager::instance(), "DeleteSpecificFile", Q_ARG(QString, filename));
+  }
+
+  return frame;
 }
 
 FramePtr FrameHashCache::LoadCacheFrame(const int64_t &hash) const
@@ -132,63 +284,84 @@ FramePtr FrameHashCache::LoadCacheFrame(const QString &fn)
 {
   FramePtr frame = nullptr;
 
-  if (!fn.isEmpty() && QFileInfo::exists(fn)) {
-    try {
-      Imf::InputFile file(fn.toUtf8(), 0);
+  QFile file(fn);
 
-      Imath::Box2i dw = file.header().dataWindow();
-      Imf::PixelType pix_type = file.header().channels().begin().channel().type;
-      int width = dw.max.x - dw.min.x + 1;
-      int height = dw.max.y - dw.min.y + 1;
-      bool has_alpha = file.header().channels().findChannel("A");
+  if (!fn.isEmpty() && file.open(QFile::ReadOnly)) {
+    qint64 sz = file.size();
+    uchar *map = file.map(0, sz);
 
-      int div = qMax(1, static_cast<const Imf::IntAttribute&>(file.header()["oliveDivider"]).value());
+    if (map) {
+      frame = DecodeFrame(reinterpret_cast<const char*>(map), sz);
+      file.unmap(map);
+    }
 
-      VideoParams::Format image_format;
-      if (pix_type == Imf::HALF) {
-        image_format = VideoParams::kFormatFloat16;
-      } else {
-        image_format = VideoParams::kFormatFloat32;
-      }
+    file.close();
 
-      int channel_count = has_alpha ? VideoParams::kRGBAChannelCount : VideoParams::kRGBChannelCount;
+    if (!frame) {
+      // Assume this frame is corrupt in some way and delete it
+      QMetaObject::invokeMethod(DiskManager::instance(), "DeleteSpecificFile", Q_ARG(QString, fn));
+    }
+  }
 
-      frame = Frame::Create();
-      frame->set_video_params(VideoParams(width * div,
-                                          height * div,
-                                          image_format,
-                                          channel_count,
-                                          rational::fromDouble(file.header().pixelAspectRatio()),
-                                          VideoParams::kInterlaceNone,
-                                          div));
+  return frame;
+}
 
-      frame->allocate();
+FramePtr FrameHashCache::DecodeFrame(const char *data, qint64 size)
+{
+  FramePtr frame = nullptr;
 
-      int bpc = VideoParams::GetBytesPerChannel(image_format);
+  try {
+    MappedIStream stream(data, size);
+    Imf::InputFile file(stream, 0);
+
+    Imath::Box2i dw = file.header().dataWindow();
+    Imf::PixelType pix_type = file.header().channels().begin().channel().type;
+    int width = dw.max.x - dw.min.x + 1;
+    int height = dw.max.y - dw.min.y + 1;
+    bool has_alpha = file.header().channels().findChannel("A");
+
+    int div = qMax(1, static_cast<const Imf::IntAttribute&>(file.header()["oliveDivider"]).value());
+
+    VideoParams::Format image_format;
+    if (pix_type == Imf::HALF) {
+      image_format = VideoParams::kFormatFloat16;
+    } else {
+      image_format = VideoParams::kFormatFloat32;
+    }
 
-      size_t xs = channel_count * bpc;
-      size_t ys = frame->linesize_bytes();
+    int channel_count = has_alpha ? VideoParams::kRGBAChannelCount : VideoParams::kRGBChannelCount;
 
-      Imf::FrameBuffer framebuffer;
-      framebuffer.insert("R", Imf::Slice(pix_type, frame->data(), xs, ys));
-      framebuffer.insert("G", Imf::Slice(pix_type, frame->data() + bpc, xs, ys));
-      framebuffer.insert("B", Imf::Slice(pix_type, frame->data() + 2*bpc, xs, ys));
-      if (has_alpha) {
-        framebuffer.insert("A", Imf::Slice(pix_type, frame->data() + 3*bpc, xs, ys));
-      }
+    frame = Frame::Create();
+    frame->set_video_params(VideoParams(width * div,
+                                        height * div,
+                                        image_format,
+                                        channel_count,
+                                        rational::fromDouble(file.header().pixelAspectRatio()),
+                                        VideoParams::kInterlaceNone,
+                                        div));
 
-      file.setFrameBuffer(framebuffer);
-      file.readPixels(dw.min.y, dw.max.y);
-    } catch (const std::exception &e) {
-      qCritical() << "Failed to read cache frame:" << e.what();
+    frame->allocate();
 
-      // Clear frame to signal that nothing was loaded
-      frame = nullptr;
+    int bpc = VideoParams::GetBytesPerChannel(image_format);
 
-      // Assume this frame is corrupt in some way and delete it
-      QMetaObject::invokeMethod(DiskManager::instance(), "DeleteSpecificFile", Q_ARG(QString, fn));
+    size_t xs = channel_count * bpc;
+    size_t ys = frame->linesize_bytes();
+
+    Imf::FrameBuffer framebuffer;
+    framebuffer.insert("R", Imf::Slice(pix_type, frame->data(), xs, ys));
+    framebuffer.insert("G", Imf::Slice(pix_type, frame->data() + bpc, xs, ys));
+    framebuffer.insert("B", Imf::Slice(pix_type, frame->data() + 2*bpc, xs, ys));
+    if (has_alpha) {
+      framebuffer.insert("A", Imf::Slice(pix_type, frame->data() + 3*bpc, xs, ys));
     }
 
+    file.setFrameBuffer(framebuffer);
+    file.readPixels(dw.min.y, dw.max.y);
+  } catch (const std::exception &e) {
+    qCritical() << "Failed to read cache frame:" << e.what();
+
+    // Clear frame to signal that nothing was loaded
+    frame = nullptr;
   }
 
   return frame;
@@ -206,6 +379,8 @@ int64_t FrameHashCache::ToTimestamp(const rational &ts, Timecode::Rounding round
 
 void FrameHashCache::HashDeleted(const QString& path, const QString &filename)
 {
+  FramePackFile::Forget(filename);
+
   QString cache_dir = GetCacheDirectory();
   if (cache_dir.isEmpty() || path != cache_dir) {
     return;
@@ -216,8 +391,18 @@ void FrameHashCache::HashDeleted(const QString& path, const QString &filename)
     return;
   }
 
-  int64_t timestamp = info.fileName().toLongLong();
-  Invalidate(TimeRange(ToTime(timestamp), ToTime(timestamp + 1)));
+  int64_t first, last;
+  if (!FramePackFile::GetPackRange(filename, &first, &last)) {
+    // Single frame file from an older cache
+    first = last = info.fileName().toLongLong();
+  }
+
+  Invalidate(TimeRange(ToTime(first), ToTime(last + 1)));
+
+  // Frames elsewhere that were stored as references to this pack are gone too
+  foreach (const int64_t &ts, FramePackFile::GetReferencesTo(filename)) {
+    Invalidate(TimeRange(ToTime(ts), ToTime(ts + 1)));
+  }
 }
 
 void FrameHashCache::ProjectInvalidated(Project *p)
@@ -239,7 +424,7 @@ QString FrameHashCache::CachePathName(const rational &time) const
 
 QString FrameHashCache::CachePathName(const QString &cache_path, const QUuid &cache_id, const int64_t &time)
 {
-  QString filename = QDir(QDir(cache_path).filePath(cache_id.toString())).filePath(QString::number(time));
+  QString filename = FramePackFile::GetPackFilename(QDir(cache_path).filePath(cache_id.toString()), time);
 
   // Register that in some way this hash has been accessed
   if (DiskManager::instance()) {
@@ -256,16 +441,32 @@ QString FrameHashCache::CachePathName(const QString &cache_path, const QUuid &ca
 
 bool FrameHashCache::SaveCacheFrame(const QString &filename, const FramePtr frame)
 {
-  if (!VideoParams::FormatIsFloat(frame->format())) {
-    return false;
-  }
-
   // Ensure directory is created
   QDir cache_dir = QFileInfo(filename).dir();
   if (!FileFunctions::DirectoryIsValid(cache_dir)) {
     return false;
   }
 
+  QByteArray encoded;
+  if (!EncodeFrame(frame, &encoded)) {
+    return false;
+  }
+
+  QFile f(filename);
+  if (!f.open(QFile::WriteOnly) || f.write(encoded) != encoded.size()) {
+    qCritical() << "Failed to write cache frame:" << filename;
+    return false;
+  }
+
+  return true;
+}
+
+bool FrameHashCache::EncodeFrame(const FramePtr frame, QByteArray *out)
+{
+  if (!VideoParams::FormatIsFloat(frame->format())) {
+    return false;
+  }
+
   // Floating point types are stored in EXR
   Imf::PixelType pix_type;
 
@@ -290,7 +491,8 @@ bool FrameHashCache::SaveCacheFrame(const QString &filename, const FramePtr fram
   header.insert("oliveDivider", Imf::IntAttribute(frame->video_params().divider()));
 
   try {
-    Imf::OutputFile out(filename.toUtf8(), header, 0);
+    ByteArrayOStream stream(out);
+    Imf::OutputFile exr(stream, header, 0);
 
     int bpc = VideoParams::GetBytesPerChannel(frame->format());
 
@@ -304,9 +506,9 @@ bool FrameHashCache::SaveCacheFrame(const QString &filename, const FramePtr fram
     if (frame->channel_count() == VideoParams::kRGBAChannelCount) {
       framebuffer.insert("A", Imf::Slice(pix_type, frame->data() + 3*bpc, xs, ys));
     }
-    out.setFrameBuffer(framebuffer);
+    exr.setFrameBuffer(framebuffer);
 
-    out.writePixels(frame->height());
+    exr.writePixels(frame->height());
 
     return true;
   } catch (const std::exception &e) {
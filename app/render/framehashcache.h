@@ -59,8 +59,16 @@ public:
 
   static bool SaveCacheFrame(const QString& filename, FramePtr frame);
   bool SaveCacheFrame(const int64_t &time, FramePtr frame) const;
-  static bool SaveCacheFrame(const QString& cache_path, const QUuid &uuid, const int64_t &time, FramePtr frame);
-  static bool SaveCacheFrame(const QString& cache_path, const QUuid &uuid, const rational &time, const rational &tb, FramePtr frame);
+  static bool SaveCacheFrame(const QString& cache_path, const QUuid &uuid, const int64_t &time, FramePtr frame, const QByteArray &fingerprint = QByteArray(), uint64_t version = 0);
+  static bool SaveCacheFrame(const QString& cache_path, const QUuid &uuid, const rational &time, const rational &tb, FramePtr frame, const QByteArray &fingerprint = QByteArray(), uint64_t version = 0);
+
+  /**
+   * @brief Cache the frame at `time` by referencing an already cached frame with the same fingerprint
+   *
+   * Returns false if no frame with this fingerprint has been cached, in which case it must be
+   * rendered and saved with SaveCacheFrame().
+   */
+  static bool SaveCacheFrameReference(const QString& cache_path, const QUuid &uuid, const rational &time, const rational &tb, const QByteArray &fingerprint, uint64_t version = 0);
   static FramePtr LoadCacheFrame(const QString& cache_path, const QUuid &uuid, const int64_t &time);
   FramePtr LoadCacheFrame(const int64_t &time) const;
   static FramePtr LoadCacheFrame(const QString& fn);
@@ -70,7 +78,17 @@ private:
   int64_t ToTimestamp(const rational &ts, Timecode::Rounding rounding = Timecode::kRound) const;
 
   /**
-   * @brief Return the path of the cached image at this time
+   * @brief Encode a frame as an in-memory EXR
+   */
+  static bool EncodeFrame(const FramePtr frame, QByteArray *out);
+
+  /**
+   * @brief Decode an in-memory EXR, returns nullptr if the data was corrupt
+   */
+  static FramePtr DecodeFrame(const char *data, qint64 size);
+
+  /**
+   * @brief Return the path of the pack file holding the cached image at this time
    */
   QString CachePathName(const int64_t &time) const;
   QString CachePathName(const rational &time) const;
@@ -0,0 +1,484 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2022 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "framepackfile.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QtEndian>
+
+namespace olive {
+
+const int64_t FramePackFile::kFramesPerPack = 32;
+const QString FramePackFile::kPackExtension = QStringLiteral("pack");
+const qint64 FramePackFile::kRecordHeaderSize = 24;
+const quint32 FramePackFile::kRecordMagic = 0x4D52464F; // "OFRM"
+const quint32 FramePackFile::kRecordFlagFingerprint = 0x1;
+const quint32 FramePackFile::kRecordFlagReference = 0x2;
+const quint32 FramePackFile::kRecordFlagDiscarded = 0x4;
+
+QMutex FramePackFile::mutex_;
+QHash<QString, FramePackFile::Index> FramePackFile::indices_;
+QHash<QString, QHash<QByteArray, FramePackFile::Location> > FramePackFile::fingerprints_;
+
+namespace {
+
+int64_t FloorDivide(int64_t a, int64_t b)
+{
+  int64_t d = a / b;
+  if ((a % b != 0) && ((a < 0) != (b < 0))) {
+    d--;
+  }
+  return d;
+}
+
+qint64 AlignRecord(qint64 size)
+{
+  return (size + 7) & ~qint64(7);
+}
+
+}
+
+QString FramePackFile::GetPackFilename(const QString &dir, const int64_t &timestamp)
+{
+  int64_t pack = FloorDivide(timestamp, kFramesPerPack);
+
+  return QDir(dir).filePath(QStringLiteral("%1.%2").arg(QString::number(pack), kPackExtension));
+}
+
+bool FramePackFile::GetPackRange(const QString &filename, int64_t *first, int64_t *last)
+{
+  QFileInfo info(filename);
+
+  if (info.suffix() != kPackExtension) {
+    return false;
+  }
+
+  bool ok;
+  int64_t pack = info.completeBaseName().toLongLong(&ok);
+  if (!ok) {
+    return false;
+  }
+
+  *first = pack * kFramesPerPack;
+  *last = *first + kFramesPerPack - 1;
+  return true;
+}
+
+bool FramePackFile::Append(const QString &filename, const int64_t &timestamp, const QByteArray &data, const QByteArray &fingerprint, uint64_t version)
+{
+  if (fingerprint.isEmpty()) {
+    return AppendRecord(filename, timestamp, version, 0, QByteArray(), data);
+  }
+
+  QByteArray prefix = EncodeFingerprint(fingerprint);
+
+  qint64 offset;
+  if (!AppendRecord(filename, timestamp, version, kRecordFlagFingerprint, prefix, data, &offset)) {
+    return false;
+  }
+
+  // Let later frames with the same content reference this record
+  QMutexLocker locker(&mutex_);
+  fingerprints_[QFileInfo(filename).path()].insert(fingerprint, {filename, timestamp, offset, prefix.size() + data.size()});
+
+  return true;
+}
+
+bool FramePackFile::AppendReference(const QString &filename, const int64_t &timestamp, const QByteArray &fingerprint, uint64_t version)
+{
+  Location target;
+
+  {
+    QMutexLocker locker(&mutex_);
+
+    const QHash<QByteArray, Location> &dir_fingerprints = fingerprints_[QFileInfo(filename).path()];
+    auto it = dir_fingerprints.constFind(fingerprint);
+    if (it == dir_fingerprints.constEnd()) {
+      return false;
+    }
+
+    target = it.value();
+  }
+
+  if (target.filename == filename && target.timestamp == timestamp) {
+    // This timestamp already holds the frame
+    return true;
+  }
+
+  if (!QFileInfo::exists(target.filename)) {
+    // Target was evicted, the frame will have to be rendered again
+    Forget(target.filename);
+    return false;
+  }
+
+  QByteArray ref(24, Qt::Uninitialized);
+  qToLittleEndian<qint64>(target.timestamp, ref.data());
+  qToLittleEndian<qint64>(target.offset, ref.data() + 8);
+  qToLittleEndian<qint64>(target.size, ref.data() + 16);
+  ref.append(EncodeFingerprint(fingerprint));
+
+  return AppendRecord(filename, timestamp, version, kRecordFlagReference, ref, QByteArray());
+}
+
+bool FramePackFile::AppendRecord(const QString &filename, const int64_t &timestamp, uint64_t version, quint32 flags, const QByteArray &prefix, const QByteArray &data, qint64 *offset_out)
+{
+  qint64 size = prefix.size() + data.size();
+  qint64 offset;
+
+  {
+    // Reserve our region of the file so other threads can append to the same pack concurrently
+    QMutexLocker locker(&mutex_);
+
+    Index &index = GetIndex(filename);
+    offset = index.end;
+    index.end += kRecordHeaderSize + AlignRecord(size);
+  }
+
+  char header[kRecordHeaderSize];
+  WriteRecordHeader(header, timestamp, size, flags);
+
+  QFile f(filename);
+  if (!f.open(QFile::ReadWrite)) {
+    qWarning() << "Failed to open cache pack for writing:" << filename;
+    return false;
+  }
+
+  static const char padding[8] = {0};
+
+  bool ok = f.seek(offset)
+      && f.write(header, kRecordHeaderSize) == kRecordHeaderSize
+      && f.write(prefix) == prefix.size()
+      && f.write(data) == data.size()
+      && f.write(padding, AlignRecord(size) - size) == AlignRecord(size) - size;
+
+  if (!ok) {
+    // Other threads may already have appended after our region, so it can't be truncated away.
+    // Mark it discarded instead so the next scan steps over it rather than stopping here.
+    WriteRecordHeader(header, timestamp, size, flags | kRecordFlagDiscarded);
+    if (f.seek(offset)) {
+      f.write(header, kRecordHeaderSize);
+    }
+    f.close();
+
+    qWarning() << "Failed to append frame to cache pack:" << filename;
+    return false;
+  }
+
+  // Only publish the record once it's fully on disk so readers never see a partial frame
+  QMutexLocker locker(&mutex_);
+  Index &index = GetIndex(filename);
+
+  auto existing = index.entries.constFind(timestamp);
+  if (existing != index.entries.constEnd() && existing->version > version) {
+    // A newer render of this timestamp finished before us, leave its record in place. Ours comes
+    // after it in the file, so discard it on disk too or the next scan would pick it back up.
+    WriteRecordHeader(header, timestamp, size, flags | kRecordFlagDiscarded);
+    if (!f.seek(offset) || f.write(header, kRecordHeaderSize) != kRecordHeaderSize) {
+      qWarning() << "Failed to discard stale frame in cache pack:" << filename;
+    }
+    return false;
+  }
+
+  f.close();
+
+  bool reference = (flags & kRecordFlagReference);
+  int64_t reference_timestamp = reference ? qFromLittleEndian<qint64>(prefix.constData()) : 0;
+  index.entries.insert(timestamp, {offset, size, version, reference, reference_timestamp});
+
+  if (offset_out) {
+    *offset_out = offset;
+  }
+
+  return true;
+}
+
+void FramePackFile::Forget(const QString &filename)
+{
+  QMutexLocker locker(&mutex_);
+  indices_.remove(filename);
+
+  // Nothing can reference records in this pack anymore
+  auto dir = fingerprints_.find(QFileInfo(filename).path());
+  if (dir != fingerprints_.end()) {
+    for (auto it=dir->begin(); it!=dir->end(); ) {
+      if (it->filename == filename) {
+        it = dir->erase(it);
+      } else {
+        it++;
+      }
+    }
+  }
+}
+
+QVector<int64_t> FramePackFile::GetReferencesTo(const QString &filename)
+{
+  QVector<int64_t> timestamps;
+
+  int64_t first, last;
+  if (!GetPackRange(filename, &first, &last)) {
+    return timestamps;
+  }
+
+  QDir dir = QFileInfo(filename).dir();
+  QStringList packs = dir.entryList({QStringLiteral("*.%1").arg(kPackExtension)}, QDir::Files);
+
+  QMutexLocker locker(&mutex_);
+
+  foreach (const QString &pack, packs) {
+    QString pack_filename = dir.filePath(pack);
+    if (pack_filename == filename) {
+      continue;
+    }
+
+    // Packs from earlier sessions may hold references too, so index any we haven't touched yet
+    const Index &index = GetIndex(pack_filename);
+    for (auto it=index.entries.cbegin(); it!=index.entries.cend(); it++) {
+      if (it->reference && it->reference_timestamp >= first && it->reference_timestamp <= last) {
+        timestamps.append(it.key());
+      }
+    }
+  }
+
+  return timestamps;
+}
+
+void FramePackFile::WriteRecordHeader(char *dst, const int64_t &timestamp, qint64 size, quint32 flags)
+{
+  qToLittleEndian<quint32>(kRecordMagic, dst);
+  qToLittleEndian<quint32>(flags, dst + 4);
+  qToLittleEndian<qint64>(timestamp, dst + 8);
+  qToLittleEndian<qint64>(size, dst + 16);
+}
+
+bool FramePackFile::ReadRecordHeader(const uchar *src, int64_t *timestamp, qint64 *size, quint32 *flags)
+{
+  if (qFromLittleEndian<quint32>(src) != kRecordMagic) {
+    return false;
+  }
+
+  if (flags) {
+    *flags = qFromLittleEndian<quint32>(src + 4);
+  }
+  *timestamp = qFromLittleEndian<qint64>(src + 8);
+  *size = qFromLittleEndian<qint64>(src + 16);
+
+  return *size >= 0;
+}
+
+QByteArray FramePackFile::EncodeFingerprint(const QByteArray &fingerprint)
+{
+  QByteArray encoded(8 + AlignRecord(fingerprint.size()), 0);
+  qToLittleEndian<qint64>(fingerprint.size(), encoded.data());
+  memcpy(encoded.data() + 8, fingerprint.constData(), fingerprint.size());
+  return encoded;
+}
+
+qint64 FramePackFile::DecodeFingerprint(const uchar *src, qint64 size, QByteArray *fingerprint)
+{
+  if (size < 8) {
+    return -1;
+  }
+
+  qint64 len = qFromLittleEndian<qint64>(src);
+  if (len < 0 || 8 + AlignRecord(len) > size) {
+    return -1;
+  }
+
+  *fingerprint = QByteArray(reinterpret_cast<const char*>(src + 8), len);
+  return 8 + AlignRecord(len);
+}
+
+FramePackFile::Index &FramePackFile::GetIndex(const QString &filename)
+{
+  auto it = indices_.find(filename);
+  if (it != indices_.end()) {
+    return it.value();
+  }
+
+  Index &index = indices_[filename];
+
+  QFile f(filename);
+  if (f.open(QFile::ReadOnly) && f.size() > 0) {
+    qint64 file_size = f.size();
+    uchar *map = f.map(0, file_size);
+
+    if (map) {
+      // Walk records until we hit the end of the file or a torn tail, which the next append will
+      // simply overwrite
+      QString dir = QFileInfo(filename).path();
+      qint64 pos = 0;
+      qint64 end = 0;
+      while (pos + kRecordHeaderSize <= file_size) {
+        int64_t ts;
+        qint64 sz;
+        quint32 flags;
+        if (!ReadRecordHeader(map + pos, &ts, &sz, &flags)) {
+          // Not a record, e.g. the region of an append that failed before writing anything (or
+          // that went into a pack deleted underneath its index). Records are 8-byte aligned, so
+          // look for the next one.
+          pos += 8;
+          continue;
+        }
+
+        if (pos + kRecordHeaderSize + sz > file_size) {
+          break;
+        }
+
+        if (flags & kRecordFlagDiscarded) {
+          pos += kRecordHeaderSize + AlignRecord(sz);
+          end = pos;
+          continue;
+        }
+
+        bool reference = (flags & kRecordFlagReference) && sz >= 8;
+        int64_t reference_timestamp = reference ? qFromLittleEndian<qint64>(map + pos + kRecordHeaderSize) : 0;
+        index.entries.insert(ts, {pos, sz, 0, reference, reference_timestamp});
+
+        // Frames cached in an earlier session can still be referenced
+        QByteArray fingerprint;
+        if ((flags & kRecordFlagFingerprint)
+            && DecodeFingerprint(map + pos + kRecordHeaderSize, sz, &fingerprint) != -1) {
+          fingerprints_[dir].insert(fingerprint, {filename, ts, pos, sz});
+        }
+
+        pos += kRecordHeaderSize + AlignRecord(sz);
+        end = pos;
+      }
+
+      index.end = end;
+
+      f.unmap(map);
+    }
+  }
+
+  return index;
+}
+
+FramePackFile::Reader::Reader(const QString &filename, const int64_t &timestamp) :
+  map_(nullptr),
+  data_(nullptr),
+  size_(0),
+  broken_reference_(false)
+{
+  Entry entry;
+
+  {
+    QMutexLocker locker(&mutex_);
+
+    const Index &index = GetIndex(filename);
+    auto it = index.entries.constFind(timestamp);
+    if (it == index.entries.constEnd()) {
+      return;
+    }
+
+    entry = it.value();
+  }
+
+  file_.setFileName(filename);
+  if (!file_.open(QFile::ReadOnly)) {
+    return;
+  }
+
+  map_ = file_.map(entry.offset, kRecordHeaderSize + entry.size);
+  if (!map_) {
+    return;
+  }
+
+  // Make sure the pack wasn't replaced underneath our index
+  int64_t ts;
+  qint64 sz;
+  quint32 flags;
+  if (!ReadRecordHeader(map_, &ts, &sz, &flags) || ts != timestamp || sz != entry.size) {
+    return;
+  }
+
+  const uchar *payload = map_ + kRecordHeaderSize;
+
+  if (flags & kRecordFlagReference) {
+    // Follow the reference to the record that actually holds the frame
+    QByteArray fingerprint;
+    if (sz < 24 || DecodeFingerprint(payload + 24, sz - 24, &fingerprint) == -1) {
+      return;
+    }
+
+    int64_t target_ts = qFromLittleEndian<qint64>(payload);
+    qint64 target_offset = qFromLittleEndian<qint64>(payload + 8);
+    qint64 target_size = qFromLittleEndian<qint64>(payload + 16);
+
+    file_.unmap(map_);
+    map_ = nullptr;
+    file_.close();
+
+    // Assume the target is gone until we've verified it
+    broken_reference_ = true;
+
+    file_.setFileName(GetPackFilename(QFileInfo(filename).path(), target_ts));
+    if (!file_.open(QFile::ReadOnly)
+        || file_.size() < target_offset + kRecordHeaderSize + target_size) {
+      return;
+    }
+
+    map_ = file_.map(target_offset, kRecordHeaderSize + target_size);
+    if (!map_) {
+      return;
+    }
+
+    // The target pack may have been evicted and rewritten since, so only accept a record that
+    // still has the same content
+    QByteArray target_fingerprint;
+    qint64 fingerprint_size;
+    if (!ReadRecordHeader(map_, &ts, &sz, &flags)
+        || ts != target_ts
+        || sz != target_size
+        || !(flags & kRecordFlagFingerprint)
+        || (fingerprint_size = DecodeFingerprint(map_ + kRecordHeaderSize, sz, &target_fingerprint)) == -1
+        || target_fingerprint != fingerprint) {
+      return;
+    }
+
+    broken_reference_ = false;
+    payload = map_ + kRecordHeaderSize + fingerprint_size;
+    sz -= fingerprint_size;
+  } else if (flags & kRecordFlagFingerprint) {
+    // Skip past the fingerprint to the frame
+    QByteArray fingerprint;
+    qint64 fingerprint_size = DecodeFingerprint(payload, sz, &fingerprint);
+    if (fingerprint_size == -1) {
+      return;
+    }
+
+    payload += fingerprint_size;
+    sz -= fingerprint_size;
+  }
+
+  data_ = reinterpret_cast<const char*>(payload);
+  size_ = sz;
+}
+
+FramePackFile::Reader::~Reader()
+{
+  if (map_) {
+    file_.unmap(map_);
+  }
+}
+
+}
@@ -0,0 +1,245 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2022 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef FRAMEPACKFILE_H
+#define FRAMEPACKFILE_H
+
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QVector>
+
+#include "common/define.h"
+
+namespace olive {
+
+/**
+ * @brief Append-only container holding many encoded cache frames in a single file
+ *
+ * Rather than writing one file per cached frame, the disk cache groups consecutive timestamps
+ * into "pack" files. Each frame is appended as a small fixed-size record header followed by its
+ * encoded bytes. Pack files are self-describing, so the offset index is rebuilt lazily by scanning
+ * the records the first time a pack is touched in this session and kept in memory afterwards.
+ *
+ * Re-caching a timestamp appends a new record that supersedes the old one. The stale bytes are
+ * reclaimed when the whole pack is evicted by the DiskManager, which tracks packs rather than
+ * frames.
+ *
+ * Records may carry a fingerprint of the frame's content (see FrameFingerprint). A later frame with
+ * the same fingerprint can then be stored as a small reference record pointing at the first one,
+ * in any pack of the same directory, instead of being rendered and encoded again.
+ *
+ * All functions are thread-safe.
+ */
+class FramePackFile
+{
+public:
+  /**
+   * @brief Number of consecutive timestamps stored in each pack
+   */
+  static const int64_t kFramesPerPack;
+
+  static const QString kPackExtension;
+
+  /**
+   * @brief Return the pack filename inside `dir` that holds `timestamp`
+   */
+  static QString GetPackFilename(const QString &dir, const int64_t &timestamp);
+
+  /**
+   * @brief If `filename` is a pack, return true and set the range of timestamps it covers
+   */
+  static bool GetPackRange(const QString &filename, int64_t *first, int64_t *last);
+
+  /**
+   * @brief Append an encoded frame for `timestamp` to the pack at `filename`
+   *
+   * The pack is created if it doesn't exist. Concurrent appends to the same pack reserve their own
+   * region, so encoding and writing never holds the index lock.
+   *
+   * If a record with a higher `version` has already been appended for `timestamp` in this session,
+   * the frame is stale and it's discarded, returning false.
+   */
+  static bool Append(const QString &filename, const int64_t &timestamp, const QByteArray &data, const QByteArray &fingerprint = QByteArray(), uint64_t version = 0);
+
+  /**
+   * @brief Store `timestamp` as a reference to an existing record with the same fingerprint
+   *
+   * Returns false if no record with this fingerprint is known in the pack's directory, in which
+   * case the frame needs to be rendered and appended with Append().
+   */
+  static bool AppendReference(const QString &filename, const int64_t &timestamp, const QByteArray &fingerprint, uint64_t version = 0);
+
+  /**
+   * @brief Drop any in-memory index for this pack, e.g. because it was deleted from disk
+   */
+  static void Forget(const QString &filename);
+
+  /**
+   * @brief Find timestamps in other packs of the same directory stored as references into `filename`
+   *
+   * Those frames can't be loaded anymore once `filename` is deleted.
+   */
+  static QVector<int64_t> GetReferencesTo(const QString &filename);
+
+  /**
+   * @brief Memory-maps a single frame record out of a pack for as long as this object lives
+   */
+  class Reader
+  {
+  public:
+    Reader(const QString &filename, const int64_t &timestamp);
+
+    ~Reader();
+
+    DISABLE_COPY_MOVE(Reader)
+
+    bool IsValid() const
+    {
+      return data_;
+    }
+
+    /**
+     * @brief Returns true if the record was a reference whose target no longer exists
+     */
+    bool IsBrokenReference() const
+    {
+      return broken_reference_;
+    }
+
+    const char *data() const
+    {
+      return data_;
+    }
+
+    qint64 size() const
+    {
+      return size_;
+    }
+
+  private:
+    QFile file_;
+
+    uchar *map_;
+
+    const char *data_;
+
+    qint64 size_;
+
+    bool broken_reference_;
+
+  };
+
+private:
+  struct Entry
+  {
+    qint64 offset;
+    qint64 size;
+
+    /// Version the record was appended with, records found on disk are always the oldest
+    uint64_t version;
+
+    /// If the record is a reference, the timestamp of the record it points at
+    bool reference;
+    int64_t reference_timestamp;
+  };
+
+  struct Index
+  {
+    QHash<int64_t, Entry> entries;
+    qint64 end = 0;
+  };
+
+  /**
+   * @brief Where the record for a fingerprint lives
+   */
+  struct Location
+  {
+    QString filename;
+    int64_t timestamp;
+    qint64 offset;
+    qint64 size;
+  };
+
+  /**
+   * @brief Fixed size of each record header, keeps frame data 8-byte aligned in the file
+   */
+  static const qint64 kRecordHeaderSize;
+
+  static const quint32 kRecordMagic;
+
+  /**
+   * @brief Record data starts with the fingerprint of the frame
+   */
+  static const quint32 kRecordFlagFingerprint;
+
+  /**
+   * @brief Record data is the location and fingerprint of another record rather than a frame
+   */
+  static const quint32 kRecordFlagReference;
+
+  /**
+   * @brief Record was never completely written and holds nothing, scanning steps over it
+   */
+  static const quint32 kRecordFlagDiscarded;
+
+  static bool AppendRecord(const QString &filename, const int64_t &timestamp, uint64_t version, quint32 flags, const QByteArray &prefix, const QByteArray &data, qint64 *offset_out = nullptr);
+
+  static void WriteRecordHeader(char *dst, const int64_t &timestamp, qint64 size, quint32 flags);
+
+  static bool ReadRecordHeader(const uchar *src, int64_t *timestamp, qint64 *size, quint32 *flags = nullptr);
+
+  /**
+   * @brief Serialize a fingerprint, padded so whatever follows stays 8-byte aligned
+   */
+  static QByteArray EncodeFingerprint(const QByteArray &fingerprint);
+
+  /**
+   * @brief Read a fingerprint written by EncodeFingerprint(), returns the number of bytes used or -1
+   */
+  static qint64 DecodeFingerprint(const uchar *src, qint64 size, QByteArray *fingerprint);
+
+  /**
+   * @brief Retrieve index for a pack, scanning it from disk if necessary
+   *
+   * Assumes `mutex_` is held by the caller.
+   */
+  static Index &GetIndex(const QString &filename);
+
+  static QMutex mutex_;
+
+  /**
+   * @brief Index of every pack touched this session
+   *
+   * This is also how we know a pack exists without asking the filesystem, since the DiskManager
+   * calls Forget() for every pack it deletes.
+   */
+  static QHash<QString, Index> indices_;
+
+  /**
+   * @brief Known fingerprinted records per cache directory
+   */
+  static QHash<QString, QHash<QByteArray, Location> > fingerprints_;
+
+};
+
+}
+
+#endif // FRAMEPACKFILE_H
@@ -59,6 +59,23 @@ public:
   TexturePtr GetInputTexture() const { return input_texture_; }
   void SetInputTexture(TexturePtr tex) { input_texture_ = tex; }
 
+  /**
+   * @brief Treat the input texture as the luma plane of a planar YUV image
+   *
+   * `matrix` converts (Y, U, V, 1) sampled from the three planes to (R, G, B, 1) before the color
+   * transform is applied.
+   */
+  void SetInputYUVPlanes(TexturePtr u, TexturePtr v, const QMatrix4x4 &matrix)
+  {
+    input_u_texture_ = u;
+    input_v_texture_ = v;
+    yuv_matrix_ = matrix;
+  }
+  bool IsInputYUV() const { return input_u_texture_ && input_v_texture_; }
+  TexturePtr GetInputUTexture() const { return input_u_texture_; }
+  TexturePtr GetInputVTexture() const { return input_v_texture_; }
+  const QMatrix4x4 &GetYUVMatrix() const { return yuv_matrix_; }
+
   ColorProcessorPtr GetColorProcessor() const { return processor_; }
   void SetColorProcessor(ColorProcessorPtr p) { processor_ = p; }
 
@@ -91,6 +108,10 @@ private:
 
   TexturePtr input_texture_;
 
+  TexturePtr input_u_texture_;
+  TexturePtr input_v_texture_;
+  QMatrix4x4 yuv_matrix_;
+
   const Node *custom_shader_src_;
   QString custom_shader_id_;
 
@@ -26,6 +26,59 @@
 
 namespace olive {
 
+/**
+ * @brief A SampleJob input evaluated once across a whole block of samples
+ *
+ * Holds either a single value for inputs that don't change over the block, or one value per
+ * sample so kernels can run over the block without touching the node graph.
+ */
+class SampleAutomation
+{
+public:
+  SampleAutomation() = default;
+
+  explicit SampleAutomation(float constant) :
+    values_({constant})
+  {
+  }
+
+  explicit SampleAutomation(const QVector<float> &per_sample) :
+    values_(per_sample)
+  {
+  }
+
+  bool IsValid() const
+  {
+    return !values_.isEmpty();
+  }
+
+  bool IsConstant() const
+  {
+    return values_.size() == 1;
+  }
+
+  float GetConstant() const
+  {
+    return values_.first();
+  }
+
+  float at(int index) const
+  {
+    return IsConstant() ? values_.first() : values_.at(index);
+  }
+
+  const float *data() const
+  {
+    return values_.constData();
+  }
+
+private:
+  QVector<float> values_;
+
+};
+
+using SampleAutomationRow = QHash<QString, SampleAutomation>;
+
 class SampleJob : public AcceleratedJob {
 public:
   SampleJob()
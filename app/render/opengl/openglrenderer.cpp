@@ -21,13 +21,18 @@
 #include "openglrenderer.h"
 
 #include <iostream>
+#include <QCryptographicHash>
 #include <QDateTime>
 #include <QDebug>
+#include <QDir>
 #include <QOpenGLExtraFunctions>
+#include <QSaveFile>
+#include <QStandardPaths>
 
 namespace olive {
 
 const int OpenGLRenderer::kTextureCacheMaxSize = 5000;
+const int OpenGLRenderer::kUploadBufferCount = 3;
 
 const QVector<GLfloat> blit_vertices = {
   -1.0f, -1.0f, 0.0f,
@@ -86,7 +91,9 @@ OpenGLRenderer::OpenGLRenderer(QObject* parent) :
   Renderer(parent),
   cache_timer_(this),
   context_(nullptr),
-  framebuffer_(0)
+  framebuffer_(0),
+  program_binaries_supported_(false),
+  next_upload_buffer_(0)
 {
   cache_timer_.setInterval(kTextureCacheMaxSize);
   connect(&cache_timer_, &QTimer::timeout, this, &OpenGLRenderer::GarbageCollectTextureCache);
@@ -157,6 +164,22 @@ void OpenGLRenderer::PostInit()
   // Set up framebuffer used for various things
   functions_->glGenFramebuffers(1, &framebuffer_);
 
+  // Compiled programs can be stored and reloaded in later sessions if the driver supports it
+  GLint binary_formats = 0;
+  if (context_->isOpenGLES()
+      || context_->format().version() >= qMakePair(4, 1)
+      || context_->hasExtension(QByteArrayLiteral("GL_ARB_get_program_binary"))) {
+    functions_->glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binary_formats);
+  }
+  program_binaries_supported_ = (binary_formats > 0);
+
+  // Binaries are only valid for the driver that created them
+  driver_id_.clear();
+  for (GLenum e : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+    driver_id_.append(reinterpret_cast<const char*>(functions_->glGetString(e)));
+    driver_id_.append('\n');
+  }
+
   cache_timer_.start();
 }
 
@@ -170,10 +193,28 @@ void OpenGLRenderer::DestroyInternal()
     framebuffer_ = 0;
 
     for (auto it=texture_cache_.cbegin(); it!=texture_cache_.cend(); it++) {
-      functions_->glDeleteTextures(1, &it->texture);
+      foreach (const TextureCacheEntry &entry, it.value()) {
+        functions_->glDeleteTextures(1, &entry.texture);
+      }
     }
     texture_cache_.clear();
 
+    // Delete pixel buffers
+    for (auto it=download_buffers_.cbegin(); it!=download_buffers_.cend(); it++) {
+      if (it->fence) {
+        context_->extraFunctions()->glDeleteSync(it->fence);
+      }
+      functions_->glDeleteBuffers(1, &it->buffer);
+    }
+    download_buffers_.clear();
+
+    for (auto it=upload_buffers_.cbegin(); it!=upload_buffers_.cend(); it++) {
+      functions_->glDeleteBuffers(1, &it->buffer);
+    }
+    upload_buffers_.clear();
+
+    program_info_.clear();
+
     // Delete context if it belongs to us
     if (context_->parent() == this) {
       delete context_;
@@ -271,7 +312,7 @@ void OpenGLRenderer::DestroyNativeTexture(QVariant texture)
     TextureCacheKey key = texture_params_.value(t);
     TextureCacheEntry entry = {key, t, QDateTime::currentMSecsSinceEpoch()};
 
-    texture_cache_.append(entry);
+    texture_cache_[key].append(entry);
   }
 }
 
@@ -281,8 +322,22 @@ QVariant OpenGLRenderer::CreateNativeShader(ShaderCode code)
 
   PRINT_GL_ERRORS;
 
-  GLuint vert = CompileShader(GL_VERTEX_SHADER, code.vert_code());
-  GLuint frag = CompileShader(GL_FRAGMENT_SHADER, code.frag_code());
+  QString vert_code = GetCompleteShaderCode(GL_VERTEX_SHADER, code.vert_code());
+  QString frag_code = GetCompleteShaderCode(GL_FRAGMENT_SHADER, code.frag_code());
+
+  // Skip compiling entirely if this program was already built in an earlier session
+  QString binary_filename;
+  if (program_binaries_supported_) {
+    binary_filename = GetProgramBinaryFilename(vert_code, frag_code);
+
+    if (GLuint stored = LoadProgramBinary(binary_filename)) {
+      program_info_.insert(stored, ReflectProgram(stored));
+      return stored;
+    }
+  }
+
+  GLuint vert = CompileShader(GL_VERTEX_SHADER, vert_code);
+  GLuint frag = CompileShader(GL_FRAGMENT_SHADER, frag_code);
 
   GLuint program = 0;
 
@@ -290,6 +345,11 @@ QVariant OpenGLRenderer::CreateNativeShader(ShaderCode code)
     program = functions_->glCreateProgram();
     functions_->glAttachShader(program, frag);
     functions_->glAttachShader(program, vert);
+
+    if (program_binaries_supported_) {
+      context_->extraFunctions()->glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
     functions_->glLinkProgram(program);
 
     GLint success;
@@ -298,6 +358,12 @@ QVariant OpenGLRenderer::CreateNativeShader(ShaderCode code)
       qWarning() << "Failed to link OpenGL shader program";
       functions_->glDeleteProgram(program);
       program = 0;
+    } else {
+      program_info_.insert(program, ReflectProgram(program));
+
+      if (!binary_filename.isEmpty()) {
+        SaveProgramBinary(program, binary_filename);
+      }
     }
   }
 
@@ -312,6 +378,7 @@ void OpenGLRenderer::DestroyNativeShader(QVariant shader)
   GL_PREAMBLE;
 
   GLuint program = shader.value<GLuint>();
+  program_info_.remove(program);
   functions_->glDeleteProgram(program);
 }
 
@@ -337,10 +404,14 @@ void OpenGLRenderer::UploadToTexture(Texture *texture, const void *data, int lin
     PRINT_GL_ERRORS;
 
     if (texture->type() == Texture::k2D) {
+      const void *staged = StageUpload(data, linesize, p.effective_width(), p.effective_height(), p.format(), p.channel_count());
+
       functions_->glTexSubImage2D(tex_type, 0, 0, 0,
                                   p.effective_width(), p.effective_height(),
                                   GetPixelFormat(p.channel_count()), GetPixelType(p.format()),
-                                  data);
+                                  staged);
+
+      FinishUpload(staged);
     } else {
       context_->extraFunctions()->glTexSubImage3D(tex_type, 0, 0, 0, 0,
                                                   p.effective_width(), p.effective_height(), p.effective_depth(),
@@ -385,6 +456,140 @@ void OpenGLRenderer::DownloadFromTexture(Texture* texture, void *data, int lines
   functions_->glBindTexture(GL_TEXTURE_2D, current_tex);
 }
 
+QVariant OpenGLRenderer::StartDownloadFromTexture(Texture *texture)
+{
+  GL_PREAMBLE;
+
+  const VideoParams& p = texture->params();
+  int bytes_per_pixel = p.GetBytesPerPixel();
+  GLsizeiptr required_size = GLsizeiptr(p.effective_width()) * p.effective_height() * bytes_per_pixel;
+
+  // Find a pixel buffer that isn't waiting to be read, or create one if they're all in use
+  int index = -1;
+  for (int i=0; i<download_buffers_.size(); i++) {
+    if (!download_buffers_.at(i).in_use) {
+      index = i;
+      break;
+    }
+  }
+
+  if (index == -1) {
+    PixelBuffer pb = {0, 0, nullptr, 0, 0, 0, false};
+    functions_->glGenBuffers(1, &pb.buffer);
+    download_buffers_.append(pb);
+    index = download_buffers_.size() - 1;
+  }
+
+  PixelBuffer &pb = download_buffers_[index];
+
+  functions_->glBindBuffer(GL_PIXEL_PACK_BUFFER, pb.buffer);
+
+  if (pb.size < required_size) {
+    functions_->glBufferData(GL_PIXEL_PACK_BUFFER, required_size, nullptr, GL_STREAM_READ);
+    pb.size = required_size;
+  }
+
+  GLint current_tex;
+  functions_->glGetIntegerv(GL_TEXTURE_BINDING_2D, &current_tex);
+
+  AttachTextureAsDestination(texture);
+
+  // Read tightly packed so the buffer size is predictable, rows are spaced out when the buffer is
+  // copied to its destination
+  functions_->glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+  {
+    PRINT_GL_ERRORS;
+
+    // With a pack buffer bound, this returns immediately and the GPU writes into the buffer
+    // whenever it's finished rendering the texture
+    functions_->glReadPixels(0,
+                             0,
+                             p.effective_width(),
+                             p.effective_height(),
+                             GetPixelFormat(p.channel_count()),
+                             GetPixelType(p.format()),
+                             nullptr);
+  }
+
+  functions_->glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+  DetachTextureAsDestination();
+
+  functions_->glBindTexture(GL_TEXTURE_2D, current_tex);
+
+  functions_->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  pb.fence = context_->extraFunctions()->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  pb.width = p.effective_width();
+  pb.height = p.effective_height();
+  pb.bytes_per_pixel = bytes_per_pixel;
+  pb.in_use = true;
+
+  // Make sure the GPU actually starts working on the read
+  functions_->glFlush();
+
+  return index;
+}
+
+bool OpenGLRenderer::FinishDownloadFromTexture(QVariant download, void *data, int linesize)
+{
+  GL_PREAMBLE;
+
+  bool ok;
+  int index = download.toInt(&ok);
+
+  if (!ok || index < 0 || index >= download_buffers_.size() || !download_buffers_.at(index).in_use) {
+    qWarning() << "Tried to finish invalid download";
+    return true;
+  }
+
+  PixelBuffer &pb = download_buffers_[index];
+
+  QOpenGLExtraFunctions *xf = context_->extraFunctions();
+
+  // Only poll so that we never hold up other work submitted to this thread while the GPU is still
+  // busy, the caller will try again later
+  GLenum wait = xf->glClientWaitSync(pb.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+  if (wait == GL_TIMEOUT_EXPIRED) {
+    return false;
+  }
+
+  xf->glDeleteSync(pb.fence);
+  pb.fence = nullptr;
+
+  if (wait != GL_WAIT_FAILED) {
+    functions_->glBindBuffer(GL_PIXEL_PACK_BUFFER, pb.buffer);
+
+    GLsizeiptr row_size = GLsizeiptr(pb.width) * pb.bytes_per_pixel;
+
+    if (const char *mapped = static_cast<const char*>(xf->glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, row_size * pb.height, GL_MAP_READ_BIT))) {
+      char *dst = static_cast<char*>(data);
+      int dst_row_size = (linesize ? linesize : pb.width) * pb.bytes_per_pixel;
+
+      if (dst_row_size == row_size) {
+        memcpy(dst, mapped, row_size * pb.height);
+      } else {
+        for (int y=0; y<pb.height; y++) {
+          memcpy(dst + y * dst_row_size, mapped + y * row_size, row_size);
+        }
+      }
+
+      xf->glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    } else {
+      qWarning() << "Failed to map pixel buffer for download";
+    }
+
+    functions_->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  } else {
+    qWarning() << "Failed to wait for download to complete";
+  }
+
+  pb.in_use = false;
+
+  return true;
+}
+
 void OpenGLRenderer::Flush()
 {
   GL_PREAMBLE;
@@ -429,14 +634,18 @@ void OpenGLRenderer::Blit(QVariant s, ShaderJob job, Texture *destination, Video
 
   functions_->glUseProgram(shader);
 
+  const ProgramInfo &program = GetProgramInfo(shader);
+
   for (auto it=job.GetValues().constBegin(); it!=job.GetValues().constEnd(); it++) {
     // See if the shader has takes this parameter as an input
-    GLint variable_location = functions_->glGetUniformLocation(shader, it.key().toUtf8().constData());
+    auto uniform = program.uniforms.constFind(it.key());
 
-    if (variable_location == -1) {
+    if (uniform == program.uniforms.constEnd()) {
       continue;
     }
 
+    GLint variable_location = uniform->location;
+
     // This variable is used in the shader, let's set it
     const NodeValue& value = it.value();
 
@@ -499,10 +708,9 @@ void OpenGLRenderer::Blit(QVariant s, ShaderJob job, Texture *destination, Video
       textures_to_bind.append({texture, job.GetInterpolation(it.key())});
 
       // Set enable flag if shader wants it
-      GLuint tex_id = texture ? texture->id().value<GLuint>() : 0;
-      int enable_param_location = functions_->glGetUniformLocation(shader, QStringLiteral("%1_enabled").arg(it.key()).toUtf8().constData());
-      if (enable_param_location > -1) {
-        functions_->glUniform1i(enable_param_location, tex_id > 0);
+      if (uniform->enabled_location > -1) {
+        GLuint tex_id = texture ? texture->id().value<GLuint>() : 0;
+        functions_->glUniform1i(uniform->enabled_location, tex_id > 0);
       }
       break;
     }
@@ -546,9 +754,8 @@ void OpenGLRenderer::Blit(QVariant s, ShaderJob job, Texture *destination, Video
   }
 
   // Ensure matrix is set, at least to identity
-  GLint mvpmat_location = functions_->glGetUniformLocation(shader, "ove_mvpmat");
-  if (mvpmat_location > -1) {
-    functions_->glUniformMatrix4fv(mvpmat_location, 1, false, job.Get(QStringLiteral("ove_mvpmat")).toMatrix().constData());
+  if (program.mvpmat_location > -1) {
+    functions_->glUniformMatrix4fv(program.mvpmat_location, 1, false, job.Get(QStringLiteral("ove_mvpmat")).toMatrix().constData());
   }
 
   // Set the viewport to the "physical" resolution of the destination
@@ -580,7 +787,7 @@ void OpenGLRenderer::Blit(QVariant s, ShaderJob job, Texture *destination, Video
   frag_vbo_.allocate(blit_texcoords.constData(), blit_texcoords.size() * sizeof(GLfloat));
   frag_vbo_.release();
 
-  GLint vertex_location = functions_->glGetAttribLocation(shader, "a_position");
+  GLint vertex_location = program.vertex_location;
   if (vertex_location != -1) {
     vert_vbo_.bind();
     functions_->glEnableVertexAttribArray(vertex_location);
@@ -588,7 +795,7 @@ void OpenGLRenderer::Blit(QVariant s, ShaderJob job, Texture *destination, Video
     vert_vbo_.release();
   }
 
-  GLint tex_location = functions_->glGetAttribLocation(shader, "a_texcoord");
+  GLint tex_location = program.texcoord_location;
   if (tex_location != -1) {
     frag_vbo_.bind();
     functions_->glEnableVertexAttribArray(tex_location);
@@ -620,7 +827,7 @@ void OpenGLRenderer::Blit(QVariant s, ShaderJob job, Texture *destination, Video
     }
   }
 
-  GLint iteration_location = functions_->glGetUniformLocation(shader, "ove_iteration");
+  GLint iteration_location = program.iteration_location;
   for (int iteration=0; iteration<real_iteration_count; iteration++) {
     // Set iteration number
     if (iteration_location > -1) {
@@ -837,16 +1044,21 @@ QVariant OpenGLRenderer::CreateNativeTexture2DInternal(int width, int height, Vi
 
     {
       PRINT_GL_ERRORS;
+
+      const void *staged = StageUpload(data, linesize, width, height, format, channel_count);
+
       if (new_tex) {
         functions_->glTexImage2D(GL_TEXTURE_2D, 0, GetInternalFormat(format, channel_count),
                                  width, height, 0, GetPixelFormat(channel_count),
-                                 GetPixelType(format), data);
+                                 GetPixelType(format), staged);
       } else {
         functions_->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0,
                                     width, height,
                                     GetPixelFormat(channel_count), GetPixelType(format),
-                                    data);
+                                    staged);
       }
+
+      FinishUpload(staged);
     }
 
     functions_->glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
@@ -866,22 +1078,83 @@ GLuint OpenGLRenderer::GetCachedTexture(int width, int height, int depth, VideoP
 {
   TextureCacheKey input_key = {width, height, depth, format, channel_count};
 
-  for (int i=0; i<texture_cache_.size(); i++) {
-    const TextureCacheEntry &entry = texture_cache_.at(i);
+  auto it = texture_cache_.find(input_key);
 
-    if (entry.key == input_key) {
-      GLuint t = entry.texture;
+  if (it == texture_cache_.end()) {
+    return 0;
+  }
+
+  // Prefer the most recently released texture, it's the most likely to still be resident
+  QVector<TextureCacheEntry> &bucket = it.value();
+  GLuint t = bucket.last().texture;
+  bucket.removeLast();
 
-      texture_cache_.removeAt(i);
+  if (bucket.isEmpty()) {
+    texture_cache_.erase(it);
+  }
 
-      return t;
+  return t;
+}
+
+const void *OpenGLRenderer::StageUpload(const void *data, int linesize, int width, int height, VideoParams::Format format, int channel_count)
+{
+  if (!data) {
+    return nullptr;
+  }
+
+  // Rows are read using the default unpack alignment of 4
+  int bytes_per_pixel = VideoParams::GetBytesPerPixel(format, channel_count);
+  GLsizeiptr row_size = GLsizeiptr(linesize ? linesize : width) * bytes_per_pixel;
+  row_size = (row_size + 3) & ~GLsizeiptr(3);
+  GLsizeiptr copy_size = row_size * (height - 1) + GLsizeiptr(width) * bytes_per_pixel;
+
+  // Cycle through a few buffers so we're unlikely to write to one the GPU is still reading
+  if (upload_buffers_.isEmpty()) {
+    upload_buffers_.resize(kUploadBufferCount);
+    for (int i=0; i<upload_buffers_.size(); i++) {
+      PixelBuffer &pb = upload_buffers_[i];
+      pb = {0, 0, nullptr, 0, 0, 0, false};
+      functions_->glGenBuffers(1, &pb.buffer);
     }
   }
 
-  return 0;
+  PixelBuffer &pb = upload_buffers_[next_upload_buffer_];
+  next_upload_buffer_ = (next_upload_buffer_ + 1) % upload_buffers_.size();
+
+  functions_->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pb.buffer);
+
+  if (pb.size < copy_size) {
+    functions_->glBufferData(GL_PIXEL_UNPACK_BUFFER, copy_size, nullptr, GL_STREAM_DRAW);
+    pb.size = copy_size;
+  }
+
+  // Invalidating lets the driver hand us fresh memory rather than waiting for any previous
+  // transfer from this buffer to finish
+  void *mapped = context_->extraFunctions()->glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, copy_size,
+                                                             GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+  if (!mapped) {
+    // Fall back to uploading from client memory
+    functions_->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return data;
+  }
+
+  memcpy(mapped, data, copy_size);
+
+  context_->extraFunctions()->glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+  // Texture functions now read from offset 0 of the bound buffer
+  return nullptr;
+}
+
+void OpenGLRenderer::FinishUpload(const void *staged)
+{
+  if (!staged) {
+    // Either nothing was uploaded, or it was uploaded from an unpack buffer
+    functions_->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  }
 }
 
-GLuint OpenGLRenderer::CompileShader(GLenum type, const QString &code)
+QString OpenGLRenderer::GetCompleteShaderCode(GLenum type, const QString &code)
 {
   static const QString shader_preamble =
       // Use appropriate GL 3.2 shader header
@@ -905,6 +1178,11 @@ GLuint OpenGLRenderer::CompileShader(GLenum type, const QString &code)
     complete_code.append(code);
   }
 
+  return complete_code;
+}
+
+GLuint OpenGLRenderer::CompileShader(GLenum type, const QString &complete_code)
+{
   QByteArray code_utf8 = complete_code.toUtf8();
   const char *code_cstr = code_utf8.constData();
 
@@ -928,17 +1206,161 @@ GLuint OpenGLRenderer::CompileShader(GLenum type, const QString &code)
   return shader;
 }
 
+QString OpenGLRenderer::GetProgramBinaryFilename(const QString &vert_code, const QString &frag_code) const
+{
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  hash.addData(driver_id_);
+  hash.addData(vert_code.toUtf8());
+  hash.addData("\0", 1);
+  hash.addData(frag_code.toUtf8());
+
+  QDir dir(QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).filePath(QStringLiteral("shaders")));
+  return dir.filePath(QStringLiteral("%1.glbin").arg(QString::fromLatin1(hash.result().toHex())));
+}
+
+GLuint OpenGLRenderer::LoadProgramBinary(const QString &filename)
+{
+  QFile f(filename);
+  if (!f.open(QFile::ReadOnly)) {
+    return 0;
+  }
+
+  QByteArray data = f.readAll();
+  f.close();
+
+  // File starts with the binary format, followed by the binary itself
+  if (data.size() <= int(sizeof(GLenum))) {
+    return 0;
+  }
+
+  GLenum format;
+  memcpy(&format, data.constData(), sizeof(GLenum));
+
+  GLuint program = functions_->glCreateProgram();
+  context_->extraFunctions()->glProgramBinary(program, format, data.constData() + sizeof(GLenum), data.size() - sizeof(GLenum));
+
+  GLint success;
+  functions_->glGetProgramiv(program, GL_LINK_STATUS, &success);
+  if (!success) {
+    // Driver rejected it (e.g. updated without changing its version string), rebuild from source
+    functions_->glDeleteProgram(program);
+    QFile::remove(filename);
+    return 0;
+  }
+
+  return program;
+}
+
+void OpenGLRenderer::SaveProgramBinary(GLuint program, const QString &filename)
+{
+  GLint length = 0;
+  functions_->glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return;
+  }
+
+  QByteArray data(int(sizeof(GLenum)) + length, Qt::Uninitialized);
+  GLenum format = 0;
+  GLsizei written = 0;
+  context_->extraFunctions()->glGetProgramBinary(program, length, &written, &format, data.data() + sizeof(GLenum));
+  if (written <= 0) {
+    return;
+  }
+
+  memcpy(data.data(), &format, sizeof(GLenum));
+  data.resize(int(sizeof(GLenum)) + written);
+
+  QDir().mkpath(QFileInfo(filename).path());
+
+  QSaveFile f(filename);
+  if (f.open(QFile::WriteOnly)) {
+    f.write(data);
+    f.commit();
+  }
+}
+
+OpenGLRenderer::ProgramInfo OpenGLRenderer::ReflectProgram(GLuint program)
+{
+  ProgramInfo info;
+
+  GLint count = 0;
+  GLint max_length = 0;
+  functions_->glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+  functions_->glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+
+  QByteArray name(qMax(max_length, 1), Qt::Uninitialized);
+
+  for (GLint i=0; i<count; i++) {
+    GLsizei length = 0;
+    GLint size = 0;
+    GLenum type = 0;
+    functions_->glGetActiveUniform(program, i, name.size(), &length, &size, &type, name.data());
+
+    QByteArray uniform_name(name.constData(), length);
+
+    // Arrays are reported by their first element, but jobs refer to them by name
+    if (uniform_name.endsWith("[0]")) {
+      uniform_name.chop(3);
+    }
+
+    GLint location = functions_->glGetUniformLocation(program, uniform_name.constData());
+    if (location > -1) {
+      info.uniforms.insert(QString::fromUtf8(uniform_name), {location, type, -1});
+    }
+  }
+
+  for (auto it=info.uniforms.begin(); it!=info.uniforms.end(); it++) {
+    auto enabled = info.uniforms.constFind(QStringLiteral("%1_enabled").arg(it.key()));
+    if (enabled != info.uniforms.constEnd()) {
+      it->enabled_location = enabled->location;
+    }
+  }
+
+  auto get_location = [&info](const QString &uniform_name) {
+    auto it = info.uniforms.constFind(uniform_name);
+    return (it == info.uniforms.constEnd()) ? -1 : it->location;
+  };
+
+  info.mvpmat_location = get_location(QStringLiteral("ove_mvpmat"));
+  info.iteration_location = get_location(QStringLiteral("ove_iteration"));
+  info.vertex_location = functions_->glGetAttribLocation(program, "a_position");
+  info.texcoord_location = functions_->glGetAttribLocation(program, "a_texcoord");
+
+  return info;
+}
+
+const OpenGLRenderer::ProgramInfo &OpenGLRenderer::GetProgramInfo(GLuint program)
+{
+  auto it = program_info_.find(program);
+
+  if (it == program_info_.end()) {
+    // Program wasn't linked by us (e.g. created by another renderer sharing this context)
+    it = program_info_.insert(program, ReflectProgram(program));
+  }
+
+  return it.value();
+}
+
 void OpenGLRenderer::GarbageCollectTextureCache()
 {
   qint64 max_age = QDateTime::currentMSecsSinceEpoch() - kTextureCacheMaxSize;
   for (auto it=texture_cache_.begin(); it!=texture_cache_.end(); ) {
-    if (it->age < max_age) {
+    QVector<TextureCacheEntry> &bucket = it.value();
+
+    // Buckets are in release order, so the oldest entries are always at the front
+    int expired = 0;
+    while (expired < bucket.size() && bucket.at(expired).age < max_age) {
       GL_PREAMBLE;
-      GLuint t = it->texture;
+      GLuint t = bucket.at(expired).texture;
       texture_params_.remove(t);
       functions_->glDeleteTextures(1, &t);
+      expired++;
+    }
+
+    if (expired == bucket.size()) {
       it = texture_cache_.erase(it);
     } else {
+      bucket.remove(0, expired);
       it++;
     }
   }
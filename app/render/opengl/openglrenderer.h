@@ -67,6 +67,10 @@ public slots:
 
   virtual void DownloadFromTexture(olive::Texture* texture, void* data, int linesize) override;
 
+  virtual QVariant StartDownloadFromTexture(olive::Texture* texture) override;
+
+  virtual bool FinishDownloadFromTexture(QVariant download, void* data, int linesize) override;
+
   virtual void Flush() override;
 
   virtual Color GetPixelFromTexture(olive::Texture *texture, const QPointF &pt) override;
@@ -98,7 +102,46 @@ private:
 
   GLuint GetCachedTexture(int width, int height, int depth, VideoParams::Format format, int channel_count);
 
-  GLuint CompileShader(GLenum type, const QString &code);
+  const void *StageUpload(const void *data, int linesize, int width, int height, VideoParams::Format format, int channel_count);
+
+  void FinishUpload(const void *staged);
+
+  static QString GetCompleteShaderCode(GLenum type, const QString &code);
+
+  GLuint CompileShader(GLenum type, const QString &complete_code);
+
+  /**
+   * @brief Where the driver's binary of a program built from this code is stored across sessions
+   */
+  QString GetProgramBinaryFilename(const QString &vert_code, const QString &frag_code) const;
+
+  GLuint LoadProgramBinary(const QString &filename);
+
+  void SaveProgramBinary(GLuint program, const QString &filename);
+
+  /**
+   * @brief Locations of everything a blit sets on a program, looked up once when it's linked
+   */
+  struct ProgramInfo {
+    struct Uniform {
+      GLint location;
+      GLenum type;
+
+      /// For textures, location of the "<name>_enabled" flag if the program has one
+      GLint enabled_location;
+    };
+
+    QHash<QString, Uniform> uniforms;
+
+    GLint mvpmat_location;
+    GLint iteration_location;
+    GLint vertex_location;
+    GLint texcoord_location;
+  };
+
+  ProgramInfo ReflectProgram(GLuint program);
+
+  const ProgramInfo &GetProgramInfo(GLuint program);
 
   QTimer cache_timer_;
 
@@ -110,6 +153,10 @@ private:
 
   GLuint framebuffer_;
 
+  bool program_binaries_supported_;
+
+  QByteArray driver_id_;
+
   struct TextureCacheKey {
     int width;
     int height;
@@ -122,6 +169,11 @@ private:
       return width == rhs.width && height == rhs.height && depth == rhs.depth
           && format == rhs.format && channel_count == rhs.channel_count;
     }
+
+    friend uint qHash(const TextureCacheKey &k, uint seed = 0)
+    {
+      return ::qHash(qMakePair(qMakePair(k.width, k.height), qMakePair(k.depth, qMakePair(int(k.format), k.channel_count))), seed);
+    }
   };
 
   struct TextureCacheEntry {
@@ -130,12 +182,37 @@ private:
     qint64 age;
   };
 
-  QVector<TextureCacheEntry> texture_cache_;
+  /**
+   * @brief Released textures bucketed by size and format
+   *
+   * Each bucket is ordered from least to most recently released.
+   */
+  QHash<TextureCacheKey, QVector<TextureCacheEntry> > texture_cache_;
+
+  QHash<GLuint, TextureCacheKey> texture_params_;
+
+  QHash<GLuint, ProgramInfo> program_info_;
+
+  struct PixelBuffer {
+    GLuint buffer;
+    GLsizeiptr size;
+    GLsync fence;
+    int width;
+    int height;
+    int bytes_per_pixel;
+    bool in_use;
+  };
+
+  QVector<PixelBuffer> download_buffers_;
+
+  QVector<PixelBuffer> upload_buffers_;
 
-  QMap<GLuint, TextureCacheKey> texture_params_;
+  int next_upload_buffer_;
 
   static const int kTextureCacheMaxSize;
 
+  static const int kUploadBufferCount;
+
 private slots:
   void GarbageCollectTextureCache();
 
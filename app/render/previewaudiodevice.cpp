@@ -22,10 +22,24 @@
 
 namespace olive {
 
+const rational PreviewAudioDevice::kBufferLength = rational(2);
+const quint64 PreviewAudioDevice::kMinimumBufferSize = 1 << 16;
+const int PreviewAudioDevice::kNotifyPollInterval = 5;
+
 PreviewAudioDevice::PreviewAudioDevice(QObject *parent) :
+  QIODevice(parent),
+  buffer_size_(0),
+  read_pos_(0),
+  write_pos_(0),
+  bytes_per_frame_(0),
   notify_interval_(0),
-  bytes_read_(0)
+  notify_start_pos_(0),
+  bytes_notified_(0)
 {
+  // Notify is emitted from here rather than the real-time thread so a busy UI thread can never
+  // hold up the audio driver
+  notify_timer_.setInterval(kNotifyPollInterval);
+  connect(&notify_timer_, &QTimer::timeout, this, &PreviewAudioDevice::CheckNotify);
 }
 
 PreviewAudioDevice::~PreviewAudioDevice()
@@ -40,43 +54,150 @@ bool PreviewAudioDevice::isSequential() const
 
 qint64 PreviewAudioDevice::readData(char *data, qint64 maxSize)
 {
-  QMutexLocker locker(&lock_);
+  return PullSamples(data, maxSize);
+}
 
-  qint64 copy_length = qMin(maxSize, qint64(buffer_.size()));
+qint64 PreviewAudioDevice::writeData(const char *data, qint64 length)
+{
+  return PushSamples(data, length);
+}
 
-  if (copy_length) {
-    qint64 new_bytes_read = bytes_read_ + copy_length;
+qint64 PreviewAudioDevice::PullSamples(char *data, qint64 max)
+{
+  quint64 read = read_pos_.loadAcquire();
+  quint64 write = write_pos_.loadAcquire();
 
-    if (notify_interval_ > 0) {
-      if ((bytes_read_ / notify_interval_) != (new_bytes_read / notify_interval_)) {
-        emit Notify();
-      }
-    }
+  qint64 copy_length = qMin(max, qint64(write - read));
 
-    bytes_read_ = new_bytes_read;
+  if (bytes_per_frame_ > 0) {
+    // Never split a frame across callbacks
+    copy_length -= copy_length % bytes_per_frame_;
+  }
+
+  if (copy_length > 0) {
+    quint64 index = read & (buffer_size_ - 1);
+    qint64 first = qMin(copy_length, qint64(buffer_size_ - index));
+
+    memcpy(data, buffer_.constData() + index, first);
+    memcpy(data + first, buffer_.constData(), copy_length - first);
 
-    memcpy(data, buffer_.constData(), copy_length);
-    buffer_ = buffer_.mid(copy_length);
+    // If clear() moved the read position while we were copying, that audio was discarded anyway
+    if (!read_pos_.testAndSetOrdered(read, read + copy_length)) {
+      copy_length = 0;
+    }
   }
 
-  return copy_length;
+  return qMax(copy_length, qint64(0));
 }
 
-qint64 PreviewAudioDevice::writeData(const char *data, qint64 length)
+qint64 PreviewAudioDevice::PushSamples(const char *data, qint64 length)
 {
-  QMutexLocker locker(&lock_);
+  // Anything held back has to be played first
+  DrainOverflow();
 
-  buffer_.append(data, length);
+  qint64 written = overflow_.isEmpty() ? WriteToBuffer(data, length) : 0;
+
+  if (written < length) {
+    overflow_.append(data + written, length - written);
+  }
+
+  if ((notify_interval_ > 0 || !overflow_.isEmpty()) && !notify_timer_.isActive()) {
+    notify_timer_.start();
+  }
 
   return length;
 }
 
+void PreviewAudioDevice::SetParams(const AudioParams &params)
+{
+  bytes_per_frame_ = params.samples_to_bytes(1);
+
+  quint64 size = kMinimumBufferSize;
+  quint64 min_size = quint64(qMax(qint64(0), params.time_to_bytes(kBufferLength)));
+  while (size < min_size) {
+    size <<= 1;
+  }
+
+  if (size != buffer_size_) {
+    // Allocate up front so the real-time thread never waits on the allocator
+    buffer_.resize(size);
+    buffer_size_ = size;
+  }
+
+  read_pos_.storeRelease(0);
+  write_pos_.storeRelease(0);
+  overflow_.clear();
+  notify_start_pos_ = 0;
+  bytes_notified_ = 0;
+}
+
 void PreviewAudioDevice::clear()
 {
-  QMutexLocker locker(&lock_);
+  notify_timer_.stop();
+
+  overflow_.clear();
 
-  buffer_.clear();
-  bytes_read_ = 0;
+  // Discard everything queued by moving the consumer up to the producer. We are the only producer,
+  // so the write position can't change underneath us, but the consumer may be advancing.
+  quint64 write = write_pos_.loadAcquire();
+  quint64 read = read_pos_.loadAcquire();
+  while (!read_pos_.testAndSetOrdered(read, write)) {
+    read = read_pos_.loadAcquire();
+  }
+
+  // Playback progress is measured from here, anything the consumer read before this point is
+  // already behind the read position so it can't be counted again
+  notify_start_pos_ = write;
+  bytes_notified_ = 0;
+}
+
+void PreviewAudioDevice::DrainOverflow()
+{
+  if (!overflow_.isEmpty()) {
+    qint64 written = WriteToBuffer(overflow_.constData(), overflow_.size());
+    overflow_.remove(0, written);
+  }
+}
+
+qint64 PreviewAudioDevice::WriteToBuffer(const char *data, qint64 length)
+{
+  quint64 write = write_pos_.loadAcquire();
+  quint64 read = read_pos_.loadAcquire();
+
+  qint64 space = qint64(buffer_size_ - (write - read));
+  qint64 copy_length = qMin(length, space);
+
+  if (copy_length > 0) {
+    quint64 index = write & (buffer_size_ - 1);
+    qint64 first = qMin(copy_length, qint64(buffer_size_ - index));
+
+    memcpy(buffer_.data() + index, data, first);
+    memcpy(buffer_.data(), data + first, copy_length - first);
+
+    write_pos_.storeRelease(write + copy_length);
+  }
+
+  return qMax(copy_length, qint64(0));
+}
+
+void PreviewAudioDevice::CheckNotify()
+{
+  DrainOverflow();
+
+  if (notify_interval_ <= 0) {
+    if (overflow_.isEmpty()) {
+      notify_timer_.stop();
+    }
+    return;
+  }
+
+  qint64 bytes_read = qint64(read_pos_.loadAcquire() - notify_start_pos_);
+
+  // Emit once for each interval boundary playback has crossed since we last looked
+  while (bytes_read / notify_interval_ > bytes_notified_ / notify_interval_) {
+    bytes_notified_ += notify_interval_;
+    emit Notify();
+  }
 }
 
 }
@@ -21,6 +21,9 @@
 #ifndef PREVIEWAUDIODEVICE_H
 #define PREVIEWAUDIODEVICE_H
 
+#include <QAtomicInteger>
+#include <QTimer>
+
 #include "previewautocacher.h"
 
 namespace olive {
@@ -41,16 +44,34 @@ public:
 
   virtual qint64 writeData(const char *data, qint64 length) override;
 
+  /**
+   * @brief Copy buffered audio out of the device for playback
+   *
+   * Lock-free and allocation-free, intended to be called from the audio driver's real-time thread.
+   * This is the only consumer of the buffer.
+   */
+  qint64 PullSamples(char *data, qint64 max);
+
+  /**
+   * @brief Append audio for playback
+   *
+   * Must be called from the thread this device lives in, which is the only producer. Audio that
+   * doesn't fit in the buffer right now is held back and moved in as playback frees up space.
+   */
+  qint64 PushSamples(const char *data, qint64 length);
+
+  /**
+   * @brief Set the format of the audio that will be pushed and size the buffer for it
+   *
+   * Discards anything queued. Must not be called while the audio driver may be pulling samples.
+   */
+  void SetParams(const AudioParams &params);
+
   int bytes_per_frame() const
   {
     return bytes_per_frame_;
   }
 
-  void set_bytes_per_frame(int b)
-  {
-    bytes_per_frame_ = b;
-  }
-
   void set_notify_interval(qint64 i)
   {
     notify_interval_ = i;
@@ -62,15 +83,50 @@ signals:
   void Notify();
 
 private:
-  QMutex lock_;
+  /**
+   * @brief Move as much held back audio into the buffer as there's space for
+   */
+  void DrainOverflow();
+
+  qint64 WriteToBuffer(const char *data, qint64 length);
+
+  /**
+   * @brief Minimum length of audio the buffer holds, rounded up to a power of two bytes
+   */
+  static const rational kBufferLength;
+
+  static const quint64 kMinimumBufferSize;
+
+  /**
+   * @brief How often (ms) the UI thread checks how far playback has progressed
+   */
+  static const int kNotifyPollInterval;
 
   QByteArray buffer_;
 
+  // Size of buffer_, always a power of two
+  quint64 buffer_size_;
+
+  // Monotonic byte positions, the ring index is position & (buffer_size_ - 1)
+  QAtomicInteger<quint64> read_pos_;
+  QAtomicInteger<quint64> write_pos_;
+
+  // Audio pushed while the buffer was full, only touched by the producer
+  QByteArray overflow_;
+
   int bytes_per_frame_;
 
   qint64 notify_interval_;
 
-  qint64 bytes_read_;
+  // Read position when playback was last cleared, only touched by the producer
+  quint64 notify_start_pos_;
+
+  qint64 bytes_notified_;
+
+  QTimer notify_timer_;
+
+private slots:
+  void CheckNotify();
 
 };
 
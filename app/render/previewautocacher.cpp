@@ -23,8 +23,11 @@
 #include <QApplication>
 #include <QtConcurrent/QtConcurrent>
 
+#include "audio/audiowaveformfile.h"
 #include "codec/conformmanager.h"
+#include "node/block/clip/clip.h"
 #include "node/inputdragger.h"
+#include "node/output/track/track.h"
 #include "node/project/project.h"
 #include "render/renderprocessor.h"
 #include "task/customcache/customcachetask.h"
@@ -37,6 +40,8 @@ namespace olive {
 // placeholder for where that configarable variable would be used.
 const bool PreviewAutoCacher::kRealTimeWaveformsEnabled = true;
 
+const int PreviewAutoCacher::kMaxRetiredGraphSnapshots = 4;
+
 PreviewAutoCacher::PreviewAutoCacher() :
   viewer_node_(nullptr),
   use_custom_range_(false),
@@ -53,6 +58,7 @@ PreviewAutoCacher::PreviewAutoCacher() :
 
   // Catch when a conform is ready
   connect(ConformManager::instance(), &ConformManager::ConformReady, this, &PreviewAutoCacher::ConformFinished);
+  connect(ConformManager::instance(), &ConformManager::ConformRangeReady, this, &PreviewAutoCacher::ConformRangeReady);
 }
 
 PreviewAutoCacher::~PreviewAutoCacher()
@@ -61,16 +67,19 @@ PreviewAutoCacher::~PreviewAutoCacher()
   SetViewerNode(nullptr);
 }
 
-RenderTicketPtr PreviewAutoCacher::GetSingleFrame(const rational &t, RenderTicketPriority priority)
+RenderTicketPtr PreviewAutoCacher::GetSingleFrame(const rational &t, RenderTicketPriority priority, qint64 deadline)
 {
   // If we have a single frame render queued (but not yet sent to the RenderManager), cancel it now
   CancelQueuedSingleFrameRender();
 
   // Create a new single frame render ticket
-  auto sfr = std::make_shared<RenderTicket>();
+  RenderRequest request;
+  request.time = t;
+  request.priority = priority;
+  request.deadline = deadline;
+
+  auto sfr = std::make_shared<RenderTicket>(request);
   sfr->Start();
-  sfr->setProperty("time", QVariant::fromValue(t));
-  sfr->setProperty("priority", int(priority));
 
   // Queue it and try to render
   single_frame_render_ = sfr;
@@ -113,6 +122,9 @@ void PreviewAutoCacher::AudioRendered()
   // Receive watcher
   RenderTicketWatcher* watcher = static_cast<RenderTicketWatcher*>(sender());
 
+  // Release our reference to the snapshot this ticket was rendered from once we're done here
+  GraphSnapshotPtr snapshot = task_snapshots_.take(watcher);
+
   // If the task list doesn't contain this watcher, presumably it was cleared as a result of a
   // viewer switch, so we'll completely ignore this watcher
   if (audio_tasks_.contains(watcher)) {
@@ -125,7 +137,7 @@ void PreviewAutoCacher::AudioRendered()
 
       TimeRangeList valid_ranges = audio_job_tracker_.getCurrentSubRanges(range, watcher_job_time);
 
-      AudioVisualWaveform waveform = watcher->GetTicket()->property("waveform").value<AudioVisualWaveform>();
+      RenderResult &result = watcher->GetTicket()->render_result();
 
       if (viewer_node_->audio_playback_cache()->IsEnabled()) {
         // WritePCM is tolerant to its buffer being null, it will just write silence instead
@@ -134,25 +146,36 @@ void PreviewAutoCacher::AudioRendered()
                                                        watcher->Get().value<SampleBuffer>());
       }
 
-      viewer_node_->audio_playback_cache()->WriteWaveform(range, valid_ranges, &waveform);
+      viewer_node_->audio_playback_cache()->WriteWaveform(range, valid_ranges, &result.waveform);
 
       // Detect if this audio was incomplete because it was waiting on a conform to finish
-      if (watcher->GetTicket()->property("incomplete").toBool()) {
-        if (last_conform_task_ > watcher_job_time) {
+      if (result.incomplete) {
+        AudioWaitingForConform waiting = {range, result.conform_waits};
+
+        // Drop anything that became ready while this was rendering
+        for (int i=0; i<waiting.waits.size(); i++) {
+          const RenderResult::ConformWait &w = waiting.waits.at(i);
+          if (conform_ready_.value(w.task).contains(w.range)) {
+            waiting.waits.removeAt(i);
+            i--;
+          }
+        }
+
+        if (last_conform_task_ > watcher_job_time
+            || (!result.conform_waits.isEmpty() && waiting.waits.isEmpty())) {
           // Requeue now
           viewer_node_->audio_playback_cache()->Invalidate(range);
         } else {
           // Wait for conform
-          audio_needing_conform_.insert(range);
+          audio_needing_conform_.append(waiting);
         }
       } else{
         // Retrieve visual waveforms
-        QVector<RenderProcessor::RenderedWaveform> waveform_list = watcher->GetTicket()->property("waveforms").value< QVector<RenderProcessor::RenderedWaveform> >();
-        foreach (const RenderProcessor::RenderedWaveform& waveform_info, waveform_list) {
+        foreach (const RenderResult::Waveform& waveform_info, result.waveforms) {
           // Find original track
           ClipBlock* block = nullptr;
 
-          for (auto it=copy_map_.cbegin(); it!=copy_map_.cend(); it++) {
+          for (auto it=snapshot->copy_map.cbegin(); it!=snapshot->copy_map.cend(); it++) {
             if (it.value() == waveform_info.block) {
               block = static_cast<ClipBlock*>(it.key());
               break;
@@ -160,6 +183,16 @@ void PreviewAutoCacher::AudioRendered()
           }
 
           if (block && !valid_ranges.isEmpty()) {
+            if (!waveform_info.source.isEmpty()) {
+              // Clip can reference the stored waveform of its footage rather than copying sums
+              AudioWaveformFilePtr source = AudioWaveformFile::Get(waveform_info.source);
+              if (source) {
+                block->waveform().SetSource(source, waveform_info.source_offset);
+                emit block->PreviewChanged();
+                continue;
+              }
+            }
+
             // Generate visual waveform in this background thread
             block->waveform().set_channel_count(viewer_node_->GetAudioParams().channel_count());
 
@@ -182,6 +215,9 @@ void PreviewAutoCacher::AudioRendered()
       }
     }
 
+    // Drop our reference first so the snapshot can be updated in place if this was its last ticket
+    snapshot.reset();
+
     // Continue rendering
     TryRender();
   }
@@ -193,6 +229,10 @@ void PreviewAutoCacher::VideoRendered()
 {
   RenderTicketWatcher* watcher = static_cast<RenderTicketWatcher*>(sender());
 
+  // Don't keep the snapshot alive past this point so the snapshot can be updated in place by
+  // TryRender() if this was its last ticket
+  bool from_current_snapshot = (task_snapshots_.take(watcher) == snapshot_);
+
   // If the task list doesn't contain this watcher, presumably it was cleared as a result of a
   // viewer switch, so we'll completely ignore this watcher
   auto it = video_tasks_.find(watcher);
@@ -201,9 +241,14 @@ void PreviewAutoCacher::VideoRendered()
     // Assume that a "result" is a fully completed image and a non-result is a cancelled ticket
     if (watcher->HasResult()) {
       // Download frame in another thread
-      if (watcher->GetTicket()->property("cached").toBool()) {
+      if (watcher->GetTicket()->render_result().cached) {
         if (FrameHashCache *cache = Node::ValueToPtr<FrameHashCache>(watcher->property("cache"))) {
-          cache->ValidateTime(it.value());
+          // A frame rendered from an older snapshot is only valid if nothing has changed at this
+          // time since that snapshot was taken
+          if (from_current_snapshot
+              || video_job_tracker_.isCurrent(it.value(), watcher->property("job").value<JobTime>())) {
+            cache->ValidateTime(it.value());
+          }
         }
       }
     }
@@ -218,6 +263,9 @@ void PreviewAutoCacher::VideoRendered()
   // cleared anyway
   QVector<RenderTicketPtr> tickets = video_immediate_passthroughs_.take(watcher);
   foreach (RenderTicketPtr t, tickets) {
+    // Pass on how the render went too, e.g. so the viewer can tell a deadline skip from a cancel
+    t->render_result() = watcher->GetTicket()->render_result();
+
     if (watcher->HasResult()) {
       t->Finish(watcher->Get());
     } else {
@@ -235,6 +283,7 @@ void PreviewAutoCacher::ProcessUpdateQueue()
     switch (job.type) {
     case QueuedJob::kNodeAdded:
       AddNode(job.node);
+      ConnectToNodeCache(job.node);
       break;
     case QueuedJob::kNodeRemoved:
       RemoveNode(job.node);
@@ -255,11 +304,92 @@ void PreviewAutoCacher::ProcessUpdateQueue()
   }
   graph_update_queue_.clear();
 
+  // Copying values invalidated our copies on their own, so put them back in step with the graph
+  SyncCacheRevisions();
+
   // Indicate that we have synchronized to this point, which is compared with the graph change
   // time to see if our copied graph is up to date
   UpdateLastSyncedValue();
 }
 
+void PreviewAutoCacher::ForkSnapshot()
+{
+  // Tickets still reading from the current snapshot keep it alive, we only keep a weak reference
+  // so we know how many old snapshots are still around
+  retired_snapshots_.append(snapshot_);
+
+  // Node cache connections don't belong to any snapshot, so keep them in sync with the queue
+  foreach (const QueuedJob& job, graph_update_queue_) {
+    if (job.type == QueuedJob::kNodeAdded) {
+      ConnectToNodeCache(job.node);
+    } else if (job.type == QueuedJob::kNodeRemoved) {
+      DisconnectFromNodeCache(job.node);
+    }
+  }
+  graph_update_queue_.clear();
+
+  // The live graph already reflects everything in the queue, so copy it as it is now
+  CreateSnapshot();
+
+  UpdateLastSyncedValue();
+}
+
+void PreviewAutoCacher::CreateSnapshot()
+{
+  snapshot_ = std::make_shared<GraphSnapshot>();
+
+  NodeGraph* graph = viewer_node_->parent();
+
+  // Map the default nodes our project already has and copy the rest
+  for (int i=0; i<snapshot_->project.nodes().size(); i++) {
+    InsertIntoCopyMap(graph->nodes().at(i), snapshot_->project.nodes().at(i));
+  }
+  for (int i=snapshot_->project.nodes().size(); i<graph->nodes().size(); i++) {
+    AddNode(graph->nodes().at(i));
+  }
+
+  // Find copied viewer node
+  snapshot_->viewer = static_cast<ViewerOutput*>(snapshot_->copy_map.value(viewer_node_));
+  snapshot_->color_manager = static_cast<ColorManager*>(snapshot_->copy_map.value(viewer_node_->project()->color_manager()));
+
+  // Add all connections
+  foreach (Node* node, graph->nodes()) {
+    for (auto it=node->input_connections().cbegin(); it!=node->input_connections().cend(); it++) {
+      AddEdge(it->second, it->first);
+    }
+  }
+
+  SyncCacheRevisions();
+}
+
+void PreviewAutoCacher::SyncCacheRevisions()
+{
+  // Copies are keyed on the node they came from in the render caches, so giving them the same
+  // revisions lets a new snapshot reuse audio rendered from the previous one for anything that
+  // didn't change between them
+  for (auto it=snapshot_->copy_map.cbegin(); it!=snapshot_->copy_map.cend(); it++) {
+    if (Track *track = dynamic_cast<Track*>(it.key())) {
+      static_cast<Track*>(it.value())->set_audio_revision(track->audio_revision());
+    } else if (ClipBlock *clip = dynamic_cast<ClipBlock*>(it.key())) {
+      static_cast<ClipBlock*>(it.value())->set_audio_revision(clip->audio_revision());
+    }
+  }
+}
+
+bool PreviewAutoCacher::CanForkSnapshot()
+{
+  // Forget snapshots whose tickets have all finished
+  for (auto it=retired_snapshots_.begin(); it!=retired_snapshots_.end(); ) {
+    if (it->expired()) {
+      it = retired_snapshots_.erase(it);
+    } else {
+      it++;
+    }
+  }
+
+  return retired_snapshots_.size() < kMaxRetiredGraphSnapshots;
+}
+
 void PreviewAutoCacher::AddNode(Node *node)
 {
   if (dynamic_cast<NodeGroup*>(node)) {
@@ -271,25 +401,25 @@ void PreviewAutoCacher::AddNode(Node *node)
   Node* copy = node->copy();
 
   // Add to project
-  copy->setParent(&copied_project_);
+  copy->setParent(&snapshot_->project);
 
   // Insert into map
   InsertIntoCopyMap(node, copy);
 
   // Keep track of our nodes
-  created_nodes_.append(copy);
+  snapshot_->created_nodes.append(copy);
 }
 
 void PreviewAutoCacher::RemoveNode(Node *node)
 {
   // Find our copy and remove it
-  Node* copy = copy_map_.take(node);
+  Node* copy = snapshot_->copy_map.take(node);
 
   // Disconnect from node's caches
   DisconnectFromNodeCache(node);
 
   // Remove from created list
-  created_nodes_.removeOne(copy);
+  snapshot_->created_nodes.removeOne(copy);
 
   // Delete it
   delete copy;
@@ -298,8 +428,8 @@ void PreviewAutoCacher::RemoveNode(Node *node)
 void PreviewAutoCacher::AddEdge(Node *output, const NodeInput &input)
 {
   // Create same connection with our copied graph
-  Node* our_output = copy_map_.value(output);
-  Node* our_input = copy_map_.value(input.node());
+  Node* our_output = snapshot_->copy_map.value(output);
+  Node* our_input = snapshot_->copy_map.value(input.node());
 
   Node::ConnectEdge(our_output, NodeInput(our_input, input.input(), input.element()));
 }
@@ -307,8 +437,8 @@ void PreviewAutoCacher::AddEdge(Node *output, const NodeInput &input)
 void PreviewAutoCacher::RemoveEdge(Node *output, const NodeInput &input)
 {
   // Remove same connection with our copied graph
-  Node* our_output = copy_map_.value(output);
-  Node* our_input = copy_map_.value(input.node());
+  Node* our_output = snapshot_->copy_map.value(output);
+  Node* our_input = snapshot_->copy_map.value(input.node());
 
   Node::DisconnectEdge(our_output, NodeInput(our_input, input.input(), input.element()));
 }
@@ -321,7 +451,7 @@ void PreviewAutoCacher::CopyValue(const NodeInput &input)
   }
 
   // Copy all values to our graph
-  Node* our_input = copy_map_.value(input.node());
+  Node* our_input = snapshot_->copy_map.value(input.node());
   Node::CopyValuesOfElement(input.node(), our_input, input.input(), input.element());
 }
 
@@ -333,7 +463,7 @@ void PreviewAutoCacher::CopyValueHint(const NodeInput &input)
   }
 
   // Copy value hint to our graph
-  Node* our_input = copy_map_.value(input.node());
+  Node* our_input = snapshot_->copy_map.value(input.node());
   Node::ValueHint hint = input.node()->GetValueHintForInput(input.input(), input.element());
   our_input->SetValueHintForInput(input.input(), hint, input.element());
 }
@@ -341,13 +471,11 @@ void PreviewAutoCacher::CopyValueHint(const NodeInput &input)
 void PreviewAutoCacher::InsertIntoCopyMap(Node *node, Node *copy)
 {
   // Insert into map
-  copy_map_.insert(node, copy);
+  snapshot_->copy_map.insert(node, copy);
+  copy->set_cache_identity(node);
 
   // Copy parameters
   Node::CopyInputs(node, copy, false);
-
-  // Connect to node's cache
-  ConnectToNodeCache(node);
 }
 
 void PreviewAutoCacher::ConnectToNodeCache(Node *node)
@@ -534,21 +662,24 @@ void PreviewAutoCacher::ValueHintChanged(const NodeInput &input)
 void PreviewAutoCacher::TryRender()
 {
   if (!graph_update_queue_.isEmpty()) {
-    // Check if we have jobs running in other threads that shouldn't be interrupted right now
+    // The current snapshot is referenced by us and by every ticket that was started with it
     // NOTE: We don't check for downloads because, while they run in another thread, they don't
     //       require any access to the graph and therefore don't risk race conditions.
-    if (!audio_tasks_.isEmpty()
-        || !video_tasks_.isEmpty()) {
+    if (snapshot_.use_count() == 1) {
+      // No tickets are reading from the current snapshot, we can update it in place
+      ProcessUpdateQueue();
+    } else if (CanForkSnapshot()) {
+      // Leave the current snapshot to the tickets using it and start new tickets on a new one
+      ForkSnapshot();
+    } else {
+      // Too many old snapshots are still in use, wait for some of their tickets to finish
       return;
     }
-
-    // No jobs are active, we can process the update queue
-    ProcessUpdateQueue();
   }
 
   // Check for newly invalidated video and hash it
   if (!invalidated_video_.isEmpty()) {
-    if (!copied_viewer_node_->GetConnectedTextureOutput()) {
+    if (!snapshot_->viewer->GetConnectedTextureOutput()) {
       queued_frame_iterator_.reset();
     } else if (queued_frame_iterator_.HasNext()) {
       queued_frame_iterator_.insert(invalidated_video_);
@@ -566,9 +697,10 @@ void PreviewAutoCacher::TryRender()
 
   if (single_frame_render_) {
     // Check if already caching this
-    RenderTicketWatcher *watcher = RenderFrame(single_frame_render_->property("time").value<rational>(),
-                                               RenderTicketPriority(single_frame_render_->property("priority").toInt()),
-                                               nullptr);
+    RenderTicketWatcher *watcher = RenderFrame(single_frame_render_->request().time,
+                                               single_frame_render_->request().priority,
+                                               nullptr,
+                                               single_frame_render_->request().deadline);
     video_immediate_passthroughs_[watcher].append(single_frame_render_);
 
     single_frame_render_ = nullptr;
@@ -585,7 +717,7 @@ void PreviewAutoCacher::TryRender()
     // We want this hash, if we're not already rendering, start render now
     if (!render_task) {
       // Don't render any hash more than once
-      RenderFrame(t, RenderTicketPriority::kNormal, viewer_node_->video_frame_cache());
+      RenderFrame(t, RenderTicketPriority::kAutoCache, viewer_node_->video_frame_cache());
     }
 
     emit SignalCacheProxyTaskProgress(double(queued_frame_iterator_.frame_index()) / double(queued_frame_iterator_.size()));
@@ -605,28 +737,34 @@ void PreviewAutoCacher::TryRender()
     r.set_out(qMin(r.out(), r.in() + AudioVisualWaveform::kMinimumSampleRate.flipped()));
 
     // Start job
-    RenderAudio(r, true, RenderTicketPriority::kNormal);
+    RenderAudio(r, true, RenderTicketPriority::kAutoCache);
 
     audio_iterator_.remove(r);
   }
 }
 
-RenderTicketWatcher* PreviewAutoCacher::RenderFrame(Node *node, const rational& time, RenderTicketPriority priority, FrameHashCache *cache)
+RenderTicketWatcher* PreviewAutoCacher::RenderFrame(Node *node, const rational& time, RenderTicketPriority priority, FrameHashCache *cache, qint64 deadline)
 {
   RenderTicketWatcher* watcher = new RenderTicketWatcher();
   watcher->setProperty("job", QVariant::fromValue(last_update_time_));
   watcher->setProperty("cache", Node::PtrToValue(cache));
   connect(watcher, &RenderTicketWatcher::Finished, this, &PreviewAutoCacher::VideoRendered);
   video_tasks_.insert(watcher, time);
+  task_snapshots_.insert(watcher, snapshot_);
+
+  // Nothing looks at the result of an auto-cache render, it only needs to end up in the cache
+  RenderRequest::ReturnType return_type = (priority == RenderTicketPriority::kAutoCache) ? RenderRequest::kNone : RenderRequest::kTexture;
+
   watcher->SetTicket(RenderManager::instance()->RenderFrame(node,
-                                                            copied_viewer_node_->GetVideoParams(),
-                                                            copied_viewer_node_->GetAudioParams(),
-                                                            copied_color_manager_,
+                                                            snapshot_->viewer->GetVideoParams(),
+                                                            snapshot_->viewer->GetAudioParams(),
+                                                            snapshot_->color_manager,
                                                             time,
                                                             RenderMode::kOffline,
                                                             cache,
                                                             priority,
-                                                            RenderManager::kTexture));
+                                                            return_type,
+                                                            deadline));
   return watcher;
 }
 
@@ -636,8 +774,9 @@ RenderTicketPtr PreviewAutoCacher::RenderAudio(Node *node, const TimeRange &r, b
   watcher->setProperty("job", QVariant::fromValue(last_update_time_));
   connect(watcher, &RenderTicketWatcher::Finished, this, &PreviewAutoCacher::AudioRendered);
   audio_tasks_.insert(watcher, r);
+  task_snapshots_.insert(watcher, snapshot_);
 
-  RenderTicketPtr ticket = RenderManager::instance()->RenderAudio(node, r, copied_viewer_node_->GetAudioParams(), RenderMode::kOffline, generate_waveforms, priority);
+  RenderTicketPtr ticket = RenderManager::instance()->RenderAudio(node, r, snapshot_->viewer->GetAudioParams(), RenderMode::kOffline, generate_waveforms, priority);
   watcher->SetTicket(ticket);
   return ticket;
 }
@@ -673,20 +812,53 @@ void PreviewAutoCacher::RequeueFrames()
   }
 }
 
-void PreviewAutoCacher::ConformFinished()
+void PreviewAutoCacher::ConformFinished(ConformTask *task)
 {
   // Got an audio conform, requeue all the audio currently needing a conform
   last_conform_task_.Acquire();
 
+  // This conform is read from its final file now, other conforms may still be partial
+  conform_ready_.remove(task);
+
   if (!audio_needing_conform_.isEmpty()) {
     // This list should be empty if there was a viewer switch
-    foreach (const TimeRange &range, audio_needing_conform_) {
-      viewer_node_->audio_playback_cache()->Invalidate(range);
+    foreach (const AudioWaitingForConform &waiting, audio_needing_conform_) {
+      viewer_node_->audio_playback_cache()->Invalidate(waiting.range);
     }
     audio_needing_conform_.clear();
   }
 }
 
+void PreviewAutoCacher::ConformRangeReady(ConformTask *task, const TimeRange &range)
+{
+  TimeRangeList &ready = conform_ready_[task];
+  ready.insert(range);
+
+  // Requeue only audio whose every missing range can now be read
+  for (int i=0; i<audio_needing_conform_.size(); i++) {
+    AudioWaitingForConform &waiting = audio_needing_conform_[i];
+
+    if (waiting.waits.isEmpty()) {
+      // Don't know what this is waiting on, leave it for the whole conform
+      continue;
+    }
+
+    for (int j=0; j<waiting.waits.size(); j++) {
+      const RenderResult::ConformWait &w = waiting.waits.at(j);
+      if (w.task == task && ready.contains(w.range)) {
+        waiting.waits.removeAt(j);
+        j--;
+      }
+    }
+
+    if (waiting.waits.isEmpty()) {
+      viewer_node_->audio_playback_cache()->Invalidate(waiting.range);
+      audio_needing_conform_.removeAt(i);
+      i--;
+    }
+  }
+}
+
 void PreviewAutoCacher::VideoAutoCacheEnableChanged(bool e)
 {
   if (e) {
@@ -767,15 +939,14 @@ void PreviewAutoCacher::SetViewerNode(ViewerOutput *viewer_node)
     audio_needing_conform_.clear();
 
     // Disconnect from all node cache's
-    for (auto it=copy_map_.cbegin(); it!=copy_map_.cend(); it++) {
+    for (auto it=snapshot_->copy_map.cbegin(); it!=snapshot_->copy_map.cend(); it++) {
       DisconnectFromNodeCache(it.key());
     }
 
-    // Delete all of our copied nodes
-    qDeleteAll(created_nodes_);
-    created_nodes_.clear();
-    copy_map_.clear();
-    copied_viewer_node_ = nullptr;
+    // Delete all of our copied nodes, every ticket has finished so nothing else references them
+    task_snapshots_.clear();
+    retired_snapshots_.clear();
+    snapshot_ = nullptr;
     graph_update_queue_.clear();
     video_job_tracker_.clear();
     audio_job_tracker_.clear();
@@ -796,24 +967,11 @@ void PreviewAutoCacher::SetViewerNode(ViewerOutput *viewer_node)
   if (viewer_node_) {
     // Copy graph
     NodeGraph* graph = viewer_node_->parent();
+    CreateSnapshot();
 
-    // Add all nodes
-    for (int i=0; i<copied_project_.nodes().size(); i++) {
-      InsertIntoCopyMap(graph->nodes().at(i), copied_project_.nodes().at(i));
-    }
-    for (int i=copied_project_.nodes().size(); i<graph->nodes().size(); i++) {
-      AddNode(graph->nodes().at(i));
-    }
-
-    // Find copied viewer node
-    copied_viewer_node_ = static_cast<ViewerOutput*>(copy_map_.value(viewer_node_));
-    copied_color_manager_ = static_cast<ColorManager*>(copy_map_.value(viewer_node_->project()->color_manager()));
-
-    // Add all connections
+    // Connect to node caches
     foreach (Node* node, graph->nodes()) {
-      for (auto it=node->input_connections().cbegin(); it!=node->input_connections().cend(); it++) {
-        AddEdge(it->second, it->first);
-      }
+      ConnectToNodeCache(node);
     }
 
     // Ensure graph change value is just before the sync value
@@ -21,6 +21,7 @@
 #ifndef AUTOCACHER_H
 #define AUTOCACHER_H
 
+#include <memory>
 #include <QtConcurrent/QtConcurrent>
 
 #include "config/config.h"
@@ -51,7 +52,7 @@ public:
 
   virtual ~PreviewAutoCacher() override;
 
-  RenderTicketPtr GetSingleFrame(const rational& t, RenderTicketPriority prioritize);
+  RenderTicketPtr GetSingleFrame(const rational& t, RenderTicketPriority prioritize, qint64 deadline = 0);
 
   RenderTicketPtr GetRangeOfAudio(TimeRange range, RenderTicketPriority prioritize);
 
@@ -100,16 +101,16 @@ signals:
 private:
   void TryRender();
 
-  RenderTicketWatcher *RenderFrame(Node *node, const rational &time, RenderTicketPriority priority, FrameHashCache *cache);
-  RenderTicketWatcher *RenderFrame(const rational &time, RenderTicketPriority priority, FrameHashCache *cache)
+  RenderTicketWatcher *RenderFrame(Node *node, const rational &time, RenderTicketPriority priority, FrameHashCache *cache, qint64 deadline = 0);
+  RenderTicketWatcher *RenderFrame(const rational &time, RenderTicketPriority priority, FrameHashCache *cache, qint64 deadline = 0)
   {
-    return RenderFrame(copied_viewer_node_->GetConnectedTextureOutput(), time, priority, cache);
+    return RenderFrame(snapshot_->viewer->GetConnectedTextureOutput(), time, priority, cache, deadline);
   }
 
   RenderTicketPtr RenderAudio(Node *node, const TimeRange &range, bool generate_waveforms, RenderTicketPriority priority);
   RenderTicketPtr RenderAudio(const TimeRange &range, bool generate_waveforms, RenderTicketPriority priority)
   {
-    return RenderAudio(copied_viewer_node_->GetConnectedSampleOutput(), range, generate_waveforms, priority);
+    return RenderAudio(snapshot_->viewer->GetConnectedSampleOutput(), range, generate_waveforms, priority);
   }
 
   /**
@@ -120,6 +121,25 @@ private:
    */
   void ProcessUpdateQueue();
 
+  /**
+   * @brief Replace the current graph snapshot with a fresh copy of the live graph
+   *
+   * Used instead of ProcessUpdateQueue() when tickets are still reading from the current snapshot.
+   * Those tickets keep the old snapshot alive until they finish, while new tickets use the new one
+   * immediately.
+   */
+  void ForkSnapshot();
+
+  /**
+   * @brief Copy the entire live graph of the current viewer into a new snapshot
+   */
+  void CreateSnapshot();
+
+  /**
+   * @brief Returns whether a new snapshot can be created without exceeding kMaxRetiredGraphSnapshots
+   */
+  bool CanForkSnapshot();
+
   void AddNode(Node* node);
   void RemoveNode(Node* node);
   void AddEdge(Node *output, const NodeInput& input);
@@ -129,6 +149,11 @@ private:
 
   void InsertIntoCopyMap(Node* node, Node* copy);
 
+  /**
+   * @brief Mirror the audio revisions of the live graph onto the current snapshot's copies
+   */
+  void SyncCacheRevisions();
+
   void ConnectToNodeCache(Node *node);
   void DisconnectFromNodeCache(Node *node);
 
@@ -144,6 +169,36 @@ private:
   void StartCachingVideoRange(const TimeRange &range);
   void StartCachingAudioRange(const TimeRange &range);
 
+  /**
+   * @brief Immutable (to the RenderManager) version of the viewer's node graph
+   *
+   * Tickets hold a reference to the snapshot they were started with so that edits can be applied
+   * to a newer snapshot without waiting for them to finish.
+   */
+  class GraphSnapshot
+  {
+  public:
+    GraphSnapshot() :
+      viewer(nullptr),
+      color_manager(nullptr)
+    {
+    }
+
+    ~GraphSnapshot()
+    {
+      qDeleteAll(created_nodes);
+    }
+
+    Project project;
+    QHash<Node*, Node*> copy_map;
+    QVector<Node*> created_nodes;
+    ViewerOutput* viewer;
+    ColorManager* color_manager;
+
+  };
+
+  using GraphSnapshotPtr = std::shared_ptr<GraphSnapshot>;
+
   class QueuedJob {
   public:
     enum Type {
@@ -163,14 +218,10 @@ private:
 
   ViewerOutput* viewer_node_;
 
-  Project copied_project_;
-
   QVector<QueuedJob> graph_update_queue_;
-  QHash<Node*, Node*> copy_map_;
-  QHash<NodeGraph*, NodeGraph*> graph_map_;
-  ViewerOutput* copied_viewer_node_;
-  ColorManager* copied_color_manager_;
-  QVector<Node*> created_nodes_;
+  GraphSnapshotPtr snapshot_;
+  QHash<RenderTicketWatcher*, GraphSnapshotPtr> task_snapshots_;
+  QVector<std::weak_ptr<GraphSnapshot> > retired_snapshots_;
 
   TimeRange cache_range_;
 
@@ -193,7 +244,15 @@ private:
 
   QTimer delayed_requeue_timer_;
 
-  TimeRangeList audio_needing_conform_;
+  struct AudioWaitingForConform {
+    TimeRange range;
+    QVector<RenderResult::ConformWait> waits;
+  };
+
+  QVector<AudioWaitingForConform> audio_needing_conform_;
+
+  // Parts of conforms still generating that have been reported ready
+  QHash<ConformTask*, TimeRangeList> conform_ready_;
 
   JobTime last_conform_task_;
 
@@ -205,6 +264,8 @@ private:
 
   static const bool kRealTimeWaveformsEnabled;
 
+  static const int kMaxRetiredGraphSnapshots;
+
 private slots:
   /**
    * @brief Handler for when the NodeGraph reports a video change over a certain time range
@@ -243,7 +304,9 @@ private slots:
    */
   void RequeueFrames();
 
-  void ConformFinished();
+  void ConformFinished(ConformTask *task);
+
+  void ConformRangeReady(ConformTask *task, const TimeRange &range);
 
   void VideoAutoCacheEnableChanged(bool e);
 
@@ -21,10 +21,16 @@
 #ifndef RENDERCACHE_H
 #define RENDERCACHE_H
 
+#include <QMap>
+
+#include "audio/audioprocessor.h"
 #include "codec/decoder.h"
+#include "threading/threadticket.h"
 
 namespace olive {
 
+class Node;
+
 template <typename K, typename V>
 class RenderCache : public QHash<K, V>
 {
@@ -43,11 +49,81 @@ struct DecoderPair
 {
   DecoderPtr decoder = nullptr;
   qint64 last_modified = 0;
+  rational last_time = Decoder::kAnyTimecode;
 };
 
-using DecoderCache = RenderCache<Decoder::CodecStream, DecoderPair>;
+/**
+ * @brief Pool of open decoders for each stream
+ *
+ * Several decoders may be open for the same stream so that render threads requesting different
+ * parts of it don't have to wait on each other or repeatedly seek the same decoder.
+ */
+using DecoderCache = RenderCache<Decoder::CodecStream, QVector<DecoderPair> >;
 using ShaderCache = RenderCache<QString, QVariant>;
 
+/**
+ * @brief Time-stretch state for a clip that persists across consecutive audio tickets
+ *
+ * Clips that change speed while maintaining pitch are fed through a tempo filter, which only
+ * sounds right when it receives one continuous stream. Keeping the filter open between tickets
+ * (and feeding it slightly ahead of what's been requested) avoids the clicks and setup cost of
+ * opening a new one for every chunk.
+ */
+struct TempoStream
+{
+  AudioProcessor processor;
+
+  /// Stretched output that has been produced but not yet handed out, one array per channel
+  AudioProcessor::Buffer pending;
+
+  /// Sequence time the next ticket must start at to continue this stream
+  rational output_position = -1;
+
+  /// Sequence time up to which input has been fed into the processor
+  rational fed_until;
+
+  bool flushed = false;
+
+  // Clip parameters the stream was opened with, a mismatch means the clip changed and the stream
+  // must be reset
+  double speed = 0.0;
+  rational clip_in;
+  rational media_in;
+
+  /// ClipBlock::audio_revision() the stream was opened at, catches edits upstream of the clip
+  int revision = -1;
+
+  AudioParams params;
+
+  bool in_use = false;
+  qint64 last_used = 0;
+};
+
+using TempoStreamPtr = std::shared_ptr<TempoStream>;
+using TempoCache = RenderCache<const Node*, QVector<TempoStreamPtr> >;
+
+/**
+ * @brief Rendered audio of one track over a fixed-length, aligned chunk of time
+ *
+ * Consecutive playback tickets usually only re-render the track that changed, so the mix bus
+ * keeps each track's recent output and reuses it for as long as the track's revision matches.
+ */
+struct TrackAudioChunk
+{
+  SampleBuffer samples;
+  AudioParams params;
+  int revision = 0;
+  qint64 last_used = 0;
+
+  /// Set if the chunk was rendered for a waveform request, in which case `waveforms` holds the
+  /// waveforms of its clips. Blocks are stored as their cache identity since the copy that
+  /// rendered them may no longer exist.
+  bool has_waveforms = false;
+  QVector<RenderResult::Waveform> waveforms;
+};
+
+using TrackAudioCache = RenderCache<const Node*, QMap<qint64, TrackAudioChunk> >;
+
 }
 
 #endif // RENDERCACHE_H
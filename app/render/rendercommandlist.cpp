@@ -0,0 +1,149 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2022 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "rendercommandlist.h"
+
+namespace olive {
+
+RenderCommandList::RenderCommandList() :
+  signalled_(false)
+{
+}
+
+void RenderCommandList::CreateTexture(TexturePtr texture)
+{
+  Command c;
+  c.type = kCreateTexture;
+  c.texture = texture;
+  commands_.push_back(c);
+}
+
+void RenderCommandList::DestroyTexture(const QVariant &native)
+{
+  Command c;
+  c.type = kDestroyTexture;
+  c.native = native;
+  commands_.push_back(c);
+}
+
+void RenderCommandList::RecycleTexture(TexturePtr texture)
+{
+  Command c;
+  c.type = kRecycleTexture;
+  c.texture = texture;
+  commands_.push_back(c);
+}
+
+void RenderCommandList::ClearDestination(TexturePtr texture, double r, double g, double b, double a)
+{
+  Command c;
+  c.type = kClear;
+  c.texture = texture;
+  c.clear_color[0] = r;
+  c.clear_color[1] = g;
+  c.clear_color[2] = b;
+  c.clear_color[3] = a;
+  commands_.push_back(c);
+}
+
+void RenderCommandList::Blit(const QVariant &shader, const ShaderJob &job, TexturePtr destination, const VideoParams &params, bool clear_destination)
+{
+  Command c;
+  c.type = kBlit;
+  c.shader = shader;
+  c.job = job;
+
+  // Reference the job's textures the same way other commands do, so that the recorder releasing
+  // its own references isn't delayed by this copy of the job
+  NodeValueRow &values = c.job.GetValues();
+  for (auto it=values.begin(); it!=values.end(); it++) {
+    if (it.value().type() == NodeValue::kTexture && !it.value().array()) {
+      if (TexturePtr t = it.value().toTexture()) {
+        it.value().set_value(t->shared_from_this());
+      }
+    }
+  }
+
+  c.texture = destination;
+  c.params = params;
+  c.clear_destination = clear_destination;
+  commands_.push_back(c);
+}
+
+void RenderCommandList::Download(TexturePtr texture, void *data, int linesize)
+{
+  Command c;
+  c.type = kDownload;
+  c.texture = texture;
+  c.data = data;
+  c.linesize = linesize;
+  commands_.push_back(c);
+}
+
+void RenderCommandList::StartDownload(TexturePtr texture, QVariant *download)
+{
+  Command c;
+  c.type = kStartDownload;
+  c.texture = texture;
+  c.download = download;
+  commands_.push_back(c);
+}
+
+void RenderCommandList::Flush()
+{
+  Command c;
+  c.type = kFlush;
+  commands_.push_back(c);
+}
+
+void RenderCommandList::Clear()
+{
+  // Releasing textures may record new commands into this list, so we swap the commands out before
+  // they're destroyed
+  std::vector<Command> executed;
+  executed.swap(commands_);
+}
+
+void RenderCommandList::Signal()
+{
+  QMutexLocker locker(&fence_lock_);
+
+  signalled_ = true;
+
+  fence_wait_.wakeAll();
+}
+
+void RenderCommandList::Wait()
+{
+  QMutexLocker locker(&fence_lock_);
+
+  while (!signalled_) {
+    fence_wait_.wait(&fence_lock_);
+  }
+}
+
+void RenderCommandList::ResetFence()
+{
+  QMutexLocker locker(&fence_lock_);
+
+  signalled_ = false;
+}
+
+}
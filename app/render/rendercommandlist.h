@@ -0,0 +1,157 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2022 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef RENDERCOMMANDLIST_H
+#define RENDERCOMMANDLIST_H
+
+#include <QMutex>
+#include <QWaitCondition>
+#include <vector>
+
+#include "common/define.h"
+#include "render/job/shaderjob.h"
+#include "render/texture.h"
+
+namespace olive {
+
+/**
+ * @brief A list of renderer operations recorded on one thread and executed together on another
+ *
+ * Rather than sending every texture allocation, blit and download to the renderer thread one at a
+ * time (and waiting for each to complete), a render worker can record them into a list and submit
+ * the whole list at once. The thread that records the list can then wait for its fence to be
+ * signalled once the renderer has executed every command.
+ *
+ * Commands hold references to every texture they use, so textures will stay alive until the list
+ * has been executed even if the caller releases them earlier.
+ */
+class RenderCommandList
+{
+public:
+  enum CommandType {
+    kCreateTexture,
+    kDestroyTexture,
+    kRecycleTexture,
+    kClear,
+    kBlit,
+    kDownload,
+    kStartDownload,
+    kFlush
+  };
+
+  struct Command {
+    CommandType type;
+    TexturePtr texture;
+    QVariant native;
+    QVariant shader;
+    ShaderJob job;
+    VideoParams params;
+    bool clear_destination = false;
+    double clear_color[4] = {0.0, 0.0, 0.0, 0.0};
+    void *data = nullptr;
+    int linesize = 0;
+    QVariant *download = nullptr;
+  };
+
+  RenderCommandList();
+
+  DISABLE_COPY_MOVE(RenderCommandList)
+
+  /**
+   * @brief Record allocation of a texture that doesn't have a native handle yet
+   *
+   * The native handle will be set on the texture when the list is executed.
+   */
+  void CreateTexture(TexturePtr texture);
+
+  void DestroyTexture(const QVariant &native);
+
+  /**
+   * @brief Record that nothing after this point in the list will use `texture`
+   *
+   * When executed, the texture's native handle is returned to the renderer so that a texture
+   * created later in the list with the same size and format can reuse it.
+   */
+  void RecycleTexture(TexturePtr texture);
+
+  void ClearDestination(TexturePtr texture, double r, double g, double b, double a);
+
+  void Blit(const QVariant &shader, const ShaderJob &job, TexturePtr destination, const VideoParams &params, bool clear_destination);
+
+  /**
+   * @brief Record a download of a texture into CPU memory
+   *
+   * `data` must remain valid until the list's fence has been signalled.
+   */
+  void Download(TexturePtr texture, void *data, int linesize);
+
+  /**
+   * @brief Record the start of an asynchronous download
+   *
+   * The download handle is written to `download` when the list is executed.
+   */
+  void StartDownload(TexturePtr texture, QVariant *download);
+
+  void Flush();
+
+  const std::vector<Command> &commands() const
+  {
+    return commands_;
+  }
+
+  bool IsEmpty() const
+  {
+    return commands_.empty();
+  }
+
+  /**
+   * @brief Remove all commands, releasing any textures they reference
+   */
+  void Clear();
+
+  /**
+   * @brief Signal this list's fence, called by the renderer once every command has been executed
+   */
+  void Signal();
+
+  /**
+   * @brief Block the calling thread until this list's fence has been signalled
+   */
+  void Wait();
+
+  /**
+   * @brief Reset the fence so the list can be submitted again
+   */
+  void ResetFence();
+
+private:
+  std::vector<Command> commands_;
+
+  QMutex fence_lock_;
+
+  QWaitCondition fence_wait_;
+
+  bool signalled_;
+
+};
+
+}
+
+#endif // RENDERCOMMANDLIST_H
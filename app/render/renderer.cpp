@@ -20,12 +20,17 @@
 
 #include "renderer.h"
 
+#include <QCryptographicHash>
+#include <QThread>
 #include <QVector2D>
 
 #include "common/ocioutils.h"
 
 namespace olive {
 
+const unsigned long Renderer::kDownloadPollMinInterval = 50;
+const unsigned long Renderer::kDownloadPollMaxInterval = 2000;
+
 Renderer::Renderer(QObject *parent) :
   QObject(parent)
 {
@@ -34,6 +39,13 @@ Renderer::Renderer(QObject *parent) :
 
 TexturePtr Renderer::CreateTexture(const VideoParams &params, Texture::Type type, const void *data, int linesize)
 {
+  if (!data) {
+    // Nothing to upload, so allocation can happen whenever the renderer gets to it
+    if (TexturePtr deferred = CreateDeferredTexture(params, type)) {
+      return deferred;
+    }
+  }
+
   QVariant v;
 
   if (type == Texture::k3D) {
@@ -56,7 +68,7 @@ TexturePtr Renderer::InterlaceTexture(TexturePtr top, TexturePtr bottom, const V
 {
   color_cache_mutex_.lock();
   if (interlace_texture_.isNull()) {
-    interlace_texture_ = CreateNativeShader(ShaderCode(FileFunctions::ReadFileAsString(QStringLiteral(":/shaders/interlace.frag"))));
+    interlace_texture_ = GetShaderProgram(ShaderCode(FileFunctions::ReadFileAsString(QStringLiteral(":/shaders/interlace.frag"))));
   }
   color_cache_mutex_.unlock();
 
@@ -75,29 +87,121 @@ TexturePtr Renderer::InterlaceTexture(TexturePtr top, TexturePtr bottom, const V
 QVariant Renderer::GetDefaultShader()
 {
   if (default_shader_.isNull()) {
-    default_shader_ = CreateNativeShader(ShaderCode(QString(), QString()));
+    default_shader_ = GetShaderProgram(ShaderCode(QString(), QString()));
   }
 
   return default_shader_;
 }
 
-void Renderer::Destroy()
+QVariant Renderer::GetShaderProgram(const ShaderCode &code)
+{
+  QByteArray key = GetShaderProgramKey(code);
+
+  QMutexLocker locker(&shader_program_mutex_);
+
+  QVariant program = shader_programs_.value(key);
+
+  if (program.isNull()) {
+    program = CreateNativeShader(code);
+
+    if (!program.isNull()) {
+      shader_programs_.insert(key, program);
+    }
+  }
+
+  return program;
+}
+
+void Renderer::PrecompileShaders(const QVector<ShaderCode> &code)
+{
+  foreach (const ShaderCode &c, code) {
+    GetShaderProgram(c);
+  }
+}
+
+void Renderer::ExecuteCommandList(RenderCommandList *list)
+{
+  for (const RenderCommandList::Command &c : list->commands()) {
+    switch (c.type) {
+    case RenderCommandList::kCreateTexture:
+    {
+      const VideoParams &p = c.texture->params();
+
+      if (c.texture->type() == Texture::k3D) {
+        c.texture->set_id(CreateNativeTexture3D(p.effective_width(), p.effective_height(), p.effective_depth(), p.format(), p.channel_count()));
+      } else {
+        c.texture->set_id(CreateNativeTexture2D(p.effective_width(), p.effective_height(), p.format(), p.channel_count()));
+      }
+      break;
+    }
+    case RenderCommandList::kDestroyTexture:
+      DestroyNativeTexture(c.native);
+      break;
+    case RenderCommandList::kRecycleTexture:
+      if (!c.texture->id().isNull()) {
+        DestroyNativeTexture(c.texture->id());
+
+        // The handle belongs to the pool now, so the texture mustn't destroy it again
+        c.texture->set_id(QVariant());
+      }
+      break;
+    case RenderCommandList::kClear:
+      ClearDestination(c.texture.get(), c.clear_color[0], c.clear_color[1], c.clear_color[2], c.clear_color[3]);
+      break;
+    case RenderCommandList::kBlit:
+      Blit(c.shader, c.job, c.texture.get(), c.params, c.clear_destination);
+      break;
+    case RenderCommandList::kDownload:
+      DownloadFromTexture(c.texture.get(), c.data, c.linesize);
+      break;
+    case RenderCommandList::kStartDownload:
+      *c.download = StartDownloadFromTexture(c.texture.get());
+      break;
+    case RenderCommandList::kFlush:
+      Flush();
+      break;
+    }
+  }
+
+  list->Signal();
+}
+
+void Renderer::WaitForDownload(const QVariant &download, void *data, int linesize)
 {
-  if (!default_shader_.isNull()) {
-    DestroyNativeShader(default_shader_);
-    default_shader_.clear();
+  // FinishDownloadFromTexture only polls, so sleep between attempts rather than keeping the
+  // renderer's thread busy answering us
+  unsigned long interval = kDownloadPollMinInterval;
+
+  while (!FinishDownloadFromTexture(download, data, linesize)) {
+    QThread::usleep(interval);
+    interval = qMin(interval * 2, kDownloadPollMaxInterval);
   }
+}
 
+void Renderer::Destroy()
+{
+  // These are owned by the program cache
+  default_shader_.clear();
+  interlace_texture_.clear();
   color_cache_.clear();
 
-  if (!interlace_texture_.isNull()) {
-    DestroyNativeShader(interlace_texture_);
-    interlace_texture_.clear();
+  for (auto it=shader_programs_.cbegin(); it!=shader_programs_.cend(); it++) {
+    DestroyNativeShader(it.value());
   }
+  shader_programs_.clear();
 
   DestroyInternal();
 }
 
+QByteArray Renderer::GetShaderProgramKey(const ShaderCode &code)
+{
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  hash.addData(code.vert_code().toUtf8());
+  hash.addData("\0", 1);
+  hash.addData(code.frag_code().toUtf8());
+  return hash.result();
+}
+
 TexturePtr Renderer::CreateTextureFromNativeHandle(const QVariant &v, const VideoParams &params, Texture::Type type)
 {
   if (v.isNull()) {
@@ -115,6 +219,12 @@ bool Renderer::GetColorContext(const ColorTransformJob &color_job, Renderer::Col
 
   QString proc_id = color_job.id();
 
+  // Planar YUV input needs its own variant of the shader
+  bool yuv_input = color_job.IsInputYUV() && !color_job.CustomShaderSource();
+  if (yuv_input) {
+    proc_id.append(QStringLiteral(":yuv"));
+  }
+
   if (color_cache_.contains(proc_id)) {
     color_ctx = color_cache_.value(proc_id);
     return true;
@@ -142,10 +252,14 @@ bool Renderer::GetColorContext(const ColorTransformJob &color_job, Renderer::Col
       // Generate shader code using OCIO stub and our auto-generated name
       code = FileFunctions::ReadFileAsString(QStringLiteral(":shaders/colormanage.frag"));
       code.set_frag_code(code.frag_code().arg(shader_desc->getShaderText()));
+
+      if (yuv_input) {
+        code.set_frag_code(QStringLiteral("#define OVE_YUV_INPUT\n\n").append(code.frag_code()));
+      }
     }
 
     // Try to compile shader
-    color_ctx.compiled_shader = CreateNativeShader(code);
+    color_ctx.compiled_shader = GetShaderProgram(code);
 
     if (color_ctx.compiled_shader.isNull()) {
       return false;
@@ -231,6 +345,11 @@ void Renderer::BlitColorManaged(const ColorTransformJob &color_job, Texture *des
   job.Insert(QStringLiteral("ove_mvpmat"), NodeValue(NodeValue::kMatrix, color_job.GetTransformMatrix()));
   job.Insert(QStringLiteral("ove_cropmatrix"), NodeValue(NodeValue::kMatrix, color_job.GetCropMatrix().inverted()));
   job.Insert(QStringLiteral("ove_maintex_alpha"), NodeValue(NodeValue::kInt, int(color_job.GetInputAlphaAssociation())));
+  if (color_job.IsInputYUV()) {
+    job.Insert(QStringLiteral("ove_utex"), NodeValue(NodeValue::kTexture, QVariant::fromValue(color_job.GetInputUTexture())));
+    job.Insert(QStringLiteral("ove_vtex"), NodeValue(NodeValue::kTexture, QVariant::fromValue(color_job.GetInputVTexture())));
+    job.Insert(QStringLiteral("ove_yuvmat"), NodeValue(NodeValue::kMatrix, color_job.GetYUVMatrix()));
+  }
   job.Insert(color_job.GetValues());
   job.SetAlphaChannelRequired(color_job.GetAlphaChannelRequired());
 
@@ -30,6 +30,7 @@
 #include "node/node.h"
 #include "render/colorprocessor.h"
 #include "render/job/colortransformjob.h"
+#include "render/rendercommandlist.h"
 #include "render/videoparams.h"
 #include "texture.h"
 
@@ -78,6 +79,54 @@ public:
 
   QVariant GetDefaultShader();
 
+  /**
+   * @brief Get a compiled program for some shader code, only compiling it the first time
+   *
+   * Programs are keyed by a hash of their source, so anything requesting identical code shares
+   * one program. They're owned by the renderer and destroyed in Destroy(), callers must not
+   * destroy them themselves.
+   */
+  QVariant GetShaderProgram(const ShaderCode &code);
+
+  /**
+   * @brief Compile programs ahead of time so they're ready the first time they're used
+   */
+  void PrecompileShaders(const QVector<ShaderCode> &code);
+
+  /**
+   * @brief Start recording operations issued from the calling thread into a command list
+   *
+   * Renderers that execute on another thread can use this to send texture allocations, blits and
+   * downloads in one batch rather than one at a time. Textures allocated while recording may not
+   * have a native handle until the list is submitted. Renderers that execute operations
+   * immediately ignore this.
+   */
+  virtual void BeginCommandList(){}
+
+  /**
+   * @brief Execute everything recorded so far on the calling thread and wait for it to complete
+   *
+   * Recording continues afterwards.
+   */
+  virtual void SubmitCommandList(){}
+
+  /**
+   * @brief Submit any remaining commands and stop recording on the calling thread
+   */
+  virtual void EndCommandList(){}
+
+  /**
+   * @brief Execute each command in a list and signal its fence
+   *
+   * Must be called on the thread this renderer executes on.
+   */
+  void ExecuteCommandList(RenderCommandList *list);
+
+  /**
+   * @brief Block until a download started with StartDownloadFromTexture() has been copied into data
+   */
+  void WaitForDownload(const QVariant &download, void *data, int linesize);
+
   void Destroy();
 
   virtual void PostDestroy() = 0;
@@ -102,6 +151,20 @@ public slots:
 
   virtual void DownloadFromTexture(olive::Texture* texture, void* data, int linesize) = 0;
 
+  /**
+   * @brief Queue a download of a texture without waiting for it to complete
+   *
+   * Returns a handle that must be passed to FinishDownloadFromTexture() later.
+   */
+  virtual QVariant StartDownloadFromTexture(olive::Texture* texture) = 0;
+
+  /**
+   * @brief Copy a download started by StartDownloadFromTexture() into data
+   *
+   * Returns false without copying anything if the GPU hasn't finished the download yet.
+   */
+  virtual bool FinishDownloadFromTexture(QVariant download, void* data, int linesize) = 0;
+
   virtual void Flush() = 0;
 
   virtual Color GetPixelFromTexture(olive::Texture *texture, const QPointF &pt) = 0;
@@ -116,6 +179,17 @@ protected slots:
 protected:
   TexturePtr CreateTextureFromNativeHandle(const QVariant &v, const VideoParams &params, Texture::Type type = Texture::k2D);
 
+  /**
+   * @brief Create a texture whose native handle will be allocated later
+   *
+   * Returns nullptr if this renderer can't defer allocation right now, in which case the texture
+   * is created immediately.
+   */
+  virtual TexturePtr CreateDeferredTexture(const VideoParams &params, Texture::Type type)
+  {
+    return nullptr;
+  }
+
 private:
   struct ColorContext {
     struct LUT {
@@ -140,6 +214,18 @@ private:
 
   QVariant interlace_texture_;
 
+  static QByteArray GetShaderProgramKey(const ShaderCode &code);
+
+  QHash<QByteArray, QVariant> shader_programs_;
+
+  QMutex shader_program_mutex_;
+
+  /**
+   * @brief Range of microseconds WaitForDownload() sleeps between polls, doubling each time
+   */
+  static const unsigned long kDownloadPollMinInterval;
+  static const unsigned long kDownloadPollMaxInterval;
+
 };
 
 }
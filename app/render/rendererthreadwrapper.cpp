@@ -69,8 +69,57 @@ void RendererThreadWrapper::DestroyInternal()
   }
 }
 
+void RendererThreadWrapper::BeginCommandList()
+{
+  QMutexLocker locker(&command_list_lock_);
+
+  QThread *thread = QThread::currentThread();
+
+  if (!command_lists_.contains(thread)) {
+    command_lists_.insert(thread, new RenderCommandList());
+  }
+}
+
+void RendererThreadWrapper::SubmitCommandList()
+{
+  if (RenderCommandList *list = GetCommandList()) {
+    SubmitCommandListInternal(list);
+  }
+}
+
+void RendererThreadWrapper::EndCommandList()
+{
+  RenderCommandList *list = GetCommandList();
+
+  if (!list) {
+    return;
+  }
+
+  SubmitCommandListInternal(list);
+
+  command_list_lock_.lock();
+  command_lists_.remove(QThread::currentThread());
+  command_list_lock_.unlock();
+
+  if (list->IsEmpty()) {
+    delete list;
+  } else {
+    // Releasing the executed commands recorded some textures to destroy. Nothing needs to wait for
+    // that, so we let the renderer thread execute and delete the list whenever it gets to it.
+    QMetaObject::invokeMethod(inner_, [this, list]{
+      inner_->ExecuteCommandList(list);
+      delete list;
+    }, Qt::QueuedConnection);
+  }
+}
+
 void RendererThreadWrapper::ClearDestination(Texture *texture, double r, double g, double b, double a)
 {
+  if (RenderCommandList *list = GetCommandList()) {
+    list->ClearDestination(texture ? texture->shared_from_this() : nullptr, r, g, b, a);
+    return;
+  }
+
   QMetaObject::invokeMethod(inner_, "ClearDestination", Qt::BlockingQueuedConnection,
                             OLIVE_NS_ARG(Texture*, texture),
                             Q_ARG(double, r),
@@ -114,6 +163,11 @@ QVariant RendererThreadWrapper::CreateNativeTexture3D(int width, int height, int
 
 void RendererThreadWrapper::DestroyNativeTexture(QVariant texture)
 {
+  if (RenderCommandList *list = GetCommandList()) {
+    list->DestroyTexture(texture);
+    return;
+  }
+
   QMetaObject::invokeMethod(inner_, "DestroyNativeTexture", Qt::BlockingQueuedConnection,
                             Q_ARG(QVariant, texture));
 }
@@ -137,6 +191,9 @@ void RendererThreadWrapper::DestroyNativeShader(QVariant shader)
 
 void RendererThreadWrapper::UploadToTexture(Texture *texture, const void *data, int linesize)
 {
+  // The texture may not have been allocated yet, so execute anything pending first
+  SubmitCommandList();
+
   QMetaObject::invokeMethod(inner_, "UploadToTexture", Qt::BlockingQueuedConnection,
                             OLIVE_NS_ARG(Texture*, texture),
                             Q_ARG(const void*, data),
@@ -145,19 +202,67 @@ void RendererThreadWrapper::UploadToTexture(Texture *texture, const void *data,
 
 void RendererThreadWrapper::DownloadFromTexture(Texture *texture, void *data, int linesize)
 {
+  if (RenderCommandList *list = GetCommandList()) {
+    // Callers expect the data to be available when this returns, so this is where we submit
+    list->Download(texture->shared_from_this(), data, linesize);
+    SubmitCommandListInternal(list);
+    return;
+  }
+
   QMetaObject::invokeMethod(inner_, "DownloadFromTexture", Qt::BlockingQueuedConnection,
                             OLIVE_NS_ARG(Texture*, texture),
                             Q_ARG(void*, data),
                             Q_ARG(int, linesize));
 }
 
+QVariant RendererThreadWrapper::StartDownloadFromTexture(Texture *texture)
+{
+  QVariant download;
+
+  if (RenderCommandList *list = GetCommandList()) {
+    // Submitting here sends the download along with everything recorded before it, but unlike
+    // DownloadFromTexture we don't have to wait for the GPU to finish it
+    list->StartDownload(texture->shared_from_this(), &download);
+    SubmitCommandListInternal(list);
+    return download;
+  }
+
+  QMetaObject::invokeMethod(inner_, "StartDownloadFromTexture", Qt::BlockingQueuedConnection,
+                            Q_RETURN_ARG(QVariant, download),
+                            OLIVE_NS_ARG(Texture*, texture));
+
+  return download;
+}
+
+bool RendererThreadWrapper::FinishDownloadFromTexture(QVariant download, void *data, int linesize)
+{
+  SubmitCommandList();
+
+  bool finished;
+
+  QMetaObject::invokeMethod(inner_, "FinishDownloadFromTexture", Qt::BlockingQueuedConnection,
+                            Q_RETURN_ARG(bool, finished),
+                            Q_ARG(QVariant, download),
+                            Q_ARG(void*, data),
+                            Q_ARG(int, linesize));
+
+  return finished;
+}
+
 void RendererThreadWrapper::Flush()
 {
+  if (RenderCommandList *list = GetCommandList()) {
+    list->Flush();
+    return;
+  }
+
   QMetaObject::invokeMethod(inner_, "Flush", Qt::BlockingQueuedConnection);
 }
 
 Color RendererThreadWrapper::GetPixelFromTexture(Texture *texture, const QPointF &pt)
 {
+  SubmitCommandList();
+
   Color c;
 
   QMetaObject::invokeMethod(inner_, "GetPixelFromTexture", Qt::BlockingQueuedConnection,
@@ -170,6 +275,11 @@ Color RendererThreadWrapper::GetPixelFromTexture(Texture *texture, const QPointF
 
 void RendererThreadWrapper::Blit(QVariant shader, ShaderJob job, Texture *destination, VideoParams destination_params, bool clear_destination)
 {
+  if (RenderCommandList *list = GetCommandList()) {
+    list->Blit(shader, job, destination ? destination->shared_from_this() : nullptr, destination_params, clear_destination);
+    return;
+  }
+
   QMetaObject::invokeMethod(inner_, "Blit", Qt::BlockingQueuedConnection,
                             Q_ARG(QVariant, shader),
                             OLIVE_NS_ARG(ShaderJob, job),
@@ -178,4 +288,55 @@ void RendererThreadWrapper::Blit(QVariant shader, ShaderJob job, Texture *destin
                             Q_ARG(bool, clear_destination));
 }
 
+TexturePtr RendererThreadWrapper::CreateDeferredTexture(const VideoParams &params, Texture::Type type)
+{
+  RenderCommandList *list = GetCommandList();
+
+  if (!list) {
+    return nullptr;
+  }
+
+  TexturePtr texture = std::make_shared<Texture>(this, QVariant(), params, type);
+  list->CreateTexture(texture);
+
+  // Commands reference the texture through `texture`, while the caller gets its own reference. When
+  // the caller releases it, nothing recorded afterwards can use the texture, so its native handle
+  // can go back to the pool at that point in the list rather than after the whole list has run.
+  QThread *recorder = QThread::currentThread();
+
+  return TexturePtr(texture.get(), [this, texture, recorder](Texture *){
+    // Only record into the list that recorded this texture's commands, another thread's list may
+    // be executed before them
+    if (QThread::currentThread() == recorder) {
+      if (RenderCommandList *recording = GetCommandList()) {
+        recording->RecycleTexture(texture);
+      }
+    }
+  });
+}
+
+RenderCommandList *RendererThreadWrapper::GetCommandList()
+{
+  QMutexLocker locker(&command_list_lock_);
+
+  return command_lists_.value(QThread::currentThread());
+}
+
+void RendererThreadWrapper::SubmitCommandListInternal(RenderCommandList *list)
+{
+  if (list->IsEmpty()) {
+    return;
+  }
+
+  list->ResetFence();
+
+  QMetaObject::invokeMethod(inner_, [this, list]{
+    inner_->ExecuteCommandList(list);
+  }, Qt::QueuedConnection);
+
+  list->Wait();
+
+  list->Clear();
+}
+
 }
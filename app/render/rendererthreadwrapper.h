@@ -43,6 +43,12 @@ public:
 
   virtual void PostDestroy() override {}
 
+  virtual void BeginCommandList() override;
+
+  virtual void SubmitCommandList() override;
+
+  virtual void EndCommandList() override;
+
 public slots:
   virtual void PostInit() override;
 
@@ -63,6 +69,10 @@ public slots:
 
   virtual void DownloadFromTexture(olive::Texture* texture, void* data, int linesize) override;
 
+  virtual QVariant StartDownloadFromTexture(olive::Texture* texture) override;
+
+  virtual bool FinishDownloadFromTexture(QVariant download, void* data, int linesize) override;
+
   virtual void Flush() override;
 
   virtual Color GetPixelFromTexture(olive::Texture *texture, const QPointF &pt) override;
@@ -74,11 +84,22 @@ protected slots:
                     olive::VideoParams destination_params,
                     bool clear_destination) override;
 
+protected:
+  virtual TexturePtr CreateDeferredTexture(const VideoParams &params, Texture::Type type) override;
+
 private:
+  RenderCommandList *GetCommandList();
+
+  void SubmitCommandListInternal(RenderCommandList *list);
+
   Renderer* inner_;
 
   QThread* thread_;
 
+  QHash<QThread*, RenderCommandList*> command_lists_;
+
+  QMutex command_list_lock_;
+
 };
 
 }
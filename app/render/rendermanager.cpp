@@ -24,6 +24,7 @@
 #include <QMatrix4x4>
 #include <QThread>
 
+#include "common/jobtime.h"
 #include "config/config.h"
 #include "core.h"
 #include "render/opengl/openglrenderer.h"
@@ -54,21 +55,35 @@ RenderManager::RenderManager(QObject *parent) :
 
     decoder_cache_ = new DecoderCache();
     shader_cache_ = new ShaderCache();
+    tempo_cache_ = new TempoCache();
+    track_audio_cache_ = new TrackAudioCache();
   } else {
     qCritical() << "Tried to initialize unknown graphics backend";
     context_ = nullptr;
     decoder_cache_ = nullptr;
+    tempo_cache_ = nullptr;
+    track_audio_cache_ = nullptr;
   }
 
   QTimer *decoder_clear_timer = new QTimer(this);
   decoder_clear_timer->setInterval(kDecoderMaximumInactivity);
   connect(decoder_clear_timer, &QTimer::timeout, this, &RenderManager::ClearOldDecoders);
+  connect(decoder_clear_timer, &QTimer::timeout, this, &RenderManager::ClearOldTempoStreams);
+  connect(decoder_clear_timer, &QTimer::timeout, this, &RenderManager::ClearOldTrackAudio);
   decoder_clear_timer->start();
+
+  // Compile one shader at a time so rendering isn't starved of the renderer thread
+  precompile_pool_.setMaxThreadCount(1);
 }
 
 RenderManager::~RenderManager()
 {
+  precompile_pool_.clear();
+  precompile_pool_.waitForDone();
+
   if (context_) {
+    delete track_audio_cache_;
+    delete tempo_cache_;
     delete shader_cache_;
     delete decoder_cache_;
 
@@ -80,7 +95,8 @@ RenderManager::~RenderManager()
 
 RenderTicketPtr RenderManager::RenderFrame(Node *node, const VideoParams &vparam, const AudioParams &param,
                                            ColorManager* color_manager, const rational& time, RenderMode::Mode mode,
-                                           FrameHashCache* cache, RenderTicketPriority priority, ReturnType return_type)
+                                           FrameHashCache* cache, RenderTicketPriority priority, RenderRequest::ReturnType return_type,
+                                           qint64 deadline)
 {
   return RenderFrame(node,
                      color_manager,
@@ -94,7 +110,8 @@ RenderTicketPtr RenderManager::RenderFrame(Node *node, const VideoParams &vparam
                      nullptr,
                      cache,
                      priority,
-                     return_type);
+                     return_type,
+                     deadline);
 }
 
 RenderTicketPtr RenderManager::RenderFrame(Node *node, ColorManager* color_manager,
@@ -103,30 +120,40 @@ RenderTicketPtr RenderManager::RenderFrame(Node *node, ColorManager* color_manag
                                            const QSize& force_size,
                                            const QMatrix4x4& force_matrix, VideoParams::Format force_format,
                                            ColorProcessorPtr force_color_output,
-                                           FrameHashCache* cache, RenderTicketPriority priority, ReturnType return_type)
+                                           FrameHashCache* cache, RenderTicketPriority priority, RenderRequest::ReturnType return_type,
+                                           qint64 deadline)
 {
-  // Create ticket
-  RenderTicketPtr ticket = std::make_shared<RenderTicket>();
-
-  ticket->setProperty("node", Node::PtrToValue(node));
-  ticket->setProperty("time", QVariant::fromValue(time));
-  ticket->setProperty("size", force_size);
-  ticket->setProperty("matrix", force_matrix);
-  ticket->setProperty("format", force_format);
-  ticket->setProperty("mode", mode);
-  ticket->setProperty("type", kTypeVideo);
-  ticket->setProperty("colormanager", Node::PtrToValue(color_manager));
-  ticket->setProperty("coloroutput", QVariant::fromValue(force_color_output));
-  ticket->setProperty("vparam", QVariant::fromValue(video_params));
-  ticket->setProperty("aparam", QVariant::fromValue(audio_params));
-  ticket->setProperty("return", return_type);
+  RenderRequest request;
+
+  request.type = RenderRequest::kTypeVideo;
+  request.node = node;
+  request.time = time;
+  request.force_size = force_size;
+  request.force_matrix = force_matrix;
+  request.force_format = force_format;
+  request.mode = mode;
+  request.priority = priority;
+  request.color_manager = color_manager;
+  request.force_color_output = force_color_output;
+  request.video_params = video_params;
+  request.audio_params = audio_params;
+  request.return_type = return_type;
+  request.deadline = deadline;
 
   if (cache) {
-    ticket->setProperty("cache", cache->GetCacheDirectory());
-    ticket->setProperty("cachetimebase", QVariant::fromValue(cache->GetTimebase()));
-    ticket->setProperty("cacheuuid", QVariant::fromValue(cache->GetUuid()));
+    request.cache_dir = cache->GetCacheDirectory();
+    request.cache_timebase = cache->GetTimebase();
+    request.cache_uuid = cache->GetUuid();
+    request.cache_deduplicate = OLIVE_CONFIG("DiskCacheDeduplicate").toBool();
+
+    // A ticket created later never renders an older graph than earlier ones, so if renders of the
+    // same time finish out of order, the one created last is the one that should stay cached
+    request.cache_version = JobTime().value();
   }
 
+  // Create ticket
+  RenderTicketPtr ticket = std::make_shared<RenderTicket>(request);
+
   AddTicket(ticket, priority);
 
   return ticket;
@@ -134,15 +161,18 @@ RenderTicketPtr RenderManager::RenderFrame(Node *node, ColorManager* color_manag
 
 RenderTicketPtr RenderManager::RenderAudio(Node *node, const TimeRange &r, const AudioParams &params, RenderMode::Mode mode, bool generate_waveforms, RenderTicketPriority priority)
 {
-  // Create ticket
-  RenderTicketPtr ticket = std::make_shared<RenderTicket>();
+  RenderRequest request;
 
-  ticket->setProperty("node", Node::PtrToValue(node));
-  ticket->setProperty("time", QVariant::fromValue(r));
-  ticket->setProperty("type", kTypeAudio);
-  ticket->setProperty("mode", mode);
-  ticket->setProperty("enablewaveforms", generate_waveforms);
-  ticket->setProperty("aparam", QVariant::fromValue(params));
+  request.type = RenderRequest::kTypeAudio;
+  request.node = node;
+  request.range = r;
+  request.mode = mode;
+  request.priority = priority;
+  request.enable_waveforms = generate_waveforms;
+  request.audio_params = params;
+
+  // Create ticket
+  RenderTicketPtr ticket = std::make_shared<RenderTicket>(request);
 
   AddTicket(ticket, priority);
 
@@ -159,7 +189,61 @@ void RenderManager::RunTicket(RenderTicketPtr ticket) const
     return;
   }
 
-  RenderProcessor::Process(ticket, context_, decoder_cache_, shader_cache_);
+  qint64 deadline = ticket->request().deadline;
+  if (deadline && QDateTime::currentMSecsSinceEpoch() > deadline) {
+    // Result can't be delivered in time anymore, so don't spend any time rendering it
+    ticket->render_result().skipped = true;
+    ticket->Finish();
+    return;
+  }
+
+  RenderProcessor::Process(ticket, context_, decoder_cache_, shader_cache_, tempo_cache_, track_audio_cache_);
+}
+
+void RenderManager::WorkerIdle() const
+{
+  // Nothing left to overlap the last frame's download with
+  RenderProcessor::FinishPendingDownload();
+}
+
+void RenderManager::PrecompileShaders(const QVector<Node *> &nodes)
+{
+  if (!context_) {
+    return;
+  }
+
+  // Retrieve code here since the nodes belong to this thread
+  QVector<QPair<QString, ShaderCode> > programs;
+  QSet<QString> seen;
+
+  foreach (Node *n, nodes) {
+    foreach (const QString &id, n->GetShaderIDs()) {
+      QString full_shader_id = QStringLiteral("%1:%2").arg(n->id(), id);
+
+      if (!seen.contains(full_shader_id)) {
+        seen.insert(full_shader_id);
+        programs.append({full_shader_id, n->GetShaderCode(id)});
+      }
+    }
+  }
+
+  QtConcurrent::run(&precompile_pool_, [this, programs]{
+    for (const QPair<QString, ShaderCode> &p : programs) {
+      {
+        QMutexLocker locker(shader_cache_->mutex());
+        if (shader_cache_->contains(p.first)) {
+          continue;
+        }
+      }
+
+      QVariant shader = context_->GetShaderProgram(p.second);
+
+      if (!shader.isNull()) {
+        QMutexLocker locker(shader_cache_->mutex());
+        shader_cache_->insert(p.first, shader);
+      }
+    }
+  });
 }
 
 void RenderManager::ClearOldDecoders()
@@ -169,10 +253,20 @@ void RenderManager::ClearOldDecoders()
   qint64 min_age = QDateTime::currentMSecsSinceEpoch() - kDecoderMaximumInactivity;
 
   for (auto it=decoder_cache_->begin(); it!=decoder_cache_->end(); ) {
-    DecoderPair decoder = it.value();
+    QVector<DecoderPair> &pool = it.value();
+
+    // Evict each instance in the pool individually so idle extras are released even while one
+    // instance for the stream is still in use
+    for (int i=pool.size()-1; i>=0; i--) {
+      const DecoderPair &decoder = pool.at(i);
 
-    if (decoder.decoder->GetLastAccessedTime() < min_age) {
-      decoder.decoder->Close();
+      if (decoder.decoder->GetLastAccessedTime() < min_age) {
+        decoder.decoder->Close();
+        pool.removeAt(i);
+      }
+    }
+
+    if (pool.isEmpty()) {
       it = decoder_cache_->erase(it);
     } else {
       it++;
@@ -180,4 +274,60 @@ void RenderManager::ClearOldDecoders()
   }
 }
 
+void RenderManager::ClearOldTempoStreams()
+{
+  if (!tempo_cache_) {
+    return;
+  }
+
+  QMutexLocker locker(tempo_cache_->mutex());
+
+  qint64 min_age = QDateTime::currentMSecsSinceEpoch() - kDecoderMaximumInactivity;
+
+  for (auto it=tempo_cache_->begin(); it!=tempo_cache_->end(); ) {
+    QVector<TempoStreamPtr> &pool = it.value();
+
+    for (int i=pool.size()-1; i>=0; i--) {
+      if (!pool.at(i)->in_use && pool.at(i)->last_used < min_age) {
+        pool.removeAt(i);
+      }
+    }
+
+    if (pool.isEmpty()) {
+      it = tempo_cache_->erase(it);
+    } else {
+      it++;
+    }
+  }
+}
+
+void RenderManager::ClearOldTrackAudio()
+{
+  if (!track_audio_cache_) {
+    return;
+  }
+
+  QMutexLocker locker(track_audio_cache_->mutex());
+
+  qint64 min_age = QDateTime::currentMSecsSinceEpoch() - kDecoderMaximumInactivity;
+
+  for (auto it=track_audio_cache_->begin(); it!=track_audio_cache_->end(); ) {
+    QMap<qint64, TrackAudioChunk> &chunks = it.value();
+
+    for (auto jt=chunks.begin(); jt!=chunks.end(); ) {
+      if (jt->last_used < min_age) {
+        jt = chunks.erase(jt);
+      } else {
+        jt++;
+      }
+    }
+
+    if (chunks.isEmpty()) {
+      it = track_audio_cache_->erase(it);
+    } else {
+      it++;
+    }
+  }
+}
+
 }
@@ -63,11 +63,6 @@ public:
     return instance_;
   }
 
-  enum ReturnType {
-    kTexture,
-    kFrame
-  };
-
   /**
    * @brief Asynchronously generate a frame at a given time
    *
@@ -78,14 +73,16 @@ public:
    */
   RenderTicketPtr RenderFrame(Node *node, const VideoParams &vparam, const AudioParams &param, ColorManager* color_manager,
                               const rational& time, RenderMode::Mode mode,
-                              FrameHashCache* cache = nullptr, RenderTicketPriority priority = RenderTicketPriority::kNormal, ReturnType return_type = kFrame);
+                              FrameHashCache* cache = nullptr, RenderTicketPriority priority = RenderTicketPriority::kBackground, RenderRequest::ReturnType return_type = RenderRequest::kFrame,
+                              qint64 deadline = 0);
   RenderTicketPtr RenderFrame(Node *node, ColorManager* color_manager,
                               const rational& time, RenderMode::Mode mode,
                               const VideoParams& video_params, const AudioParams& audio_params,
                               const QSize& force_size,
                               const QMatrix4x4& force_matrix, VideoParams::Format force_format,
                               ColorProcessorPtr force_color_output,
-                              FrameHashCache* cache = nullptr, RenderTicketPriority priority = RenderTicketPriority::kNormal, ReturnType return_type = kFrame);
+                              FrameHashCache* cache = nullptr, RenderTicketPriority priority = RenderTicketPriority::kBackground, RenderRequest::ReturnType return_type = RenderRequest::kFrame,
+                              qint64 deadline = 0);
 
   /**
    * @brief Asynchronously generate a chunk of audio
@@ -94,14 +91,16 @@ public:
    *
    * This function is thread-safe.
    */
-  RenderTicketPtr RenderAudio(Node *viewer, const TimeRange& r, const AudioParams& params, RenderMode::Mode mode, bool generate_waveforms, RenderTicketPriority priority = RenderTicketPriority::kNormal);
+  RenderTicketPtr RenderAudio(Node *viewer, const TimeRange& r, const AudioParams& params, RenderMode::Mode mode, bool generate_waveforms, RenderTicketPriority priority = RenderTicketPriority::kBackground);
 
   virtual void RunTicket(RenderTicketPtr ticket) const override;
 
-  enum TicketType {
-    kTypeVideo,
-    kTypeAudio
-  };
+  virtual void WorkerIdle() const override;
+
+  /**
+   * @brief Compile the shaders used by these nodes in the background so they're ready on first use
+   */
+  void PrecompileShaders(const QVector<Node*> &nodes);
 
   Backend backend() const
   {
@@ -130,15 +129,23 @@ private:
 
   ShaderCache* shader_cache_;
 
+  TempoCache* tempo_cache_;
+
+  TrackAudioCache* track_audio_cache_;
+
+  QThreadPool precompile_pool_;
+
   static constexpr auto kDecoderMaximumInactivity = 10000;
 
 private slots:
   void ClearOldDecoders();
 
+  void ClearOldTempoStreams();
+
+  void ClearOldTrackAudio();
+
 };
 
 }
 
-Q_DECLARE_METATYPE(olive::RenderManager::TicketType)
-
 #endif // RENDERBACKEND_H
@@ -20,26 +20,43 @@
 
 #include "renderprocessor.h"
 
+#include <QDateTime>
+#include <QFileInfo>
 #include <QOpenGLContext>
 #include <QVector2D>
 #include <QVector3D>
 #include <QVector4D>
 
 #include "audio/audioprocessor.h"
+#include "codec/conformmanager.h"
 #include "node/block/clip/clip.h"
 #include "node/block/transition/transition.h"
+#include "node/math/math/math.h"
+#include "node/project/footage/footage.h"
 #include "node/project/project.h"
+#include "render/framefingerprint.h"
 #include "rendermanager.h"
 
 namespace olive {
 
 #define super NodeTraverser
 
-RenderProcessor::RenderProcessor(RenderTicketPtr ticket, Renderer *render_ctx, DecoderCache* decoder_cache, ShaderCache *shader_cache) :
+const int RenderProcessor::kMaxDecodersPerStream = 4;
+const int RenderProcessor::kAutomationControlInterval = 32;
+const int RenderProcessor::kMaxTempoStreamsPerClip = 2;
+const rational RenderProcessor::kTempoLookahead = rational(1, 10);
+const rational RenderProcessor::kTrackAudioChunkLength = rational(1, 2);
+const int RenderProcessor::kMaxTrackAudioChunksPerTrack = 16;
+thread_local std::function<void()> RenderProcessor::pending_download_;
+
+RenderProcessor::RenderProcessor(RenderTicketPtr ticket, Renderer *render_ctx, DecoderCache* decoder_cache, ShaderCache *shader_cache, TempoCache *tempo_cache, TrackAudioCache *track_audio_cache) :
   ticket_(ticket),
   render_ctx_(render_ctx),
   decoder_cache_(decoder_cache),
-  shader_cache_(shader_cache)
+  shader_cache_(shader_cache),
+  tempo_cache_(tempo_cache),
+  track_audio_cache_(track_audio_cache),
+  footage_retrievals_(0)
 {
 }
 
@@ -48,7 +65,9 @@ TexturePtr RenderProcessor::GenerateTexture(const rational &time, const rational
   TimeRange range = TimeRange(time, time + frame_length);
 
   NodeValueTable table;
-  if (Node* node = Node::ValueToPtr<Node>(ticket_->property("node"))) {
+  if (Node* node = ticket_->request().node) {
+    // Knowing the last consumer of each shared node lets its textures be released as early as possible
+    PlanTraversal(node, range);
     table = GenerateTable(node, range);
   }
 
@@ -59,18 +78,76 @@ TexturePtr RenderProcessor::GenerateTexture(const rational &time, const rational
   return tex_val.toTexture();
 }
 
-FramePtr RenderProcessor::GenerateFrame(TexturePtr texture, const rational& time)
+bool RenderProcessor::CanDeduplicateFrame() const
+{
+  const RenderRequest &request = ticket_->request();
+
+  return request.force_size.isNull()
+      && request.force_matrix.isIdentity()
+      && request.force_format == VideoParams::kFormatInvalid
+      && !request.force_color_output;
+}
+
+QByteArray RenderProcessor::GenerateFingerprint(const rational &time, const rational &frame_length) const
+{
+  const RenderRequest &request = ticket_->request();
+
+  TimeRange range(time, time + frame_length);
+  QByteArray fingerprint = FrameFingerprint::Generate(request.node, range, GetCacheVideoParams(), request.color_manager);
+
+  if (GetCacheVideoParams().interlacing() != VideoParams::kInterlaceNone) {
+    fingerprint.append(FrameFingerprint::Generate(request.node, range + frame_length, GetCacheVideoParams(), request.color_manager));
+  }
+
+  return fingerprint;
+}
+
+bool RenderProcessor::FinishWithCachedFrame(const rational &time)
+{
+  const RenderRequest &request = ticket_->request();
+
+  if (request.return_type == RenderRequest::kNone) {
+    // The reference is all the cache needed, no need to decode the frame
+    ticket_->render_result().cached = true;
+    ticket_->Finish(QVariant());
+    return true;
+  }
+
+  FramePtr frame = FrameHashCache::LoadCacheFrame(request.cache_dir,
+                                                  request.cache_uuid,
+                                                  Timecode::time_to_timestamp(time, request.cache_timebase, Timecode::kRound));
+  if (!frame) {
+    return false;
+  }
+
+  frame->set_timestamp(time);
+
+  ticket_->render_result().cached = true;
+
+  if (request.return_type == RenderRequest::kTexture) {
+    TexturePtr texture = render_ctx_->CreateTexture(frame->video_params(), frame->data(), frame->linesize_pixels());
+    render_ctx_->Flush();
+    ticket_->Finish(QVariant::fromValue(texture));
+  } else {
+    ticket_->Finish(QVariant::fromValue(frame));
+  }
+
+  return true;
+}
+
+FramePtr RenderProcessor::GenerateFrame(TexturePtr texture, const rational& time, QVariant *download)
 {
   // Set up output frame parameters
   VideoParams frame_params = GetCacheVideoParams();
+  const RenderRequest &request = ticket_->request();
 
-  QSize frame_size = ticket_->property("size").value<QSize>();
+  const QSize &frame_size = request.force_size;
   if (!frame_size.isNull()) {
     frame_params.set_width(frame_size.width());
     frame_params.set_height(frame_size.height());
   }
 
-  VideoParams::Format frame_format = static_cast<VideoParams::Format>(ticket_->property("format").toInt());
+  VideoParams::Format frame_format = request.force_format;
   if (frame_format != VideoParams::kFormatInvalid) {
     frame_params.set_format(frame_format);
   }
@@ -87,7 +164,7 @@ FramePtr RenderProcessor::GenerateFrame(TexturePtr texture, const rational& time
     memset(frame->data(), 0, frame->allocated_size());
   } else {
     // Dump texture contents to frame
-    ColorProcessorPtr output_color_transform = ticket_->property("coloroutput").value<ColorProcessorPtr>();
+    const ColorProcessorPtr &output_color_transform = request.force_color_output;
     const VideoParams& tex_params = texture->params();
 
     if (tex_params.effective_width() != frame_params.effective_width()
@@ -96,7 +173,7 @@ FramePtr RenderProcessor::GenerateFrame(TexturePtr texture, const rational& time
         || output_color_transform) {
       TexturePtr blit_tex = render_ctx_->CreateTexture(frame_params);
 
-      QMatrix4x4 matrix = ticket_->property("matrix").value<QMatrix4x4>();
+      const QMatrix4x4 &matrix = request.force_matrix;
 
       if (output_color_transform) {
         // Yes color transform, blit color managed
@@ -121,7 +198,8 @@ FramePtr RenderProcessor::GenerateFrame(TexturePtr texture, const rational& time
       texture = blit_tex;
     }
 
-    render_ctx_->DownloadFromTexture(texture.get(), frame->data(), frame->linesize_pixels());
+    // Start the download without waiting for it, the caller will collect it with WaitForDownload
+    *download = render_ctx_->StartDownloadFromTexture(texture.get());
   }
 
   return frame;
@@ -130,24 +208,41 @@ FramePtr RenderProcessor::GenerateFrame(TexturePtr texture, const rational& time
 void RenderProcessor::Run()
 {
   // Depending on the render ticket type, start a job
-  RenderManager::TicketType type = ticket_->property("type").value<RenderManager::TicketType>();
+  const RenderRequest &request = ticket_->request();
 
   SetCancelPointer(&ticket_->IsCancelled());
 
-  SetCacheVideoParams(ticket_->property("vparam").value<VideoParams>());
-  SetCacheAudioParams(ticket_->property("aparam").value<AudioParams>());
+  SetCacheVideoParams(request.video_params);
+  SetCacheAudioParams(request.audio_params);
 
-  switch (type) {
-  case RenderManager::kTypeVideo:
+  switch (request.type) {
+  case RenderRequest::kTypeVideo:
   {
-    rational time = ticket_->property("time").value<rational>();
+    const rational &time = request.time;
 
     rational frame_length = GetCacheVideoParams().frame_rate_as_time_base();
     if (GetCacheVideoParams().interlacing() != VideoParams::kInterlaceNone) {
       frame_length /= 2;
     }
 
+    // If an identical frame is already in the cache, reference it rather than rendering again
+    QByteArray fingerprint;
+    if (!request.cache_dir.isEmpty() && request.cache_deduplicate && CanDeduplicateFrame()) {
+      fingerprint = GenerateFingerprint(time, frame_length);
+
+      if (FrameHashCache::SaveCacheFrameReference(request.cache_dir, request.cache_uuid, time, request.cache_timebase, fingerprint, request.cache_version)
+          && FinishWithCachedFrame(time)) {
+        FinishPendingDownload();
+        break;
+      }
+    }
+
+    // Record the GPU work for this frame so it can be sent to the renderer all at once
+    render_ctx_->BeginCommandList();
+
     TexturePtr texture = GenerateTexture(time, frame_length);
+    FramePtr frame;
+    QVariant download;
 
     if (GetCacheVideoParams().interlacing() != VideoParams::kInterlaceNone) {
       // Get next between frame and interlace it
@@ -161,67 +256,102 @@ void RenderProcessor::Run()
       texture = render_ctx_->InterlaceTexture(top, bottom, GetCacheVideoParams());
     }
 
-    if (HeardCancel()) {
-      // Finish cancelled ticket with nothing since we can't guarantee the frame we generated
-      // is actually "complete
-      ticket_->Finish();
-    } else {
-      RenderManager::ReturnType return_type = RenderManager::ReturnType(ticket_->property("return").toInt());
+    if (!HeardCancel() && (request.return_type == RenderRequest::kFrame || !request.cache_dir.isEmpty())) {
+      // Convert to CPU frame, the download will submit everything recorded for this frame
+      frame = GenerateFrame(texture, time, &download);
+    }
 
-      FramePtr frame;
-      QString cache = ticket_->property("cache").toString();
+    // Release intermediate textures while still recording so they're destroyed in one batch
+    ClearMemo();
 
-      if (return_type == RenderManager::kFrame || !cache.isEmpty()) {
-        // Convert to CPU frame
-        frame = GenerateFrame(texture, time);
+    render_ctx_->EndCommandList();
 
-        // Save to cache if requested
-        if (!cache.isEmpty()) {
-          rational timebase = ticket_->property("cachetimebase").value<rational>();
-          QUuid uuid = ticket_->property("cacheuuid").value<QUuid>();
-          bool cache_result = FrameHashCache::SaveCacheFrame(cache, uuid, time, timebase, frame);
-          ticket_->setProperty("cached", cache_result);
-        }
+    // Everything after this either needs the downloaded frame or waits for the GPU anyway
+    bool cancelled = HeardCancel();
+    Renderer *render_ctx = render_ctx_;
+    RenderTicketPtr ticket = ticket_;
+    VideoParams video_params = GetCacheVideoParams();
+    auto finish = [render_ctx, ticket, time, texture, frame, download, fingerprint, cancelled, video_params]() mutable {
+      const RenderRequest &finished_request = ticket->request();
+
+      if (!download.isNull()) {
+        // Collect the download even if we were cancelled so its pixel buffer is released
+        render_ctx->WaitForDownload(download, frame->data(), frame->linesize_pixels());
+      }
+
+      if (cancelled) {
+        // Finish cancelled ticket with nothing since we can't guarantee the frame we generated
+        // is actually "complete
+        ticket->Finish();
+        return;
+      }
+
+      // Save to cache if requested
+      if (!finished_request.cache_dir.isEmpty()) {
+        ticket->render_result().cached = FrameHashCache::SaveCacheFrame(finished_request.cache_dir, finished_request.cache_uuid, time, finished_request.cache_timebase, frame, fingerprint, finished_request.cache_version);
       }
 
-      if (return_type == RenderManager::kTexture) {
+      if (finished_request.return_type == RenderRequest::kTexture) {
         // Return GPU texture
         if (!texture) {
-          texture = render_ctx_->CreateTexture(GetCacheVideoParams());
-          render_ctx_->ClearDestination(texture.get());
+          texture = render_ctx->CreateTexture(video_params);
+          render_ctx->ClearDestination(texture.get());
         }
 
-        render_ctx_->Flush();
+        render_ctx->Flush();
 
-        ticket_->Finish(QVariant::fromValue(texture));
+        ticket->Finish(QVariant::fromValue(texture));
+      } else if (finished_request.return_type == RenderRequest::kFrame) {
+        ticket->Finish(QVariant::fromValue(frame));
       } else {
-        ticket_->Finish(QVariant::fromValue(frame));
+        ticket->Finish(QVariant());
       }
+    };
+
+    // This thread has recorded and submitted its next frame by now, so the previous one's download
+    // has had all that time to complete
+    FinishPendingDownload();
+
+    if (request.priority >= RenderTicketPriority::kAutoCache && !request.deadline) {
+      // Nobody is waiting on this frame right now, so rather than waiting for the GPU, start on
+      // the next ticket and collect this one after that one has been submitted
+      pending_download_ = finish;
+    } else {
+      finish();
     }
     break;
   }
-  case RenderManager::kTypeAudio:
+  case RenderRequest::kTypeAudio:
   {
-    TimeRange time = ticket_->property("time").value<TimeRange>();
+    FinishPendingDownload();
 
-    NodeValueTable table;
-    if (Node* node = Node::ValueToPtr<Node>(ticket_->property("node"))) {
-      table = GenerateTable(node, time);
-    }
+    const TimeRange &time = request.range;
+
+    SampleBuffer samples;
+    if (Node* node = request.node) {
+      QVector<const Track*> tracks;
 
-    NodeValue sample_val = table.Get(NodeValue::kSamples);
+      if (GetMixBusTracks(node, &tracks)) {
+        // Tracks are only being summed, skip traversing the add nodes and mix them ourselves
+        samples = MixTracks(tracks, time);
+      } else {
+        NodeValueTable table = GenerateTable(node, time);
 
-    ResolveJobs(sample_val, time);
+        NodeValue sample_val = table.Get(NodeValue::kSamples);
+
+        ResolveJobs(sample_val, time);
+
+        samples = sample_val.toSamples();
+      }
+    }
 
-    SampleBuffer samples = sample_val.toSamples();
     if (samples.is_allocated()) {
       samples.clamp();
 
-      if (ticket_->property("enablewaveforms").toBool()) {
-        AudioVisualWaveform vis;
+      if (request.enable_waveforms) {
+        AudioVisualWaveform &vis = ticket_->render_result().waveform;
         vis.set_channel_count(samples.audio_params().channel_count());
         vis.OverwriteSamples(samples, samples.audio_params().sample_rate());
-        ticket_->setProperty("waveform", QVariant::fromValue(vis));
       }
     }
 
@@ -238,39 +368,410 @@ void RenderProcessor::Run()
   }
 }
 
-DecoderPtr RenderProcessor::ResolveDecoderFromInput(const QString& decoder_id, const Decoder::CodecStream &stream)
+DecoderPtr RenderProcessor::ResolveDecoderFromInput(const QString& decoder_id, const Decoder::CodecStream &stream, const rational &time)
 {
   if (!stream.IsValid()) {
     qWarning() << "Attempted to resolve the decoder of a null stream";
     return nullptr;
   }
 
+  qint64 file_last_modified = QFileInfo(stream.filename()).lastModified().toMSecsSinceEpoch();
+
   QMutexLocker locker(decoder_cache_->mutex());
 
-  DecoderPair decoder = decoder_cache_->value(stream);
+  QVector<DecoderPair> &pool = (*decoder_cache_)[stream];
 
-  qint64 file_last_modified = QFileInfo(stream.filename()).lastModified().toMSecsSinceEpoch();
+  // Drop any decoders for an older version of this file
+  for (int i=pool.size()-1; i>=0; i--) {
+    if (pool.at(i).last_modified != file_last_modified) {
+      pool.removeAt(i);
+    }
+  }
 
-  if (!decoder.decoder || decoder.last_modified != file_last_modified) {
-    // No decoder
-    decoder.decoder = Decoder::CreateFromID(decoder_id);
-    decoder.last_modified = file_last_modified;
-    decoder_cache_->insert(stream, decoder);
-    locker.unlock();
-
-    if (!decoder.decoder->Open(stream)) {
-      qWarning() << "Failed to open decoder for" << stream.filename()
-                 << "::" << stream.stream();
-      return nullptr;
+  // Prefer an idle decoder that's already near the requested time
+  int best = -1;
+  int64_t best_cost = Decoder::kSeekRequired;
+  for (int i=0; i<pool.size(); i++) {
+    int64_t cost;
+    if (pool.at(i).decoder->GetSeekCost(time, &cost) && (best == -1 || cost < best_cost)) {
+      best = i;
+      best_cost = cost;
     }
   }
 
+  if (best == -1 && pool.size() >= kMaxDecodersPerStream) {
+    // Every decoder is busy and we can't open any more, so queue on the one whose last request
+    // was closest to this one
+    rational best_distance;
+    for (int i=0; i<pool.size(); i++) {
+      const rational &last_time = pool.at(i).last_time;
+      if (time == Decoder::kAnyTimecode || last_time == Decoder::kAnyTimecode) {
+        if (best == -1) {
+          best = i;
+        }
+        continue;
+      }
+
+      rational distance = (last_time > time) ? last_time - time : time - last_time;
+      if (best == -1 || distance < best_distance) {
+        best = i;
+        best_distance = distance;
+      }
+    }
+  }
+
+  if (best != -1) {
+    DecoderPair &decoder = pool[best];
+    decoder.last_time = time;
+    return decoder.decoder;
+  }
+
+  // Open a new decoder without holding the cache lock, since opening can be slow
+  locker.unlock();
+
+  DecoderPair decoder;
+  decoder.decoder = Decoder::CreateFromID(decoder_id);
+  decoder.last_modified = file_last_modified;
+  decoder.last_time = time;
+
+  if (!decoder.decoder->Open(stream)) {
+    qWarning() << "Failed to open decoder for" << stream.filename()
+               << "::" << stream.stream();
+    return nullptr;
+  }
+
+  locker.relock();
+
+  // Another thread may have filled the pool while we were opening, in which case this decoder is
+  // only used for this request and closes automatically when released
+  QVector<DecoderPair> &current_pool = (*decoder_cache_)[stream];
+  if (current_pool.size() < kMaxDecodersPerStream) {
+    current_pool.append(decoder);
+  }
+
   return decoder.decoder;
 }
 
-void RenderProcessor::Process(RenderTicketPtr ticket, Renderer *render_ctx, DecoderCache *decoder_cache, ShaderCache *shader_cache)
+TempoStreamPtr RenderProcessor::ResolveTempoStream(ClipBlock *clip, const rational &time)
+{
+  QMutexLocker locker(tempo_cache_->mutex());
+
+  QVector<TempoStreamPtr> &pool = (*tempo_cache_)[clip->cache_identity()];
+
+  // Prefer a stream that left off exactly where this ticket starts so playback stays continuous
+  TempoStreamPtr reuse = nullptr;
+  foreach (const TempoStreamPtr &s, pool) {
+    if (!s->in_use) {
+      if (s->output_position == time) {
+        reuse = s;
+        break;
+      } else if (!reuse || s->last_used < reuse->last_used) {
+        reuse = s;
+      }
+    }
+  }
+
+  if (!reuse || (reuse->output_position != time && pool.size() < kMaxTempoStreamsPerClip)) {
+    reuse = std::make_shared<TempoStream>();
+
+    // If every stream is busy, this one is only used for this ticket
+    if (pool.size() < kMaxTempoStreamsPerClip) {
+      pool.append(reuse);
+    }
+  }
+
+  reuse->in_use = true;
+  return reuse;
+}
+
+SampleBuffer RenderProcessor::GenerateStretchedClipAudio(ClipBlock *clip, const TimeRange &range, NodeValueTable *table)
+{
+  const AudioParams &params = GetCacheAudioParams();
+  TempoStreamPtr stream = ResolveTempoStream(clip, range.in());
+
+  // Anything other than an exact continuation (seek, different clip settings, graph edits that
+  // moved the clip or changed anything feeding it) needs a fresh filter
+  int revision = clip->audio_revision();
+  if (stream->output_position != range.in()
+      || !qFuzzyCompare(stream->speed, clip->speed())
+      || stream->clip_in != clip->in()
+      || stream->media_in != clip->media_in()
+      || stream->revision != revision
+      || stream->params != params
+      || !stream->processor.IsOpen()) {
+    stream->processor.Close();
+    stream->processor.Open(params, params, clip->speed());
+    stream->pending.clear();
+    stream->fed_until = range.in();
+    stream->flushed = false;
+    stream->speed = clip->speed();
+    stream->clip_in = clip->in();
+    stream->media_in = clip->media_in();
+    stream->revision = revision;
+    stream->params = params;
+  }
+
+  auto append_output = [stream](const AudioProcessor::Buffer &out) {
+    stream->pending.resize(qMax(stream->pending.size(), out.size()));
+    for (int i=0; i<out.size(); i++) {
+      stream->pending[i].append(out.at(i));
+    }
+  };
+
+  if (stream->processor.IsOpen()) {
+    // Feed everything between where we left off and a little beyond this ticket so the filter
+    // always has enough input to produce the full requested range
+    rational feed_to = qMin(clip->out(), range.out() + kTempoLookahead);
+
+    if (feed_to > stream->fed_until) {
+      TimeRange feed_range(stream->fed_until, feed_to);
+      *table = GenerateTable(clip, Track::TransformRangeForBlock(clip, feed_range));
+      SampleBuffer input = table->Take(NodeValue::kSamples).toSamples();
+
+      if (input.is_allocated()) {
+        AudioProcessor::Buffer out;
+        int r = stream->processor.Convert(input.to_raw_ptrs().data(), input.sample_count(), &out);
+        if (r < 0) {
+          qCritical() << "Failed to change tempo of audio:" << r;
+        } else {
+          append_output(out);
+        }
+      }
+
+      stream->fed_until = feed_to;
+    }
+
+    if (stream->fed_until >= clip->out() && !stream->flushed) {
+      // Reached the end of the clip, drain whatever the filter is still holding
+      AudioProcessor::Buffer out;
+      stream->processor.Flush();
+      stream->processor.Convert(nullptr, 0, &out);
+      append_output(out);
+      stream->flushed = true;
+    }
+  }
+
+  // Hand out exactly the requested length, padding with silence if the filter is still priming
+  SampleBuffer output(params, range.length());
+  output.silence();
+
+  int needed_bytes = output.sample_count() * params.bytes_per_sample_per_channel();
+  for (int i=0; i<stream->pending.size() && i<output.channel_count(); i++) {
+    QByteArray &p = stream->pending[i];
+    int copy_bytes = qMin(needed_bytes, p.size());
+    memcpy(output.data(i), p.constData(), copy_bytes);
+    p.remove(0, copy_bytes);
+  }
+
+  {
+    QMutexLocker locker(tempo_cache_->mutex());
+    stream->output_position = range.out();
+    stream->last_used = QDateTime::currentMSecsSinceEpoch();
+    stream->in_use = false;
+  }
+
+  return output;
+}
+
+bool RenderProcessor::GetMixBusTracks(const Node *node, QVector<const Track *> *tracks)
 {
-  RenderProcessor p(ticket, render_ctx, decoder_cache, shader_cache);
+  if (const Track *track = dynamic_cast<const Track*>(node)) {
+    if (track->type() != Track::kAudio) {
+      return false;
+    }
+
+    tracks->append(track);
+    return true;
+  }
+
+  const MathNode *math = dynamic_cast<const MathNode*>(node);
+  if (!math || math->GetOperation() != MathNode::kOpAdd
+      || !math->IsInputConnected(MathNode::kParamAIn) || !math->IsInputConnected(MathNode::kParamBIn)) {
+    return false;
+  }
+
+  return GetMixBusTracks(math->GetConnectedOutput(MathNode::kParamAIn), tracks)
+      && GetMixBusTracks(math->GetConnectedOutput(MathNode::kParamBIn), tracks);
+}
+
+SampleBuffer RenderProcessor::MixTracks(const QVector<const Track *> &tracks, const TimeRange &range)
+{
+  SampleBuffer bus = CreateSampleBuffer(GetCacheAudioParams(), range.length());
+
+  if (!bus.is_allocated()) {
+    return bus;
+  }
+
+  bus.silence();
+
+  foreach (const Track *track, tracks) {
+    if (IsCancelled()) {
+      break;
+    }
+
+    // A muted track only ever produces silence, don't bother rendering it
+    if (track->IsMuted()) {
+      continue;
+    }
+
+    SampleBuffer track_samples = GetCachedTrackAudio(track, range);
+
+    if (track_samples.is_allocated()) {
+      bus.mix(track_samples);
+    }
+  }
+
+  return bus;
+}
+
+SampleBuffer RenderProcessor::GetCachedTrackAudio(const Track *track, const TimeRange &range)
+{
+  const AudioParams &params = GetCacheAudioParams();
+
+  // Work in samples so chunk boundaries line up exactly between tickets
+  qint64 chunk_samples = params.time_to_samples(kTrackAudioChunkLength);
+  qint64 range_start = params.time_to_samples(range.in());
+  qint64 range_count = params.time_to_samples(range.length());
+
+  if (chunk_samples <= 0 || range_count <= 0 || range_start < 0) {
+    return RenderTrackAudio(track, range);
+  }
+
+  SampleBuffer output(params, int(range_count));
+  output.silence();
+
+  qint64 range_end = range_start + range_count;
+  qint64 first_chunk = range_start / chunk_samples;
+  qint64 last_chunk = (range_end - 1) / chunk_samples;
+
+  bool want_waveforms = ticket_->request().enable_waveforms;
+  QVector<RenderResult::Waveform> &result_waveforms = ticket_->render_result().waveforms;
+
+  for (qint64 i=first_chunk; i<=last_chunk; i++) {
+    qint64 chunk_start = i * chunk_samples;
+    int revision = track->audio_revision();
+    SampleBuffer chunk;
+    QVector<RenderResult::Waveform> chunk_waveforms;
+
+    {
+      QMutexLocker locker(track_audio_cache_->mutex());
+
+      QMap<qint64, TrackAudioChunk> &chunks = (*track_audio_cache_)[track->cache_identity()];
+      auto it = chunks.find(i);
+      if (it != chunks.end() && it->revision == revision && it->params == params
+          && (!want_waveforms || it->has_waveforms)) {
+        it->last_used = QDateTime::currentMSecsSinceEpoch();
+        chunk = it->samples;
+        chunk_waveforms = it->waveforms;
+      }
+    }
+
+    if (chunk.is_allocated()) {
+      if (want_waveforms) {
+        // Point the stored waveforms back at this snapshot's copies of their clips
+        foreach (RenderResult::Waveform w, chunk_waveforms) {
+          foreach (Block *b, track->Blocks()) {
+            if (b->cache_identity() == w.block) {
+              w.block = static_cast<const ClipBlock*>(b);
+              result_waveforms.append(w);
+              break;
+            }
+          }
+        }
+      }
+    } else {
+      int first_waveform = result_waveforms.size();
+
+      // Render the whole chunk, whatever falls past the requested range is ready for the next
+      // ticket when playback continues
+      chunk = RenderTrackAudio(track, TimeRange(params.samples_to_time(chunk_start),
+                                                params.samples_to_time(chunk_start + chunk_samples)));
+
+      if (want_waveforms) {
+        chunk_waveforms = result_waveforms.mid(first_waveform);
+        for (int j=0; j<chunk_waveforms.size(); j++) {
+          chunk_waveforms[j].block = static_cast<const ClipBlock*>(chunk_waveforms.at(j).block->cache_identity());
+        }
+      }
+
+      if (!chunk.is_allocated()) {
+        continue;
+      }
+
+      // Don't keep anything that may be missing audio
+      if (!IsCancelled() && !ticket_->render_result().incomplete) {
+        QMutexLocker locker(track_audio_cache_->mutex());
+
+        QMap<qint64, TrackAudioChunk> &chunks = (*track_audio_cache_)[track->cache_identity()];
+
+        for (auto it=chunks.begin(); it!=chunks.end(); ) {
+          if (it->revision != revision || it->params != params) {
+            it = chunks.erase(it);
+          } else {
+            it++;
+          }
+        }
+
+        TrackAudioChunk &c = chunks[i];
+        c.samples = chunk;
+        c.params = params;
+        c.revision = revision;
+        c.last_used = QDateTime::currentMSecsSinceEpoch();
+        c.has_waveforms = want_waveforms;
+        c.waveforms = chunk_waveforms;
+
+        while (chunks.size() > kMaxTrackAudioChunksPerTrack) {
+          auto oldest = chunks.begin();
+          for (auto it=chunks.begin(); it!=chunks.end(); it++) {
+            if (it->last_used < oldest->last_used) {
+              oldest = it;
+            }
+          }
+          chunks.erase(oldest);
+        }
+      }
+    }
+
+    qint64 copy_start = qMax(range_start, chunk_start);
+    qint64 copy_end = qMin(qMin(range_end, chunk_start + chunk_samples), chunk_start + chunk.sample_count());
+
+    if (copy_end > copy_start) {
+      // Read through a const reference so the chunk shared with the cache isn't detached
+      const SampleBuffer &source = chunk;
+      int channels = qMin(output.channel_count(), source.channel_count());
+      for (int j=0; j<channels; j++) {
+        output.set(j, source.data(j) + (copy_start - chunk_start), int(copy_start - range_start), int(copy_end - copy_start));
+      }
+    }
+  }
+
+  return output;
+}
+
+SampleBuffer RenderProcessor::RenderTrackAudio(const Track *track, const TimeRange &range)
+{
+  NodeValueTable table = GenerateTable(track, range);
+
+  NodeValue sample_val = table.Get(NodeValue::kSamples);
+
+  ResolveJobs(sample_val, range);
+
+  return sample_val.toSamples();
+}
+
+void RenderProcessor::FinishPendingDownload()
+{
+  if (pending_download_) {
+    // Clear before running in case finishing the ticket leads to more work on this thread
+    std::function<void()> finish = std::move(pending_download_);
+    pending_download_ = nullptr;
+    finish();
+  }
+}
+
+void RenderProcessor::Process(RenderTicketPtr ticket, Renderer *render_ctx, DecoderCache *decoder_cache, ShaderCache *shader_cache, TempoCache *tempo_cache, TrackAudioCache *track_audio_cache)
+{
+  RenderProcessor p(ticket, render_ctx, decoder_cache, shader_cache, tempo_cache, track_audio_cache);
   p.Run();
 }
 
@@ -297,14 +798,31 @@ NodeValueTable RenderProcessor::GenerateBlockTable(const Track *track, const Tim
         int destination_offset = audio_params.time_to_samples(range_for_block.in() - range.in());
         int max_dest_sz = audio_params.time_to_samples(range_for_block.length());
 
-        // Destination buffer
-        NodeValueTable table = GenerateTable(b, Track::TransformRangeForBlock(b, range_for_block));
-        SampleBuffer samples_from_this_block = table.Take(NodeValue::kSamples).toSamples();
         ClipBlock *clip_cast = dynamic_cast<ClipBlock*>(b);
 
+        // Pitch-maintained speed changes are streamed through a tempo filter that persists across
+        // tickets. Reversed clips aren't, since they're consumed back-to-front.
+        bool stream_tempo = tempo_cache_ && clip_cast
+            && clip_cast->maintain_audio_pitch() && !clip_cast->reverse()
+            && !qIsNull(clip_cast->speed()) && !qFuzzyCompare(clip_cast->speed(), 1.0);
+
+        // Destination buffer
+        NodeValueTable table;
+        SampleBuffer samples_from_this_block;
+
+        footage_retrievals_ = 0;
+        footage_waveform_.clear();
+
+        if (stream_tempo) {
+          samples_from_this_block = GenerateStretchedClipAudio(clip_cast, range_for_block, &table);
+        } else {
+          table = GenerateTable(b, Track::TransformRangeForBlock(b, range_for_block));
+          samples_from_this_block = table.Take(NodeValue::kSamples).toSamples();
+        }
+
         if (samples_from_this_block.is_allocated()) {
           // If this is a clip, we might have extra speed/reverse information
-          if (clip_cast) {
+          if (clip_cast && !stream_tempo) {
             double speed_value = clip_cast->speed();
             bool reversed = clip_cast->reverse();
 
@@ -318,12 +836,8 @@ NodeValueTable RenderProcessor::GenerateBlockTable(const Track *track, const Tim
                 if (processor.Open(samples_from_this_block.audio_params(), samples_from_this_block.audio_params(), speed_value)) {
                   AudioProcessor::Buffer out;
 
-                  // FIXME: This is not the best way to do this, the TempoProcessor works best
-                  //        when it's given a continuous stream of audio, which is challenging
-                  //        in our current "modular" audio system. This should still work reasonably
-                  //        well on export (assuming audio is all generated at once on export), but
-                  //        users may hear clicks and pops in the audio during preview due to this
-                  //        approach.
+                  // Only reversed clips get here. They're still processed one chunk at a time,
+                  // so there may be clicks between chunks.
                   int r = processor.Convert(samples_from_this_block.to_raw_ptrs().data(), samples_from_this_block.sample_count(), nullptr);
 
                   if (r < 0) {
@@ -334,7 +848,7 @@ NodeValueTable RenderProcessor::GenerateBlockTable(const Track *track, const Tim
                     processor.Convert(nullptr, 0, &out);
 
                     if (!out.empty()) {
-                      int nb_samples = out.front().size() * samples_from_this_block.audio_params().bytes_per_sample_per_channel();
+                      int nb_samples = out.front().size() / samples_from_this_block.audio_params().bytes_per_sample_per_channel();
 
                       if (nb_samples) {
                         SampleBuffer new_samples(samples_from_this_block.audio_params(), nb_samples);
@@ -370,13 +884,24 @@ NodeValueTable RenderProcessor::GenerateBlockTable(const Track *track, const Tim
         }
 
         // Create block waveforms if requested
-        if (ticket_->property("enablewaveforms").toBool() && clip_cast) {
+        if (ticket_->request().enable_waveforms && clip_cast) {
           // Format information for use in the main thread
-          RenderedWaveform waveform_info;
+          RenderResult::Waveform waveform_info;
           waveform_info.block = clip_cast;
           waveform_info.range = range_for_block - b->in();
 
-          if (!(waveform_info.silence = !samples_from_this_block.is_allocated())) {
+          // Clips playing one conformed stream as-is can draw from its stored waveform, which saves
+          // both generating the sums here and keeping a copy of them in the clip. Anything between
+          // the clip and the footage (e.g. a time remap) would make the offset into it wrong.
+          bool use_source = footage_retrievals_ == 1 && !footage_waveform_.isEmpty()
+              && !clip_cast->reverse() && qFuzzyCompare(clip_cast->speed(), 1.0)
+              && dynamic_cast<Footage*>(clip_cast->GetConnectedOutput(ClipBlock::kBufferIn));
+
+          if (use_source) {
+            waveform_info.silence = false;
+            waveform_info.source = footage_waveform_;
+            waveform_info.source_offset = footage_waveform_offset_ - waveform_info.range.in();
+          } else if (!(waveform_info.silence = !samples_from_this_block.is_allocated())) {
             // Generate a visual waveform from the samples acquired from this block
             AudioVisualWaveform visual_waveform;
             visual_waveform.set_channel_count(audio_params.channel_count());
@@ -384,9 +909,7 @@ NodeValueTable RenderProcessor::GenerateBlockTable(const Track *track, const Tim
             waveform_info.waveform = visual_waveform;
           }
 
-          QVector<RenderedWaveform> waveform_list = ticket_->property("waveforms").value< QVector<RenderedWaveform> >();
-          waveform_list.append(waveform_info);
-          ticket_->setProperty("waveforms", QVariant::fromValue(waveform_list));
+          ticket_->render_result().waveforms.append(waveform_info);
         }
       }
     }
@@ -402,7 +925,7 @@ NodeValueTable RenderProcessor::GenerateBlockTable(const Track *track, const Tim
 
 void RenderProcessor::ProcessVideoFootage(TexturePtr destination, const FootageJob &stream, const rational &input_time)
 {
-  if (ticket_->property("type").value<RenderManager::TicketType>() != RenderManager::kTypeVideo) {
+  if (ticket_->request().type != RenderRequest::kTypeVideo) {
     // Video cannot contribute to audio, so we do nothing here
     return;
   }
@@ -412,7 +935,7 @@ void RenderProcessor::ProcessVideoFootage(TexturePtr destination, const FootageJ
   // to optimize such a situation
   VideoParams stream_data = stream.video_params();
 
-  ColorManager* color_manager = Node::ValueToPtr<ColorManager>(ticket_->property("colormanager"));
+  ColorManager* color_manager = ticket_->request().color_manager;
 
   QString using_colorspace = stream_data.colorspace();
 
@@ -430,7 +953,7 @@ void RenderProcessor::ProcessVideoFootage(TexturePtr destination, const FootageJ
   switch (stream_data.video_type()) {
   case VideoParams::kVideoTypeVideo:
   case VideoParams::kVideoTypeStill:
-    decoder = ResolveDecoderFromInput(decoder_id, default_codec_stream);
+    decoder = ResolveDecoderFromInput(decoder_id, default_codec_stream, (stream_data.video_type() == VideoParams::kVideoTypeVideo) ? input_time : Decoder::kAnyTimecode);
     break;
   case VideoParams::kVideoTypeImageSequence:
   {
@@ -457,7 +980,10 @@ void RenderProcessor::ProcessVideoFootage(TexturePtr destination, const FootageJ
       VideoParams tex_params = stream.video_params();
 
       if (tex_params.is_valid()) {
-        TexturePtr unmanaged_texture = decoder->RetrieveVideo(render_ctx_, (stream_data.video_type() == VideoParams::kVideoTypeVideo) ? input_time : Decoder::kAnyTimecode, p, GetCancelPointer());
+        // Allow the decoder to return planar YUV so the conversion to RGB happens in the same
+        // shader as the color transform below
+        Decoder::YUVPlanes yuv;
+        TexturePtr unmanaged_texture = decoder->RetrieveVideo(render_ctx_, (stream_data.video_type() == VideoParams::kVideoTypeVideo) ? input_time : Decoder::kAnyTimecode, p, GetCancelPointer(), &yuv);
 
         if (unmanaged_texture) {
           // We convert to our rendering pixel format, since that will always be float-based which
@@ -471,6 +997,10 @@ void RenderProcessor::ProcessVideoFootage(TexturePtr destination, const FootageJ
           job.SetColorProcessor(processor);
           job.SetInputTexture(unmanaged_texture);
 
+          if (yuv.IsValid()) {
+            job.SetInputYUVPlanes(yuv.u, yuv.v, yuv.matrix);
+          }
+
           if (stream_data.channel_count() != VideoParams::kRGBAChannelCount
               || stream_data.colorspace() == color_manager->GetReferenceColorSpace()) {
             job.SetInputAlphaAssociation(kAlphaNone);
@@ -489,19 +1019,33 @@ void RenderProcessor::ProcessVideoFootage(TexturePtr destination, const FootageJ
 
 void RenderProcessor::ProcessAudioFootage(SampleBuffer &destination, const FootageJob &stream, const TimeRange &input_time)
 {
-  DecoderPtr decoder = ResolveDecoderFromInput(stream.decoder(), Decoder::CodecStream(stream.filename(), stream.audio_params().stream_index(), nullptr));
+  Decoder::CodecStream codec_stream(stream.filename(), stream.audio_params().stream_index(), nullptr);
+  DecoderPtr decoder = ResolveDecoderFromInput(stream.decoder(), codec_stream, input_time.in());
 
   if (decoder) {
     const AudioParams& audio_params = GetCacheAudioParams();
 
+    ConformTask *waiting_for = nullptr;
     Decoder::RetrieveAudioStatus status = decoder->RetrieveAudio(destination,
                                                                  input_time, audio_params,
                                                                  stream.cache_path(),
                                                                  stream.loop_mode(),
-                                                                 static_cast<RenderMode::Mode>(ticket_->property("mode").toInt()));
+                                                                 ticket_->request().mode,
+                                                                 &waiting_for);
 
     if (status == Decoder::kWaitingForConform) {
-      ticket_->setProperty("incomplete", true);
+      ticket_->render_result().incomplete = true;
+      if (waiting_for) {
+        ticket_->render_result().conform_waits.append({waiting_for, input_time});
+      }
+    } else if (status == Decoder::kOK) {
+      footage_retrievals_++;
+
+      QString waveform = ConformManager::GetWaveformFilename(stream.cache_path(), codec_stream, audio_params);
+      if (QFileInfo::exists(waveform)) {
+        footage_waveform_ = waveform;
+        footage_waveform_offset_ = input_time.in();
+      }
     }
   }
 }
@@ -517,15 +1061,20 @@ void RenderProcessor::ProcessShader(TexturePtr destination, const Node *node, co
   QVariant shader = shader_cache_->value(full_shader_id);
 
   if (shader.isNull()) {
-    // Since we have shader code, compile it now
-    shader = render_ctx_->CreateNativeShader(node->GetShaderCode(job.GetShaderID()));
+    // Since we have shader code, compile it now (or get the program if identical code has already
+    // been compiled)
+    shader = render_ctx_->GetShaderProgram(node->GetShaderCode(job.GetShaderID()));
 
     if (shader.isNull()) {
       // Couldn't find or build the shader required
       return;
     }
+
+    shader_cache_->insert(full_shader_id, shader);
   }
 
+  locker.unlock();
+
   // Run shader
   render_ctx_->BlitToTexture(shader, job, destination.get());
 }
@@ -536,28 +1085,59 @@ void RenderProcessor::ProcessSamples(SampleBuffer &destination, const Node *node
     return;
   }
 
-  NodeValueRow value_db;
-
   const AudioParams& audio_params = GetCacheAudioParams();
+  int count = job.samples().sample_count();
 
-  for (int i=0;i<job.samples().sample_count();i++) {
-    // Calculate the exact rational time at this sample
-    double sample_to_second = static_cast<double>(i) / static_cast<double>(audio_params.sample_rate());
+  auto to_float = [](const NodeValue &v) -> float {
+    return (v.type() == NodeValue::kRational) ? v.toRational().toDouble() : v.toDouble();
+  };
 
-    rational this_sample_time = rational::fromDouble(range.in().toDouble() + sample_to_second);
+  // Evaluate every job input once for the whole block rather than traversing the graph per sample
+  SampleAutomationRow automation;
 
-    // Update all non-sample and non-footage inputs
-    for (auto j=job.GetValues().constBegin(); j!=job.GetValues().constEnd(); j++) {
-      NodeValueTable value = ProcessInput(node, j.key(), TimeRange(this_sample_time, this_sample_time));
+  for (auto j=job.GetValues().constBegin(); j!=job.GetValues().constEnd(); j++) {
+    const QString &input = j.key();
 
-      value_db.insert(j.key(), GenerateRowValue(node, j.key(), &value));
+    if (node->IsInputStatic(input)) {
+      automation.insert(input, SampleAutomation(to_float(j.value())));
+      continue;
     }
 
-    node->ProcessSamples(value_db,
-                         job.samples(),
-                         destination,
-                         i);
+    auto value_at_sample = [&](int i) {
+      rational t = range.in() + rational(i, audio_params.sample_rate());
+      NodeValueTable value = ProcessInput(node, input, TimeRange(t, t));
+      return to_float(GenerateRowValue(node, input, &value));
+    };
+
+    // Sample the curve at control points and linearly interpolate between them
+    QVector<float> curve(count);
+    float prev = value_at_sample(0);
+    bool constant = true;
+
+    for (int i=0; i<count; i+=kAutomationControlInterval) {
+      int next = qMin(i + kAutomationControlInterval, count);
+      float next_val = value_at_sample(next);
+
+      if (next_val != prev) {
+        constant = false;
+      }
+
+      float step = (next_val - prev) / (next - i);
+      for (int k=i; k<next; k++) {
+        curve[k] = prev + step * (k - i);
+      }
+
+      prev = next_val;
+    }
+
+    if (constant) {
+      automation.insert(input, SampleAutomation(prev));
+    } else {
+      automation.insert(input, SampleAutomation(curve));
+    }
   }
+
+  node->ProcessSamples(automation, job.samples(), destination);
 }
 
 void RenderProcessor::ProcessColorTransform(TexturePtr destination, const Node *node, const ColorTransformJob &job)
@@ -579,12 +1159,12 @@ void RenderProcessor::ProcessFrameGeneration(TexturePtr destination, const Node
 
 bool RenderProcessor::CanCacheFrames()
 {
-  return ticket_->property("type").value<RenderManager::TicketType>() == RenderManager::kTypeVideo;
+  return ticket_->request().type == RenderRequest::kTypeVideo;
 }
 
 void RenderProcessor::ConvertToReferenceSpace(TexturePtr destination, TexturePtr source, const QString &input_cs)
 {
-  ColorManager* color_manager = Node::ValueToPtr<ColorManager>(ticket_->property("colormanager"));
+  ColorManager* color_manager = ticket_->request().color_manager;
   ColorProcessorPtr cp = ColorProcessor::Create(color_manager, input_cs, color_manager->GetReferenceColorSpace());
 
   ColorTransformJob ctj;
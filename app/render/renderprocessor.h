@@ -21,6 +21,8 @@
 #ifndef RENDERPROCESSOR_H
 #define RENDERPROCESSOR_H
 
+#include <functional>
+
 #include "node/block/clip/clip.h"
 #include "node/traverser.h"
 #include "render/renderer.h"
@@ -32,14 +34,16 @@ namespace olive {
 class RenderProcessor : public NodeTraverser
 {
 public:
-  static void Process(RenderTicketPtr ticket, Renderer* render_ctx, DecoderCache* decoder_cache, ShaderCache* shader_cache);
+  static void Process(RenderTicketPtr ticket, Renderer* render_ctx, DecoderCache* decoder_cache, ShaderCache* shader_cache, TempoCache* tempo_cache, TrackAudioCache* track_audio_cache);
 
-  struct RenderedWaveform {
-    const ClipBlock* block;
-    AudioVisualWaveform waveform;
-    TimeRange range;
-    bool silence;
-  };
+  /**
+   * @brief Collect the download of the last frame processed on this thread and finish its ticket
+   *
+   * Background frames don't wait for their download before Process() returns, it's collected when
+   * the next ticket on the same thread has submitted its own work. Must be called when a thread
+   * has no more tickets to process.
+   */
+  static void FinishPendingDownload();
 
 protected:
   virtual NodeValueTable GenerateBlockTable(const Track *track, const TimeRange &range) override;
@@ -71,15 +75,59 @@ protected:
   virtual void ConvertToReferenceSpace(TexturePtr destination, TexturePtr source, const QString &input_cs) override;
 
 private:
-  RenderProcessor(RenderTicketPtr ticket, Renderer* render_ctx, DecoderCache* decoder_cache, ShaderCache* shader_cache);
+  RenderProcessor(RenderTicketPtr ticket, Renderer* render_ctx, DecoderCache* decoder_cache, ShaderCache* shader_cache, TempoCache* tempo_cache, TrackAudioCache* track_audio_cache);
 
   TexturePtr GenerateTexture(const rational& time, const rational& frame_length);
 
-  FramePtr GenerateFrame(TexturePtr texture, const rational &time);
+  FramePtr GenerateFrame(TexturePtr texture, const rational &time, QVariant *download);
+
+  /**
+   * @brief Returns whether the requested frame can share a cached image with identical frames
+   *
+   * Frames with forced output parameters aren't covered by the fingerprint so they're excluded.
+   */
+  bool CanDeduplicateFrame() const;
+
+  /**
+   * @brief Fingerprint the content of the frame at `time`, including both fields if interlaced
+   */
+  QByteArray GenerateFingerprint(const rational &time, const rational &frame_length) const;
+
+  /**
+   * @brief Finish the ticket with the frame already cached at `time`, returns false if it couldn't be loaded
+   */
+  bool FinishWithCachedFrame(const rational &time);
 
   void Run();
 
-  DecoderPtr ResolveDecoderFromInput(const QString &decoder_id, const Decoder::CodecStream& stream);
+  DecoderPtr ResolveDecoderFromInput(const QString &decoder_id, const Decoder::CodecStream& stream, const rational &time);
+
+  /**
+   * @brief Generate pitch-maintained speed-changed audio for a clip through a persistent TempoStream
+   */
+  SampleBuffer GenerateStretchedClipAudio(ClipBlock *clip, const TimeRange &range, NodeValueTable *table);
+
+  TempoStreamPtr ResolveTempoStream(ClipBlock *clip, const rational &time);
+
+  /**
+   * @brief Collect the tracks summed by a chain of add nodes (as built by the timeline)
+   *
+   * Returns false if anything other than audio tracks and add nodes is in the chain, in which
+   * case the graph must be traversed normally.
+   */
+  static bool GetMixBusTracks(const Node *node, QVector<const Track*> *tracks);
+
+  /**
+   * @brief Sum the audio of several tracks directly into one buffer
+   */
+  SampleBuffer MixTracks(const QVector<const Track*> &tracks, const TimeRange &range);
+
+  /**
+   * @brief Get a track's audio, reusing chunks rendered by previous tickets where possible
+   */
+  SampleBuffer GetCachedTrackAudio(const Track *track, const TimeRange &range);
+
+  SampleBuffer RenderTrackAudio(const Track *track, const TimeRange &range);
 
   RenderTicketPtr ticket_;
 
@@ -89,10 +137,45 @@ private:
 
   ShaderCache* shader_cache_;
 
+  TempoCache* tempo_cache_;
+
+  TrackAudioCache* track_audio_cache_;
+
+  /**
+   * @brief Footage audio retrieved while generating the current block, for waveform sources
+   */
+  int footage_retrievals_;
+  QString footage_waveform_;
+  rational footage_waveform_offset_;
+
+  static const int kMaxDecodersPerStream;
+
+  static const int kMaxTempoStreamsPerClip;
+
+  /**
+   * @brief How far ahead of the requested range audio is fed into a TempoStream
+   */
+  static const rational kTempoLookahead;
+
+  /**
+   * @brief Length of the aligned chunks track audio is rendered and cached in
+   */
+  static const rational kTrackAudioChunkLength;
+
+  static const int kMaxTrackAudioChunksPerTrack;
+
+  /**
+   * @brief Number of samples between points where keyframed SampleJob inputs are evaluated
+   */
+  static const int kAutomationControlInterval;
+
+  /**
+   * @brief Remainder of the last background frame processed on this thread, see FinishPendingDownload()
+   */
+  static thread_local std::function<void()> pending_download_;
+
 };
 
 }
 
-Q_DECLARE_METATYPE(olive::RenderProcessor::RenderedWaveform)
-
 #endif // RENDERPROCESSOR_H
@@ -28,7 +28,8 @@ const Texture::Interpolation Texture::kDefaultInterpolation = Texture::kMipmappe
 
 Texture::~Texture()
 {
-  if (renderer_) {
+  // Textures whose creation was deferred may never have received a native handle
+  if (renderer_ && !id_.isNull()) {
     renderer_->DestroyNativeTexture(id_);
   }
 }
@@ -29,7 +29,7 @@ namespace olive {
 
 class Renderer;
 
-class Texture
+class Texture : public std::enable_shared_from_this<Texture>
 {
 public:
   enum Type {
@@ -73,6 +73,16 @@ public:
     return id_;
   }
 
+  /**
+   * @brief Set the native handle of a texture whose creation was deferred
+   *
+   * Should only be called by the renderer that owns this texture.
+   */
+  void set_id(const QVariant &native)
+  {
+    id_ = native;
+  }
+
   const VideoParams& params() const
   {
     return params_;
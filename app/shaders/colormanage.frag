@@ -3,6 +3,13 @@ uniform sampler2D ove_maintex;
 uniform int ove_maintex_alpha;
 uniform mat4 ove_cropmatrix;
 
+#ifdef OVE_YUV_INPUT
+// Chroma planes when `ove_maintex` is the luma plane of a planar YUV image
+uniform sampler2D ove_utex;
+uniform sampler2D ove_vtex;
+uniform mat4 ove_yuvmat;
+#endif
+
 // Macros defining `ove_maintex_alpha` state
 // Matches `AlphaAssociated` C++ enum
 #define ALPHA_NONE     0
@@ -36,7 +43,15 @@ void main() {
     return;
   }
 
+#ifdef OVE_YUV_INPUT
+  vec4 col = ove_yuvmat * vec4(texture(ove_maintex, cropped_coord).r,
+                               texture(ove_utex, cropped_coord).r,
+                               texture(ove_vtex, cropped_coord).r,
+                               1.0);
+  col.a = 1.0;
+#else
   vec4 col = texture(ove_maintex, cropped_coord);
+#endif
 
   // If alpha is associated, de-associate now
   if (ove_maintex_alpha == ALPHA_ASSOC) {
@@ -20,17 +20,31 @@
 
 #include "conform.h"
 
+#include <QDebug>
+#include <QFile>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrent>
+
+#include "audio/audiowaveformfile.h"
+#include "codec/conformmanager.h"
+#include "codec/planarfiledevice.h"
+
 namespace olive {
 
-ConformTask::ConformTask(const QString &decoder_id, const Decoder::CodecStream &stream, const AudioParams& params, const QVector<QString> &output_filenames) :
+ConformTask::ConformTask(const QString &decoder_id, const Decoder::CodecStream &stream, const AudioParams& params, const QVector<QString> &output_filenames, const QString &waveform_filename) :
   decoder_id_(decoder_id),
   stream_(stream),
   params_(params),
-  output_filenames_(output_filenames)
+  output_filenames_(output_filenames),
+  waveform_filename_(waveform_filename)
 {
   SetTitle(tr("Conforming Audio %1:%2").arg(stream.filename(), QString::number(stream.stream())));
 }
 
+const int ConformTask::kMaximumSegments = 4;
+const rational ConformTask::kMinimumSegmentLength = rational(30);
+
 bool ConformTask::Run()
 {
   DecoderPtr decoder = Decoder::CreateFromID(decoder_id_);
@@ -40,13 +54,145 @@ bool ConformTask::Run()
     return false;
   }
 
-  connect(decoder.get(), &Decoder::IndexProgress, this, &ConformTask::ProgressChanged);
+  // Working files left over from an interrupted session would be written over but not truncated
+  foreach (const QString &fn, output_filenames_) {
+    QFile::remove(fn);
+  }
+  QFile::remove(waveform_filename_);
+
+  duration_ = decoder->GetStreamDuration();
+
+  // Split long streams into parts that are conformed at once by separate decoders. The first part
+  // starts at the beginning, so playback from the start becomes possible almost immediately.
+  int segments = 1;
+  if (duration_ > 0) {
+    segments = qBound(1,
+                      int(duration_.toDouble() / kMinimumSegmentLength.toDouble()),
+                      qMin(QThread::idealThreadCount(), kMaximumSegments));
+  } else {
+    // Can't split without a length, but progress is still available from the decoder
+    connect(decoder.get(), &Decoder::IndexProgress, this, &ConformTask::ProgressChanged);
+  }
+
+  conformed_length_ = 0;
 
-  bool ret = decoder->ConformAudio(output_filenames_, params_, &IsCancelled());
+  // Ranges may be reported from any of the segment threads
+  connect(decoder.get(), &Decoder::AudioConformed, this, &ConformTask::SegmentConformed, Qt::DirectConnection);
+
+  // Segment boundaries are whole seconds so they land on a sample at any sample rate
+  QVector<rational> boundaries(segments + 1);
+  boundaries[0] = 0;
+  for (int i=1; i<segments; i++) {
+    boundaries[i] = rational(int(duration_.toDouble() * i / segments));
+  }
+  boundaries[segments] = RATIONAL_MAX;
+
+  // Own pool so waiting on the segments can't starve the pool this task itself is running in
+  QThreadPool pool;
+  pool.setMaxThreadCount(qMax(1, segments - 1));
+
+  QVector< QFuture<bool> > futures(segments - 1);
+  for (int i=1; i<segments; i++) {
+    futures[i-1] = QtConcurrent::run(&pool, this, &ConformTask::ConformSegment, TimeRange(boundaries.at(i), boundaries.at(i+1)));
+  }
+
+  bool ret = decoder->ConformAudio(output_filenames_, params_, TimeRange(boundaries.at(0), boundaries.at(1)), &IsCancelled());
 
   decoder->Close();
 
+  for (int i=0; i<futures.size(); i++) {
+    futures[i].waitForFinished();
+    ret = futures.at(i).result() && ret;
+  }
+
+  if (ret && !GenerateWaveform()) {
+    // Not fatal, clips will generate their own sums instead
+    qWarning() << "Failed to generate waveform for" << stream_.filename();
+  }
+
   return ret;
 }
 
+bool ConformTask::ConformSegment(const TimeRange &range)
+{
+  DecoderPtr decoder = Decoder::CreateFromID(decoder_id_);
+
+  if (!decoder->Open(stream_)) {
+    return false;
+  }
+
+  connect(decoder.get(), &Decoder::AudioConformed, this, &ConformTask::SegmentConformed, Qt::DirectConnection);
+
+  bool ret = decoder->ConformAudio(output_filenames_, params_, range, &IsCancelled());
+
+  decoder->Close();
+
+  return ret;
+}
+
+bool ConformTask::GenerateWaveform()
+{
+  if (params_.format() != AudioParams::kFormatFloat32Planar) {
+    // SampleBuffers (and therefore waveform sums) can only be generated from float samples
+    return false;
+  }
+
+  PlanarFileDevice input;
+  if (!input.open(output_filenames_, QFile::ReadOnly)) {
+    return false;
+  }
+
+  AudioVisualWaveform waveform;
+  waveform.set_channel_count(params_.channel_count());
+
+  // Process in chunks of the lowest mipmap's sample length so every mipmap gets whole samples
+  const int chunk_samples = params_.time_to_samples(AudioVisualWaveform::kMinimumSampleRate.flipped());
+  const int bytes_per_sample = params_.bytes_per_sample_per_channel();
+  const qint64 total_samples = input.size() / bytes_per_sample;
+
+  SampleBuffer buffer(params_, chunk_samples);
+
+  for (qint64 i=0; i<total_samples; i+=chunk_samples) {
+    if (IsCancelled()) {
+      return false;
+    }
+
+    int count = qMin(qint64(chunk_samples), total_samples - i);
+    if (count != buffer.sample_count()) {
+      // Only the final chunk can be shorter
+      buffer = SampleBuffer(params_, count);
+    }
+
+    input.seek(i * bytes_per_sample);
+    input.read(reinterpret_cast<char**>(buffer.to_raw_ptrs().data()), qint64(count) * bytes_per_sample);
+
+    waveform.OverwriteSamples(buffer, params_.sample_rate(), params_.samples_to_time(i));
+  }
+
+  input.close();
+
+  return AudioWaveformFile::Write(waveform_filename_, waveform);
+}
+
+void ConformTask::SegmentConformed(const TimeRange &range)
+{
+  ConformManager::instance()->ConformedRange(this, range);
+
+  if (duration_ > 0) {
+    QMutexLocker locker(&progress_lock_);
+
+    // The last segment reports up to RATIONAL_MAX, so only count what lies inside the stream
+    rational out = qMin(range.out(), duration_);
+    if (out > range.in()) {
+      conformed_length_ += out - range.in();
+    }
+
+    double progress = conformed_length_.toDouble() / duration_.toDouble();
+
+    locker.unlock();
+
+    emit ProgressChanged(progress);
+  }
+}
+
 }
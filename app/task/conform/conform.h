@@ -21,6 +21,8 @@
 #ifndef CONFORMTASK_H
 #define CONFORMTASK_H
 
+#include <QMutex>
+
 #include "codec/decoder.h"
 #include "node/project/footage/footage.h"
 #include "render/audioparams.h"
@@ -32,12 +34,34 @@ class ConformTask : public Task
 {
   Q_OBJECT
 public:
-  ConformTask(const QString &decoder_id, const Decoder::CodecStream &stream, const AudioParams& params, const QVector<QString> &output_filenames);
+  ConformTask(const QString &decoder_id, const Decoder::CodecStream &stream, const AudioParams& params, const QVector<QString> &output_filenames, const QString &waveform_filename);
 
 protected:
   virtual bool Run() override;
 
 private:
+  /**
+   * @brief Conform one part of the stream with its own decoder, run on a worker thread
+   */
+  bool ConformSegment(const TimeRange &range);
+
+  void SegmentConformed(const TimeRange &range);
+
+  /**
+   * @brief Build the waveform mipmaps from the finished conform and store them to disk
+   */
+  bool GenerateWaveform();
+
+  /**
+   * @brief Most decoders to run on one stream at once
+   */
+  static const int kMaximumSegments;
+
+  /**
+   * @brief Don't bother splitting streams into parts shorter than this
+   */
+  static const rational kMinimumSegmentLength;
+
   QString decoder_id_;
 
   Decoder::CodecStream stream_;
@@ -46,6 +70,14 @@ private:
 
   QVector<QString> output_filenames_;
 
+  QString waveform_filename_;
+
+  rational duration_;
+
+  QMutex progress_lock_;
+
+  rational conformed_length_;
+
 };
 
 }
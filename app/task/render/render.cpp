@@ -67,7 +67,7 @@ bool RenderTask::Render(ColorManager* manager,
       watcher->setProperty("range", QVariant::fromValue(this_range));
       PrepareWatcher(watcher, &watcher_thread);
       IncrementRunningTickets();
-      watcher->SetTicket(RenderManager::instance()->RenderAudio(viewer_->GetConnectedSampleOutput(), this_range, audio_params_, mode, false));
+      watcher->SetTicket(RenderManager::instance()->RenderAudio(viewer_->GetConnectedSampleOutput(), this_range, audio_params_, mode, false, RenderTicketPriority::kExport));
 
       r = end;
     }
@@ -150,9 +150,9 @@ bool RenderTask::Render(ColorManager* manager,
       finished_watcher_mutex_.unlock();
 
       // Analyze watcher here
-      RenderManager::TicketType ticket_type = watcher->GetTicket()->property("type").value<RenderManager::TicketType>();
+      RenderRequest::Type ticket_type = watcher->GetTicket()->request().type;
 
-      if (ticket_type == RenderManager::kTypeAudio) {
+      if (ticket_type == RenderRequest::kTypeAudio) {
 
         TimeRange range = watcher->property("range").value<TimeRange>();
 
@@ -165,7 +165,7 @@ bool RenderTask::Render(ColorManager* manager,
         //progress_counter += range.length().toDouble();
         //emit ProgressChanged(progress_counter / total_length);
 
-      } else if (ticket_type == RenderManager::kTypeVideo && TwoStepFrameRendering()) {
+      } else if (ticket_type == RenderRequest::kTypeVideo && TwoStepFrameRendering()) {
 
         if (!DownloadFrame(&watcher_thread, watcher->Get().value<FramePtr>(), watcher->property("time").value<rational>())) {
           result = false;
@@ -285,7 +285,7 @@ void RenderTask::StartTicket(QThread* watcher_thread, ColorManager* manager,
                                                             mode, video_params_, audio_params_,
                                                             force_size, force_matrix,
                                                             force_format, force_color_output,
-                                                            cache));
+                                                            cache, RenderTicketPriority::kExport));
 }
 
 void RenderTask::TicketDone(RenderTicketWatcher* watcher)
@@ -29,76 +29,163 @@ ThreadPool::ThreadPool(unsigned threads, QObject *parent) :
     threads = std::thread::hardware_concurrency();
   }
 
+  // Create every queue before starting any threads since workers steal from each other
   for (unsigned i = 0; i < threads; i += 1) {
-    worker_threads_.emplace_back(std::bind(&ThreadPool::thread_exec, this, &tasks_, &task_mutex_, &cond_));
+    queues_.emplace_back(new WorkerQueue());
+  }
+
+  for (unsigned i = 0; i < threads; i += 1) {
+    worker_threads_.emplace_back(std::bind(&ThreadPool::thread_exec, this, size_t(i)));
   }
 
   // Make single reserved thread for high priority tasks (usually audio) so they don't get stuck
   // behind a lot of slow tasks
-  high_thread_ = std::thread(std::thread(std::bind(&ThreadPool::thread_exec, this, &high_tasks_, &high_mutex_, &high_cond_)));
+  high_thread_ = std::thread(std::bind(&ThreadPool::high_thread_exec, this));
 }
 
 void ThreadPool::AddTicket(RenderTicketPtr ticket, RenderTicketPriority priority)
 {
   if (priority == RenderTicketPriority::kHigh) {
+    ticket->queue_state().storeRelease(kQueuedHigh);
+
     std::lock_guard<std::mutex> lock(high_mutex_);
     high_tasks_.emplace_back(std::move(ticket));
     high_cond_.notify_one();
   } else {
-    std::lock_guard<std::mutex> lock(task_mutex_);
-    tasks_.emplace_back(std::move(ticket));
+    ticket->queue_state().storeRelease(kQueued);
+
+    // Spread tickets between workers, idle workers will steal whatever they need to
+    WorkerQueue *queue = queues_.at(next_queue_++ % queues_.size()).get();
+
+    {
+      std::lock_guard<std::mutex> lock(queue->mutex);
+      queue->tasks[static_cast<int>(priority)].emplace_back(std::move(ticket));
+    }
+
+    queued_count_++;
+
+    {
+      // Lock so this can't slip in between a worker checking the count and going to sleep
+      std::lock_guard<std::mutex> lock(sleep_mutex_);
+    }
     cond_.notify_one();
   }
 }
 
 bool ThreadPool::RemoveTicket(RenderTicketPtr ticket)
 {
-  {
-    std::lock_guard<std::mutex> lock(task_mutex_);
-    const auto it = std::find(tasks_.begin(), tasks_.end(), ticket);
-    if (it != tasks_.end()) {
-      tasks_.erase(it);
-      return true;
-    }
+  // Tickets are only marked as removed here, workers discard them when they reach the front of a
+  // queue rather than searching for them now
+  QAtomicInt &state = ticket->queue_state();
+  int s = state.loadAcquire();
+
+  if (s == kNotQueued || !state.testAndSetOrdered(s, kNotQueued)) {
+    return false;
   }
 
-  {
-    std::lock_guard<std::mutex> lock(high_mutex_);
-    const auto it = std::find(high_tasks_.begin(), high_tasks_.end(), ticket);
-    if (it != high_tasks_.end()) {
-      high_tasks_.erase(it);
-      return true;
+  if (s == kQueued) {
+    queued_count_--;
+  }
+
+  return true;
+}
+
+bool ThreadPool::ClaimTask(const TaskType &task)
+{
+  QAtomicInt &state = task->queue_state();
+  int s = state.loadAcquire();
+
+  return s != kNotQueued && state.testAndSetOrdered(s, kNotQueued);
+}
+
+ThreadPool::TaskType ThreadPool::TakeTask(size_t index)
+{
+  // Skip kHigh, which only runs on the reserved thread
+  for (int p = static_cast<int>(RenderTicketPriority::kHigh) + 1; p < static_cast<int>(RenderTicketPriority::kCount); p++) {
+    for (size_t i = 0; i < queues_.size(); i++) {
+      // Start with our own queue, then try stealing from the others
+      size_t queue_index = (index + i) % queues_.size();
+      bool own = (queue_index == index);
+      WorkerQueue *queue = queues_.at(queue_index).get();
+
+      std::lock_guard<std::mutex> lock(queue->mutex);
+      std::deque<TaskType> &tasks = queue->tasks[p];
+
+      while (!tasks.empty()) {
+        TaskType task;
+
+        if (own) {
+          task = std::move(tasks.front());
+          tasks.pop_front();
+        } else {
+          task = std::move(tasks.back());
+          tasks.pop_back();
+        }
+
+        if (ClaimTask(task)) {
+          queued_count_--;
+          return task;
+        }
+      }
     }
   }
 
-  return false;
+  return nullptr;
+}
+
+void ThreadPool::thread_exec(size_t index)
+{
+  while (true) {
+    if (TaskType task = TakeTask(index)) {
+      RunTicket(task);
+      continue;
+    }
+
+    WorkerIdle();
+
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    cond_.wait(lock, [this]{ return this->end_threadp_ || this->queued_count_ > 0; });
+
+    if (this->end_threadp_ && this->queued_count_ <= 0) {
+      break;
+    }
+  }
 }
 
-void ThreadPool::thread_exec(std::deque<TaskType> *queue, std::mutex *mutex, std::condition_variable *cond)
+void ThreadPool::high_thread_exec()
 {
   while (true) {
     TaskType task;
 
     {
-      std::unique_lock<std::mutex> lock(*mutex);
-      cond->wait(lock, [this, queue]{ return this->end_threadp_ || !queue->empty(); });
+      std::unique_lock<std::mutex> lock(high_mutex_);
+      high_cond_.wait(lock, [this]{ return this->end_threadp_ || !high_tasks_.empty(); });
 
-      if (this->end_threadp_ && queue->empty()) {
+      if (this->end_threadp_ && high_tasks_.empty()) {
         break;
       }
 
-      task = std::move(queue->front());
-      queue->pop_front();
+      task = std::move(high_tasks_.front());
+      high_tasks_.pop_front();
     }
 
-    RunTicket(task);
+    if (ClaimTask(task)) {
+      RunTicket(task);
+    }
   }
 }
 
 ThreadPool::~ThreadPool()
 {
-  end_threadp_ = true;
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    end_threadp_ = true;
+  }
   cond_.notify_all();
+
+  {
+    std::lock_guard<std::mutex> lock(high_mutex_);
+  }
   high_cond_.notify_all();
 
   for (auto &e : worker_threads_) {
@@ -23,16 +23,26 @@
 
 #include "threading/threadticket.h"
 
-#include <vector>
-#include <thread>
+#include <atomic>
+#include <condition_variable>
 #include <deque>
+#include <memory>
 #include <mutex>
-#include <condition_variable>
+#include <thread>
+#include <vector>
 
 namespace olive {
 
-enum class RenderTicketPriority { kHigh = 0, kNormal };
-
+/**
+ * @brief Pool of worker threads that run render tickets in priority order
+ *
+ * Each worker has its own set of queues (one per priority) so adding and taking tickets rarely
+ * contends on a single lock. Workers take from the front of their own queues and, when those are
+ * empty, steal from the back of other workers' queues before moving on to a lower priority.
+ *
+ * Tickets with RenderTicketPriority::kHigh run on a reserved thread so they never get stuck behind
+ * slow tasks.
+ */
 class ThreadPool : public QObject
 {
   Q_OBJECT
@@ -43,17 +53,48 @@ public:
   DISABLE_COPY_MOVE(ThreadPool)
 
   virtual void RunTicket(RenderTicketPtr ticket) const = 0;
-  void AddTicket(RenderTicketPtr ticket, RenderTicketPriority priority = RenderTicketPriority::kNormal);
+
+  /**
+   * @brief Called on a worker thread that has run out of tickets, right before it goes to sleep
+   */
+  virtual void WorkerIdle() const {}
+  void AddTicket(RenderTicketPtr ticket, RenderTicketPriority priority = RenderTicketPriority::kBackground);
+
+  /**
+   * @brief Remove a ticket that hasn't started running yet
+   *
+   * Runs in constant time. Returns false if the ticket was not queued, e.g. because it has already
+   * been taken by a worker.
+   */
   bool RemoveTicket(RenderTicketPtr ticket);
 
   virtual ~ThreadPool() override;
 
 private:
-  void thread_exec(std::deque<TaskType> *queue, std::mutex *mutex, std::condition_variable *cond);
+  enum QueueState {
+    kNotQueued,
+    kQueued,
+    kQueuedHigh
+  };
+
+  struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<TaskType> tasks[static_cast<int>(RenderTicketPriority::kCount)];
+  };
+
+  void thread_exec(size_t index);
+
+  void high_thread_exec();
+
+  TaskType TakeTask(size_t index);
+
+  static bool ClaimTask(const TaskType &task);
 
   std::vector<std::thread> worker_threads_;
-  std::deque<TaskType> tasks_;
-  std::mutex task_mutex_;
+  std::vector<std::unique_ptr<WorkerQueue> > queues_;
+  std::atomic_size_t next_queue_{0};
+  std::atomic_int queued_count_{0};
+  std::mutex sleep_mutex_;
   std::condition_variable cond_;
 
   std::thread high_thread_;
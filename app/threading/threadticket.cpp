@@ -23,6 +23,12 @@
 namespace olive {
 
 RenderTicket::RenderTicket() :
+  RenderTicket(RenderRequest())
+{
+}
+
+RenderTicket::RenderTicket(const RenderRequest &request) :
+  request_(request),
   is_running_(false),
   has_result_(false),
   finish_count_(0)
@@ -43,6 +49,7 @@ void RenderTicket::Start()
   is_running_ = true;
   has_result_ = false;
   result_.clear();
+  render_result_ = RenderResult();
 }
 
 void RenderTicket::Finish()
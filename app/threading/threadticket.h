@@ -22,22 +22,173 @@
 #define RENDERTICKET_H
 
 #include <QDateTime>
+#include <QMatrix4x4>
 #include <QMutex>
+#include <QUuid>
 #include <QWaitCondition>
 
+#include "audio/audiovisualwaveform.h"
 #include "codec/frame.h"
 #include "codec/samplebuffer.h"
 #include "common/cancelableobject.h"
 #include "common/timerange.h"
 #include "node/output/viewer/viewer.h"
+#include "render/colorprocessor.h"
+#include "render/rendermodes.h"
 
 namespace olive {
 
+class ClipBlock;
+class ColorManager;
+class ConformTask;
+
+/**
+ * @brief Scheduling class of a render ticket, in order of most to least urgent
+ */
+enum class RenderTicketPriority {
+  /// Realtime work such as audio for playback, runs on a reserved thread
+  kHigh = 0,
+
+  /// Frames the user is waiting on right now, e.g. while scrubbing
+  kInteractive,
+
+  /// Frames queued ahead of playback
+  kPlayback,
+
+  /// Frames and audio rendered in the background by the auto-cacher
+  kAutoCache,
+
+  /// Export and other user-started render tasks
+  kExport,
+
+  /// Anything else
+  kBackground,
+
+  kCount
+};
+
+/**
+ * @brief Parameters of a render, set once when the ticket is created and never modified after
+ */
+struct RenderRequest
+{
+  enum Type {
+    kTypeVideo,
+    kTypeAudio
+  };
+
+  enum ReturnType {
+    kTexture,
+    kFrame,
+
+    /// Nothing is returned, the render only exists to fill the cache
+    kNone
+  };
+
+  Type type = kTypeVideo;
+  Node *node = nullptr;
+  RenderMode::Mode mode = RenderMode::kOffline;
+  RenderTicketPriority priority = RenderTicketPriority::kBackground;
+
+  VideoParams video_params;
+  AudioParams audio_params;
+
+  /// Time of the frame to render, video only
+  rational time;
+
+  /// Range of audio to render, audio only
+  TimeRange range;
+
+  ColorManager *color_manager = nullptr;
+  QSize force_size = QSize(0, 0);
+  QMatrix4x4 force_matrix;
+  VideoParams::Format force_format = VideoParams::kFormatInvalid;
+  ColorProcessorPtr force_color_output = nullptr;
+  ReturnType return_type = kFrame;
+
+  /// If not empty, the rendered frame will be saved to this cache directory
+  QString cache_dir;
+  rational cache_timebase;
+  QUuid cache_uuid;
+
+  /// If set, a frame identical to one already in the cache references it instead of being rendered
+  bool cache_deduplicate = false;
+
+  /// Orders renders into the same cache, a frame never replaces one saved by a newer render
+  uint64_t cache_version = 0;
+
+  bool enable_waveforms = false;
+
+  /// Time (ms since epoch) by which the result must be ready to be useful, or 0 for no deadline
+  qint64 deadline = 0;
+};
+
+/**
+ * @brief Additional information produced by a render alongside its result
+ */
+struct RenderResult
+{
+  struct Waveform {
+    const ClipBlock* block;
+    AudioVisualWaveform waveform;
+    TimeRange range;
+    bool silence;
+
+    /// If set, the clip plays a conformed stream unaltered and can draw straight from this
+    /// waveform file (at `source_offset` + clip time) instead of `waveform`
+    QString source;
+    rational source_offset;
+  };
+
+  /// Waveform of the entire rendered range of audio
+  AudioVisualWaveform waveform;
+
+  /// Waveforms of each clip that contributed to the rendered range of audio
+  QVector<Waveform> waveforms;
+
+  struct ConformWait {
+    ConformTask *task;
+    TimeRange range;
+  };
+
+  /// Set if the render could not be completed because it's waiting on an audio conform
+  bool incomplete = false;
+
+  /// Ranges of each conform the render was missing, empty if unknown
+  QVector<ConformWait> conform_waits;
+
+  /// Set if the rendered frame was successfully saved to the requested cache
+  bool cached = false;
+
+  /// Set if the render was skipped because its deadline had already passed
+  bool skipped = false;
+};
+
 class RenderTicket : public QObject, public CancelableObject
 {
   Q_OBJECT
 public:
   RenderTicket();
+  RenderTicket(const RenderRequest &request);
+
+  /**
+   * @brief Get the parameters this ticket was created with
+   */
+  const RenderRequest &request() const
+  {
+    return request_;
+  }
+
+  /**
+   * @brief Access information produced by the render
+   *
+   * Should only be written to by the thread running this ticket and only read after the ticket
+   * has finished.
+   */
+  RenderResult &render_result()
+  {
+    return render_result_;
+  }
 
   /**
    * @brief Get the ticket's current state
@@ -107,6 +258,17 @@ public:
    */
   void Finish(QVariant result);
 
+  /**
+   * @brief Queue bookkeeping used by ThreadPool
+   *
+   * Lets a queued ticket be claimed by a worker or removed from the queue in constant time,
+   * whichever happens first.
+   */
+  QAtomicInt &queue_state()
+  {
+    return queue_state_;
+  }
+
 signals:
   /**
    * @brief Emitted when finish has been called by any means (either cancelled or with a result)
@@ -116,6 +278,10 @@ signals:
 private:
   void FinishInternal(bool has_result, QVariant result);
 
+  const RenderRequest request_;
+
+  RenderResult render_result_;
+
   bool is_running_;
 
   QVariant result_;
@@ -128,6 +294,8 @@ private:
 
   QWaitCondition wait_;
 
+  QAtomicInt queue_state_;
+
 };
 
 using RenderTicketPtr = std::shared_ptr<RenderTicket>;
@@ -58,6 +58,9 @@ TimelineView::TimelineView(Qt::Alignment vertical_alignment, QWidget *parent) :
   setBackgroundRole(QPalette::Window);
   setContextMenuPolicy(Qt::CustomContextMenu);
   viewport()->setMouseTracking(true);
+
+  waveform_cache_ = new TimelineViewWaveformCache(this);
+  connect(waveform_cache_, &TimelineViewWaveformCache::TileReady, viewport(), static_cast<void(QWidget::*)()>(&QWidget::update));
 }
 
 void TimelineView::mousePressEvent(QMouseEvent *event)
@@ -522,9 +525,7 @@ void TimelineView::DrawBlock(QPainter *painter, bool foreground, Block *block, q
         // Draw waveform
         if (show_waveforms_) {
           QRect waveform_rect = r.adjusted(0, text_total_height, 0, 0).toRect();
-          painter->setPen(shadow_color);
-          AudioVisualWaveform::DrawWaveform(painter, waveform_rect, this->GetScale(), clip->waveform(),
-                                            SceneToTime(block_left - block_in, GetScale(), connected_track_list_->parent()->GetAudioParams().sample_rate_as_time_base()));
+          waveform_cache_->Draw(painter, clip, waveform_rect, block_in, this->GetScale(), shadow_color);
         }
 
         // Draw zebra stripes and markers
@@ -711,6 +712,9 @@ void TimelineView::ConnectTrackList(TrackList *list)
 
   connected_track_list_ = list;
 
+  // Tiles belong to clips of the previous sequence
+  waveform_cache_->Clear();
+
   if (connected_track_list_) {
     connect(connected_track_list_, &TrackList::TrackListChanged, this, &TimelineView::TrackListChanged);
   }
@@ -30,6 +30,7 @@
 #include "node/block/clip/clip.h"
 #include "timelineviewmouseevent.h"
 #include "timelineviewghostitem.h"
+#include "timelineviewwaveformcache.h"
 #include "widget/timebased/timebasedview.h"
 
 namespace olive {
@@ -154,6 +155,8 @@ private:
 
   bool show_waveforms_;
 
+  TimelineViewWaveformCache *waveform_cache_;
+
   ClipBlock *transition_overlay_out_;
   ClipBlock *transition_overlay_in_;
 
@@ -0,0 +1,234 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2022 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+#include "timelineviewwaveformcache.h"
+
+#include <cmath>
+#include <QtConcurrent/QtConcurrent>
+#include <QtMath>
+
+#include "config/config.h"
+
+namespace olive {
+
+const int TimelineViewWaveformCache::kTileWidth = 256;
+const int TimelineViewWaveformCache::kBucketsPerOctave = 8;
+const int TimelineViewWaveformCache::kTileMargin = 4;
+
+TimelineViewWaveformCache::TimelineViewWaveformCache(QObject *parent) :
+  QObject(parent),
+  next_generation_(0)
+{
+}
+
+TimelineViewWaveformCache::~TimelineViewWaveformCache()
+{
+  // Jobs still running keep their own copy of the waveform, we just won't receive their results
+  Clear();
+}
+
+void TimelineViewWaveformCache::Draw(QPainter *painter, ClipBlock *clip, const QRect &rect, qreal clip_x, double scale, const QColor &color)
+{
+  if (rect.width() <= 0 || rect.height() <= 0 || scale <= 0) {
+    return;
+  }
+
+  const AudioVisualWaveform &waveform = clip->waveform();
+  bool rectified = OLIVE_CONFIG("RectifiedWaveforms").toBool();
+  int bucket = qRound(std::log2(scale) * kBucketsPerOctave);
+
+  auto it = clips_.find(clip);
+  if (it == clips_.end()) {
+    it = clips_.insert(clip, ClipTiles());
+    connect(clip, &QObject::destroyed, this, &TimelineViewWaveformCache::ClipDestroyed);
+  }
+
+  ClipTiles &entry = it.value();
+  Tiles &current = entry.current;
+
+  if (current.bucket != bucket
+      || current.height != rect.height()
+      || current.color != color.rgba()
+      || current.rectified != rectified
+      || current.revision != waveform.revision()) {
+    // Keep what we had to show until the new tiles are ready
+    if (!current.images.isEmpty()) {
+      entry.fallback = current;
+      entry.fallback.pending.clear();
+    }
+
+    current = Tiles();
+    current.bucket = bucket;
+    current.height = rect.height();
+    current.color = color.rgba();
+    current.rectified = rectified;
+    current.revision = waveform.revision();
+
+    entry.generation = ++next_generation_;
+  }
+
+  // Tiles are laid out from the start of the clip at the bucket's scale
+  qreal tile_width = kTileWidth * scale / BucketToScale(bucket);
+
+  int first_tile = qMax(0, qFloor((rect.left() - clip_x) / tile_width));
+  int last_tile = qMax(0, qFloor((rect.right() - clip_x) / tile_width));
+
+  painter->save();
+  painter->setClipRect(rect, Qt::IntersectClip);
+
+  bool all_ready = true;
+
+  for (int i=first_tile; i<=last_tile; i++) {
+    QRectF target(clip_x + i * tile_width, rect.y(), tile_width, rect.height());
+
+    auto img = current.images.constFind(i);
+    if (img != current.images.constEnd()) {
+      painter->drawImage(target, img.value());
+    } else {
+      all_ready = false;
+
+      QueueTile(clip, entry, i);
+
+      if (!entry.fallback.images.isEmpty()) {
+        DrawTiles(painter, entry.fallback, target.intersected(rect), clip_x, scale);
+      }
+    }
+  }
+
+  painter->restore();
+
+  if (all_ready) {
+    entry.fallback = Tiles();
+  }
+
+  // Free tiles that have scrolled well out of view
+  for (auto j=current.images.begin(); j!=current.images.end(); ) {
+    if (j.key() < first_tile - kTileMargin || j.key() > last_tile + kTileMargin) {
+      j = current.images.erase(j);
+    } else {
+      j++;
+    }
+  }
+}
+
+void TimelineViewWaveformCache::Clear()
+{
+  for (auto it=clips_.cbegin(); it!=clips_.cend(); it++) {
+    disconnect(it.key(), &QObject::destroyed, this, &TimelineViewWaveformCache::ClipDestroyed);
+  }
+
+  clips_.clear();
+}
+
+double TimelineViewWaveformCache::BucketToScale(int bucket)
+{
+  return std::exp2(double(bucket) / double(kBucketsPerOctave));
+}
+
+QImage TimelineViewWaveformCache::DrawTile(AudioVisualWaveform waveform, int index, int bucket, int height, QColor color, bool rectified)
+{
+  QImage img(kTileWidth, height, QImage::Format_ARGB32_Premultiplied);
+  img.fill(Qt::transparent);
+
+  double bucket_scale = BucketToScale(bucket);
+
+  QPainter p(&img);
+  p.setPen(color);
+
+  // DrawWaveform stops one pixel before the rect's right edge, so extend it by one
+  AudioVisualWaveform::DrawWaveform(&p, QRect(0, 0, kTileWidth + 1, height), bucket_scale, waveform,
+                                    rational::fromDouble(index * kTileWidth / bucket_scale), rectified);
+
+  return img;
+}
+
+void TimelineViewWaveformCache::DrawTiles(QPainter *painter, const Tiles &tiles, const QRectF &area, qreal clip_x, double scale)
+{
+  qreal tile_width = kTileWidth * scale / BucketToScale(tiles.bucket);
+
+  int first = qMax(0, qFloor((area.left() - clip_x) / tile_width));
+  int last = qMax(0, qFloor((area.right() - clip_x) / tile_width));
+
+  painter->save();
+  painter->setClipRect(area, Qt::IntersectClip);
+
+  for (int i=first; i<=last; i++) {
+    auto img = tiles.images.constFind(i);
+    if (img != tiles.images.constEnd()) {
+      painter->drawImage(QRectF(clip_x + i * tile_width, area.y(), tile_width, area.height()), img.value());
+    }
+  }
+
+  painter->restore();
+}
+
+void TimelineViewWaveformCache::QueueTile(ClipBlock *clip, ClipTiles &entry, int index)
+{
+  Tiles &current = entry.current;
+
+  if (current.pending.contains(index)) {
+    return;
+  }
+
+  current.pending.insert(index);
+
+  // The waveform is copied (cheaply, its data is implicitly shared) so the clip can keep being
+  // updated while the tile is drawn
+  AudioVisualWaveform waveform = clip->waveform();
+  int bucket = current.bucket;
+  int height = current.height;
+  QColor color = QColor::fromRgba(current.color);
+  bool rectified = current.rectified;
+
+  QFutureWatcher<QImage> *watcher = new QFutureWatcher<QImage>(this);
+  jobs_.insert(watcher, {clip, entry.generation, index});
+  connect(watcher, &QFutureWatcher<QImage>::finished, this, &TimelineViewWaveformCache::JobFinished);
+  watcher->setFuture(QtConcurrent::run([waveform, index, bucket, height, color, rectified]{
+    return DrawTile(waveform, index, bucket, height, color, rectified);
+  }));
+}
+
+void TimelineViewWaveformCache::JobFinished()
+{
+  QFutureWatcher<QImage> *watcher = static_cast<QFutureWatcher<QImage>*>(sender());
+
+  TileJob job = jobs_.take(watcher);
+
+  auto it = clips_.find(job.clip);
+  if (it != clips_.end() && it.value().generation == job.generation) {
+    Tiles &current = it.value().current;
+    current.pending.remove(job.index);
+    current.images.insert(job.index, watcher->result());
+    emit TileReady();
+  }
+
+  watcher->deleteLater();
+}
+
+void TimelineViewWaveformCache::ClipDestroyed(QObject *clip)
+{
+  for (auto it=clips_.begin(); it!=clips_.end(); it++) {
+    if (static_cast<QObject*>(it.key()) == clip) {
+      clips_.erase(it);
+      break;
+    }
+  }
+}
+
+}
@@ -0,0 +1,131 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2022 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+#ifndef TIMELINEVIEWWAVEFORMCACHE_H
+#define TIMELINEVIEWWAVEFORMCACHE_H
+
+#include <climits>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QImage>
+#include <QObject>
+#include <QPainter>
+#include <QSet>
+
+#include "node/block/clip/clip.h"
+
+namespace olive {
+
+/**
+ * @brief Cache of pre-drawn clip waveform tiles for TimelineView
+ *
+ * Waveforms are drawn into fixed-width tiles per clip and zoom bucket on worker threads, so a
+ * repaint only has to blit the tiles that are visible. A clip's tiles are redrawn when its
+ * waveform's revision changes, and the previous tiles are shown stretched in the meantime.
+ */
+class TimelineViewWaveformCache : public QObject
+{
+  Q_OBJECT
+public:
+  TimelineViewWaveformCache(QObject *parent = nullptr);
+
+  virtual ~TimelineViewWaveformCache() override;
+
+  /**
+   * @brief Draw a clip's waveform
+   *
+   * `clip_x` is the x coordinate the start of the clip would be drawn at and `rect` is the visible
+   * area of the clip to draw the waveform into. Tiles that aren't ready yet are queued and
+   * TileReady() is emitted when they are.
+   */
+  void Draw(QPainter *painter, ClipBlock *clip, const QRect &rect, qreal clip_x, double scale, const QColor &color);
+
+  void Clear();
+
+  /**
+   * @brief Width of one tile in pixels
+   */
+  static const int kTileWidth;
+
+  /**
+   * @brief Number of zoom buckets per doubling of scale
+   *
+   * Tiles are drawn at their bucket's scale and stretched to the exact scale when blitted.
+   */
+  static const int kBucketsPerOctave;
+
+signals:
+  void TileReady();
+
+private:
+  struct Tiles {
+    int bucket = INT_MIN;
+    int height = 0;
+    QRgb color = 0;
+    bool rectified = false;
+    quint64 revision = 0;
+    QHash<int, QImage> images;
+    QSet<int> pending;
+  };
+
+  struct ClipTiles {
+    Tiles current;
+
+    /// Tiles from before the last change, drawn until the current ones are ready
+    Tiles fallback;
+
+    /// Changed whenever `current` is reset so outdated jobs can be discarded
+    quint64 generation = 0;
+  };
+
+  struct TileJob {
+    ClipBlock *clip;
+    quint64 generation;
+    int index;
+  };
+
+  static double BucketToScale(int bucket);
+
+  static QImage DrawTile(AudioVisualWaveform waveform, int index, int bucket, int height, QColor color, bool rectified);
+
+  static void DrawTiles(QPainter *painter, const Tiles &tiles, const QRectF &area, qreal clip_x, double scale);
+
+  void QueueTile(ClipBlock *clip, ClipTiles &entry, int index);
+
+  QHash<ClipBlock*, ClipTiles> clips_;
+
+  QHash<QFutureWatcher<QImage>*, TileJob> jobs_;
+
+  quint64 next_generation_;
+
+  /**
+   * @brief Tiles kept on either side of the visible ones before they're freed
+   */
+  static const int kTileMargin;
+
+private slots:
+  void JobFinished();
+
+  void ClipDestroyed(QObject *clip);
+
+};
+
+}
+
+#endif // TIMELINEVIEWWAVEFORMCACHE_H
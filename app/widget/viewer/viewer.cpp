@@ -718,7 +718,7 @@ void ViewerWidget::UpdateTextureFromNode()
       ClearVideoAutoCacherQueue();
     }
 
-    watcher->SetTicket(GetFrame(time, RenderTicketPriority::kNormal));
+    watcher->SetTicket(GetFrame(time, RenderTicketPriority::kInteractive));
   } else {
     // There is definitely no frame here, we can immediately flip to showing nothing
     nonqueue_watchers_.clear();
@@ -773,6 +773,8 @@ void ViewerWidget::PlayInternal(int speed, bool in_to_out_only)
 
   playback_queue_next_frame_ = GetTimestamp() + playback_speed_;
 
+  playback_stats_ = PlaybackStatistics();
+
   controls_->ShowPauseButton();
 
   queue_starved_start_ = 0;
@@ -922,6 +924,25 @@ RenderTicketWatcher *ViewerWidget::RequestNextFrameForQueue(RenderTicketPriority
 {
   RenderTicketWatcher *watcher = nullptr;
 
+  // Once the playback clock is running, every frame has a time by which it must arrive
+  qint64 deadline = 0;
+  if (playback_backup_timer_.isActive()) {
+    ViewerPlaybackTimer *timer = display_widget_->timer();
+
+    deadline = timer->GetPresentationTime(playback_queue_next_frame_);
+
+    if (increment && deadline < QDateTime::currentMSecsSinceEpoch()) {
+      // We've fallen behind, so rather than rendering frames that will never be shown, skip
+      // ahead to the next one that can still arrive in time
+      int64_t next_ts = timer->GetTimestampNow() + playback_speed_;
+      int skipped = qAbs(next_ts - playback_queue_next_frame_) / qAbs(playback_speed_);
+      playback_stats_.skipped += skipped;
+      display_widget_->IncrementSkippedFrames(skipped);
+      playback_queue_next_frame_ = next_ts;
+      deadline = timer->GetPresentationTime(playback_queue_next_frame_);
+    }
+  }
+
   rational next_time = Timecode::timestamp_to_time(playback_queue_next_frame_,
                                                    timebase());
 
@@ -932,25 +953,29 @@ RenderTicketWatcher *ViewerWidget::RequestNextFrameForQueue(RenderTicketPriority
 
     watcher = new RenderTicketWatcher();
     watcher->setProperty("time", QVariant::fromValue(next_time));
+    watcher->setProperty("deadline", deadline);
     connect(watcher, &RenderTicketWatcher::Finished, this, &ViewerWidget::RendererGeneratedFrameForQueue);
     queue_watchers_.append(watcher);
-    watcher->SetTicket(GetFrame(next_time, priority));
+    playback_stats_.requested++;
+    watcher->SetTicket(GetFrame(next_time, priority, deadline));
   }
 
   return watcher;
 }
 
-RenderTicketPtr ViewerWidget::GetFrame(const rational &t, RenderTicketPriority priority)
+RenderTicketPtr ViewerWidget::GetFrame(const rational &t, RenderTicketPriority priority, qint64 deadline)
 {
   QString cache_fn = GetConnectedNode()->video_frame_cache()->GetValidCacheFilename(t);
 
   if (!QFileInfo::exists(cache_fn)) {
     // Frame hasn't been cached, start render job
-    return auto_cacher_.GetSingleFrame(t, priority);
+    return auto_cacher_.GetSingleFrame(t, priority, deadline);
   } else {
     // Frame has been cached, grab the frame
-    RenderTicketPtr ticket = std::make_shared<RenderTicket>();
-    ticket->setProperty("time", QVariant::fromValue(t));
+    RenderRequest request;
+    request.time = t;
+
+    RenderTicketPtr ticket = std::make_shared<RenderTicket>(request);
     QtConcurrent::run(ViewerWidget::DecodeCachedImage, ticket, GetConnectedNode()->video_frame_cache()->GetCacheDirectory(), GetConnectedNode()->video_frame_cache()->GetUuid(), Timecode::time_to_timestamp(t, timebase(), Timecode::kFloor));
     return ticket;
   }
@@ -1098,9 +1123,21 @@ void ViewerWidget::RendererGeneratedFrameForQueue()
   if (queue_watchers_.contains(watcher)) {
     queue_watchers_.removeOne(watcher);
 
-    if (watcher->HasResult()) {
+    qint64 deadline = watcher->property("deadline").toLongLong();
+
+    if (watcher->GetTicket()->render_result().skipped) {
+      // Renderer dropped this frame because it couldn't be delivered in time
+      playback_stats_.skipped++;
+      display_widget_->IncrementSkippedFrames();
+    } else if (watcher->HasResult() && deadline && QDateTime::currentMSecsSinceEpoch() > deadline) {
+      // Arrived too late to be shown, the queue would only purge it
+      playback_stats_.late++;
+      display_widget_->IncrementSkippedFrames();
+    } else if (watcher->HasResult()) {
       QVariant frame = watcher->Get();
 
+      playback_stats_.delivered++;
+
       // Ignore this signal if we've paused now
       if (IsPlaying() || prequeuing_video_) {
         rational ts = watcher->property("time").value<rational>();
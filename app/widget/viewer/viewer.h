@@ -94,6 +94,29 @@ public:
     enable_audio_scrubbing_ = e;
   }
 
+  /**
+   * @brief Frame delivery counts for the current (or most recent) playback
+   */
+  struct PlaybackStatistics
+  {
+    /// Frames requested for the playback queue
+    int requested = 0;
+
+    /// Frames that arrived before they were due to be shown
+    int delivered = 0;
+
+    /// Frames that arrived after they were due to be shown
+    int late = 0;
+
+    /// Frames that were never rendered because they couldn't be delivered in time
+    int skipped = 0;
+  };
+
+  const PlaybackStatistics &GetPlaybackStatistics() const
+  {
+    return playback_stats_;
+  }
+
 public slots:
   void Play(bool in_to_out_only);
 
@@ -195,9 +218,9 @@ private:
 
   void SetDisplayImage(QVariant frame);
 
-  RenderTicketWatcher *RequestNextFrameForQueue(RenderTicketPriority priority = RenderTicketPriority::kNormal, bool increment = true);
+  RenderTicketWatcher *RequestNextFrameForQueue(RenderTicketPriority priority = RenderTicketPriority::kPlayback, bool increment = true);
 
-  RenderTicketPtr GetFrame(const rational& t, RenderTicketPriority priority);
+  RenderTicketPtr GetFrame(const rational& t, RenderTicketPriority priority, qint64 deadline = 0);
 
   void FinishPlayPreprocess();
 
@@ -282,6 +305,8 @@ private:
   qint64 queue_starved_start_;
   RenderTicketWatcher *first_requeue_watcher_;
 
+  PlaybackStatistics playback_stats_;
+
   bool enable_audio_scrubbing_;
 
 private slots:
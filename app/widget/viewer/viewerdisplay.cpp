@@ -235,9 +235,9 @@ void ViewerDisplayWidget::ResetFPSTimer()
   Core::instance()->ClearStatusBarMessage();
 }
 
-void ViewerDisplayWidget::IncrementSkippedFrames()
+void ViewerDisplayWidget::IncrementSkippedFrames(int count)
 {
-  frames_skipped_++;
+  frames_skipped_ += count;
 
   Core::instance()->ShowStatusBarMessage(tr("%n skipped frame(s) detected during playback", nullptr, frames_skipped_), 10000);
 }
@@ -104,7 +104,7 @@ public:
   bool GetShowSubtitles() const { return show_subtitles_; }
   void SetShowSubtitles(bool e) { show_subtitles_ = e; update(); }
 
-  void IncrementSkippedFrames();
+  void IncrementSkippedFrames(int count = 1);
 
   void IncrementFrameCount()
   {
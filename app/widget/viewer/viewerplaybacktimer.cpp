@@ -42,4 +42,11 @@ int64_t ViewerPlaybackTimer::GetTimestampNow() const
   return start_timestamp_ + frames_since_start * playback_speed_;
 }
 
+qint64 ViewerPlaybackTimer::GetPresentationTime(int64_t timestamp) const
+{
+  int64_t frames_since_start = (timestamp - start_timestamp_) / playback_speed_;
+
+  return start_msec_ + qRound64(frames_since_start * timebase_);
+}
+
 }
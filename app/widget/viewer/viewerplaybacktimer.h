@@ -33,6 +33,11 @@ public:
 
   int64_t GetTimestampNow() const;
 
+  /**
+   * @brief Get the time (ms since epoch) at which a timestamp will be presented
+   */
+  qint64 GetPresentationTime(int64_t timestamp) const;
+
 private:
   qint64 start_msec_;
   int64_t start_timestamp_;
@@ -0,0 +1,184 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2022 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "testutil.h"
+
+#include "node/generator/solid/solid.h"
+#include "node/math/merge/merge.h"
+#include "node/project/project.h"
+#include "node/time/timeoffset/timeoffsetnode.h"
+#include "node/traverser.h"
+
+namespace olive {
+
+class CountingTraverser : public NodeTraverser
+{
+public:
+  QHash<const Node*, int> shader_count;
+
+protected:
+  virtual void ProcessShader(TexturePtr destination, const Node *node, const TimeRange &range, const ShaderJob &job) override
+  {
+    Q_UNUSED(destination)
+    Q_UNUSED(range)
+    Q_UNUSED(job)
+
+    shader_count[node]++;
+  }
+
+};
+
+class TextureTrackingTraverser : public NodeTraverser
+{
+public:
+  using NodeTraverser::ClearMemo;
+  using NodeTraverser::PlanTraversal;
+
+  QVector<std::weak_ptr<Texture> > textures;
+
+  bool AnyTextureAlive() const
+  {
+    foreach (const std::weak_ptr<Texture> &t, textures) {
+      if (!t.expired()) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+protected:
+  virtual TexturePtr CreateTexture(const VideoParams &p) override
+  {
+    TexturePtr t = NodeTraverser::CreateTexture(p);
+    textures.append(t);
+    return t;
+  }
+
+};
+
+static const TimeRange kTestRange(0, 1);
+
+/**
+ * @brief Solid into a merge that passes its texture on to both inputs of a second merge
+ *
+ * The first merge has two outputs so its table, which holds the solid's texture, is memoized.
+ */
+static MergeNode *CreateSharedTextureGraph(Project *project)
+{
+  SolidGenerator *solid = new SolidGenerator();
+  solid->setParent(project);
+
+  MergeNode *shared = new MergeNode();
+  shared->setParent(project);
+
+  MergeNode *merge = new MergeNode();
+  merge->setParent(project);
+
+  Node::ConnectEdge(solid, NodeInput(shared, MergeNode::kBaseIn));
+  Node::ConnectEdge(shared, NodeInput(merge, MergeNode::kBaseIn));
+  Node::ConnectEdge(shared, NodeInput(merge, MergeNode::kBlendIn));
+
+  return merge;
+}
+
+OLIVE_ADD_TEST(SharedJobResolvedOnce)
+{
+  Project project;
+
+  SolidGenerator *solid = new SolidGenerator();
+  solid->setParent(&project);
+
+  MergeNode *merge = new MergeNode();
+  merge->setParent(&project);
+
+  // Both of the merge's inputs receive the exact same job
+  Node::ConnectEdge(solid, NodeInput(merge, MergeNode::kBaseIn));
+  Node::ConnectEdge(solid, NodeInput(merge, MergeNode::kBlendIn));
+
+  CountingTraverser traverser;
+  traverser.GenerateTable(merge, kTestRange);
+
+  OLIVE_ASSERT_EQUAL(traverser.shader_count.value(solid), 1);
+
+  OLIVE_TEST_END;
+}
+
+OLIVE_ADD_TEST(TimeShiftedJobNotShared)
+{
+  Project project;
+
+  SolidGenerator *solid = new SolidGenerator();
+  solid->setParent(&project);
+
+  TimeOffsetNode *offset = new TimeOffsetNode();
+  offset->setParent(&project);
+  offset->SetStandardValue(TimeOffsetNode::kTimeInput, QVariant::fromValue(rational(1)));
+
+  MergeNode *merge = new MergeNode();
+  merge->setParent(&project);
+
+  // The offset passes through a job from the same source node, but generated at another time, so
+  // it must be resolved separately from the direct one
+  Node::ConnectEdge(solid, NodeInput(merge, MergeNode::kBaseIn));
+  Node::ConnectEdge(solid, NodeInput(offset, TimeOffsetNode::kInputInput));
+  Node::ConnectEdge(offset, NodeInput(merge, MergeNode::kBlendIn));
+
+  CountingTraverser traverser;
+  traverser.GenerateTable(merge, kTestRange);
+
+  OLIVE_ASSERT_EQUAL(traverser.shader_count.value(solid), 2);
+
+  OLIVE_TEST_END;
+}
+
+OLIVE_ADD_TEST(PlannedMemoReleasedAfterLastUse)
+{
+  Project project;
+  MergeNode *merge = CreateSharedTextureGraph(&project);
+
+  TextureTrackingTraverser traverser;
+  traverser.PlanTraversal(merge, kTestRange);
+  traverser.GenerateTable(merge, kTestRange);
+
+  OLIVE_ASSERT(!traverser.textures.isEmpty());
+
+  // Both consumers of the shared table have taken it, so nothing should be left holding textures
+  OLIVE_ASSERT(!traverser.AnyTextureAlive());
+
+  OLIVE_TEST_END;
+}
+
+OLIVE_ADD_TEST(UnplannedMemoHeldUntilCleared)
+{
+  Project project;
+  MergeNode *merge = CreateSharedTextureGraph(&project);
+
+  TextureTrackingTraverser traverser;
+  traverser.GenerateTable(merge, kTestRange);
+
+  OLIVE_ASSERT(traverser.AnyTextureAlive());
+
+  traverser.ClearMemo();
+  OLIVE_ASSERT(!traverser.AnyTextureAlive());
+
+  OLIVE_TEST_END;
+}
+
+}
@@ -0,0 +1,75 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2022 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "testutil.h"
+
+#include <algorithm>
+
+#include <QTemporaryDir>
+
+#include "audio/audiovisualwaveform.h"
+#include "audio/audiowaveformfile.h"
+#include "codec/samplebuffer.h"
+
+namespace olive {
+
+OLIVE_ADD_TEST(PartialOverwriteKeepsSourceSums)
+{
+  QTemporaryDir dir;
+  OLIVE_ASSERT(dir.isValid());
+
+  AudioParams params(48000, AV_CH_LAYOUT_STEREO, AudioParams::kFormatFloat32Planar);
+
+  // One second at a constant level, stored the same way conformed footage stores its waveform
+  SampleBuffer samples(params, params.sample_rate());
+  for (int c=0; c<samples.channel_count(); c++) {
+    std::fill(samples.data(c), samples.data(c) + samples.sample_count(), 0.5f);
+  }
+
+  AudioVisualWaveform footage;
+  footage.set_channel_count(params.channel_count());
+  footage.OverwriteSamples(samples, params.sample_rate());
+
+  QString fn = dir.filePath(QStringLiteral("waveform"));
+  OLIVE_ASSERT(AudioWaveformFile::Write(fn, footage));
+
+  AudioWaveformFilePtr file = AudioWaveformFile::Get(fn);
+  OLIVE_ASSERT(file);
+
+  AudioVisualWaveform clip;
+  clip.SetSource(file, 0);
+  OLIVE_ASSERT(clip.HasSource());
+
+  // Silencing part of the clip must not lose the rest of the source
+  clip.OverwriteSilence(rational(1, 4), rational(1, 4));
+  OLIVE_ASSERT(!clip.HasSource());
+  OLIVE_ASSERT(clip.length() == rational(1));
+
+  AudioVisualWaveform::Sample untouched = clip.GetSummaryFromTime(rational(3, 4), rational(1, 8));
+  OLIVE_ASSERT_EQUAL(untouched.size(), 2);
+  OLIVE_ASSERT(qFuzzyCompare(untouched.at(0).max, 0.5f));
+
+  AudioVisualWaveform::Sample silenced = clip.GetSummaryFromTime(rational(5, 16), rational(1, 16));
+  OLIVE_ASSERT(qFuzzyIsNull(silenced.at(0).max));
+
+  OLIVE_TEST_END;
+}
+
+}
@@ -0,0 +1,368 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2022 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+#include "testutil.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "codec/samplebuffer.h"
+#include "codec/samplebufferkernels.h"
+
+namespace olive {
+
+// Lengths either side of the SSE and AVX2 vector widths, so the scalar remainder runs too
+static const int kTestLengths[] = {1, 3, 4, 7, 8, 9, 13, 16, 31, 64, 1001};
+
+static AudioParams TestParams()
+{
+  return AudioParams(48000, AV_CH_LAYOUT_STEREO, AudioParams::kFormatFloat32Planar);
+}
+
+static SampleBuffer MakeBuffer(int length, int seed)
+{
+  SampleBuffer b(TestParams(), length);
+
+  for (int c=0; c<b.channel_count(); c++) {
+    float *d = b.data(c);
+    for (int i=0; i<length; i++) {
+      // Deterministic values in roughly [-2, 2] so clamping has something to do
+      d[i] = std::sin(float(i * 7 + c * 13 + seed)) * 2.0f;
+    }
+  }
+
+  return b;
+}
+
+static bool Near(float a, float b, float tolerance = 1e-5f)
+{
+  return std::abs(a - b) <= tolerance * std::max(1.0f, std::abs(b));
+}
+
+static bool ChannelsMatch(const SampleBuffer &b, const std::vector<std::vector<float> > &ref, float tolerance = 1e-5f)
+{
+  for (int c=0; c<b.channel_count(); c++) {
+    for (int i=0; i<b.sample_count(); i++) {
+      if (!Near(b.data(c)[i], ref[c][i], tolerance)) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+static std::vector<std::vector<float> > CopyChannels(const SampleBuffer &b)
+{
+  std::vector<std::vector<float> > v(b.channel_count());
+
+  for (int c=0; c<b.channel_count(); c++) {
+    v[c].assign(b.data(c), b.data(c) + b.sample_count());
+  }
+
+  return v;
+}
+
+// Each kernel list starts with one that leaves everything to the scalar kernel
+using ScaleKernel = int (*)(float *, int, float);
+using MulAddKernel = int (*)(float *, const float *, int, float);
+using RampKernel = int (*)(float *, int, float, float);
+using ClampKernel = int (*)(float *, int, float, float);
+using PeakKernel = int (*)(const float *, int, float *);
+using SumSquaresKernel = int (*)(const float *, int, double *);
+
+static std::vector<ScaleKernel> ScaleKernels()
+{
+  std::vector<ScaleKernel> k = {[](float *, int, float) { return 0; }};
+#ifdef SAMPLEBUFFER_SSE
+  k.push_back(ScaleSSE);
+#endif
+#ifdef SAMPLEBUFFER_AVX2
+  if (CPUSupportsAVX2()) {
+    k.push_back(ScaleAVX2);
+  }
+#endif
+  return k;
+}
+
+static std::vector<MulAddKernel> MulAddKernels()
+{
+  std::vector<MulAddKernel> k = {[](float *, const float *, int, float) { return 0; }};
+#ifdef SAMPLEBUFFER_SSE
+  k.push_back(MulAddSSE);
+#endif
+#ifdef SAMPLEBUFFER_AVX2
+  if (CPUSupportsAVX2()) {
+    k.push_back(MulAddAVX2);
+  }
+#endif
+  return k;
+}
+
+static std::vector<RampKernel> RampKernels()
+{
+  std::vector<RampKernel> k = {[](float *, int, float, float) { return 0; }};
+#ifdef SAMPLEBUFFER_SSE
+  k.push_back(RampSSE);
+#endif
+#ifdef SAMPLEBUFFER_AVX2
+  if (CPUSupportsAVX2()) {
+    k.push_back(RampAVX2);
+  }
+#endif
+  return k;
+}
+
+static std::vector<ClampKernel> ClampKernels()
+{
+  std::vector<ClampKernel> k = {[](float *, int, float, float) { return 0; }};
+#ifdef SAMPLEBUFFER_SSE
+  k.push_back(ClampSSE);
+#endif
+#ifdef SAMPLEBUFFER_AVX2
+  if (CPUSupportsAVX2()) {
+    k.push_back(ClampAVX2);
+  }
+#endif
+  return k;
+}
+
+static std::vector<PeakKernel> PeakKernels()
+{
+  std::vector<PeakKernel> k = {[](const float *, int, float *) { return 0; }};
+#ifdef SAMPLEBUFFER_SSE
+  k.push_back(PeakSSE);
+#endif
+#ifdef SAMPLEBUFFER_AVX2
+  if (CPUSupportsAVX2()) {
+    k.push_back(PeakAVX2);
+  }
+#endif
+  return k;
+}
+
+static std::vector<SumSquaresKernel> SumSquaresKernels()
+{
+  std::vector<SumSquaresKernel> k = {[](const float *, int, double *) { return 0; }};
+#ifdef SAMPLEBUFFER_SSE
+  k.push_back(SumSquaresSSE);
+#endif
+#ifdef SAMPLEBUFFER_AVX2
+  if (CPUSupportsAVX2()) {
+    k.push_back(SumSquaresAVX2);
+  }
+#endif
+  return k;
+}
+
+OLIVE_ADD_TEST(ScaleKernelsMatchScalar)
+{
+  for (ScaleKernel kernel : ScaleKernels()) {
+    for (int n : kTestLengths) {
+      SampleBuffer b = MakeBuffer(n, 0);
+      std::vector<std::vector<float> > ref = CopyChannels(b);
+      for (auto &ch : ref) {
+        for (float &f : ch) {
+          f *= 0.37f;
+        }
+      }
+
+      for (int c=0; c<b.channel_count(); c++) {
+        ScaleScalar(b.data(c), kernel(b.data(c), n, 0.37f), n, 0.37f);
+      }
+      OLIVE_ASSERT(ChannelsMatch(b, ref));
+    }
+  }
+
+  OLIVE_TEST_END;
+}
+
+OLIVE_ADD_TEST(MulAddKernelsMatchScalar)
+{
+  for (MulAddKernel kernel : MulAddKernels()) {
+    for (int n : kTestLengths) {
+      SampleBuffer b = MakeBuffer(n, 0);
+      SampleBuffer other = MakeBuffer(n, 5);
+      std::vector<std::vector<float> > ref = CopyChannels(b);
+      std::vector<std::vector<float> > src = CopyChannels(other);
+      for (size_t c=0; c<ref.size(); c++) {
+        for (int i=0; i<n; i++) {
+          ref[c][i] += src[c][i] * 0.5f;
+        }
+      }
+
+      for (int c=0; c<b.channel_count(); c++) {
+        MulAddScalar(b.data(c), other.data(c), kernel(b.data(c), other.data(c), n, 0.5f), n, 0.5f);
+      }
+      OLIVE_ASSERT(ChannelsMatch(b, ref));
+    }
+  }
+
+  OLIVE_TEST_END;
+}
+
+OLIVE_ADD_TEST(RampKernelsMatchScalar)
+{
+  for (RampKernel kernel : RampKernels()) {
+    for (int n : kTestLengths) {
+      SampleBuffer b = MakeBuffer(n, 0);
+      std::vector<std::vector<float> > ref = CopyChannels(b);
+      float step = (n > 1) ? (0.25f - 1.0f) / (n - 1) : 0.0f;
+      for (auto &ch : ref) {
+        for (int i=0; i<n; i++) {
+          ch[i] *= 1.0f + step * i;
+        }
+      }
+
+      for (int c=0; c<b.channel_count(); c++) {
+        RampScalar(b.data(c), kernel(b.data(c), n, 1.0f, step), n, 1.0f, step);
+      }
+      // The vector kernels step the gain incrementally, so allow for some accumulated rounding
+      OLIVE_ASSERT(ChannelsMatch(b, ref, 1e-4f));
+    }
+  }
+
+  OLIVE_TEST_END;
+}
+
+OLIVE_ADD_TEST(ClampKernelsMatchScalar)
+{
+  for (ClampKernel kernel : ClampKernels()) {
+    for (int n : kTestLengths) {
+      SampleBuffer b = MakeBuffer(n, 0);
+      std::vector<std::vector<float> > ref = CopyChannels(b);
+      for (auto &ch : ref) {
+        for (float &f : ch) {
+          f = std::clamp(f, -1.0f, 1.0f);
+        }
+      }
+
+      for (int c=0; c<b.channel_count(); c++) {
+        ClampScalar(b.data(c), kernel(b.data(c), n, -1.0f, 1.0f), n, -1.0f, 1.0f);
+      }
+      OLIVE_ASSERT(ChannelsMatch(b, ref));
+    }
+  }
+
+  OLIVE_TEST_END;
+}
+
+OLIVE_ADD_TEST(ReverseMatchesScalar)
+{
+  for (int n : kTestLengths) {
+    SampleBuffer b = MakeBuffer(n, 0);
+    std::vector<std::vector<float> > ref = CopyChannels(b);
+    for (auto &ch : ref) {
+      std::reverse(ch.begin(), ch.end());
+    }
+
+    b.reverse();
+    OLIVE_ASSERT(ChannelsMatch(b, ref));
+  }
+
+  OLIVE_TEST_END;
+}
+
+OLIVE_ADD_TEST(PeakKernelsMatchScalar)
+{
+  for (PeakKernel kernel : PeakKernels()) {
+    for (int n : kTestLengths) {
+      SampleBuffer b = MakeBuffer(n, 3);
+
+      for (int c=0; c<b.channel_count(); c++) {
+        const float *d = b.data(c);
+
+        float ref = 0.0f;
+        for (int i=0; i<n; i++) {
+          ref = std::max(ref, std::abs(d[i]));
+        }
+
+        float peak = 0.0f;
+        int start = kernel(d, n, &peak);
+        OLIVE_ASSERT(Near(PeakScalar(d, start, n, peak), ref));
+      }
+    }
+  }
+
+  OLIVE_TEST_END;
+}
+
+OLIVE_ADD_TEST(SumSquaresKernelsMatchScalar)
+{
+  for (SumSquaresKernel kernel : SumSquaresKernels()) {
+    for (int n : kTestLengths) {
+      SampleBuffer b = MakeBuffer(n, 3);
+
+      for (int c=0; c<b.channel_count(); c++) {
+        const float *d = b.data(c);
+
+        double ref = 0.0;
+        for (int i=0; i<n; i++) {
+          ref += double(d[i]) * d[i];
+        }
+
+        double sum = 0.0;
+        int start = kernel(d, n, &sum);
+        // The vector kernels accumulate in single precision
+        OLIVE_ASSERT(Near(float(SumSquaresScalar(d, start, n, sum)), float(ref), 1e-4f));
+      }
+    }
+  }
+
+  OLIVE_TEST_END;
+}
+
+OLIVE_ADD_TEST(PeakAndRMSUseKernels)
+{
+  SampleBuffer b = MakeBuffer(1001, 3);
+
+  for (int c=0; c<b.channel_count(); c++) {
+    const float *d = b.data(c);
+
+    float peak = 0.0f;
+    double sum = 0.0;
+    for (int i=0; i<b.sample_count(); i++) {
+      peak = std::max(peak, std::abs(d[i]));
+      sum += double(d[i]) * d[i];
+    }
+
+    OLIVE_ASSERT(Near(b.peak(c), peak));
+    OLIVE_ASSERT(Near(b.rms(c), float(std::sqrt(sum / b.sample_count())), 1e-4f));
+  }
+
+  OLIVE_TEST_END;
+}
+
+OLIVE_ADD_TEST(SharedCopyDetachesOnWrite)
+{
+  SampleBuffer a = MakeBuffer(13, 0);
+  SampleBuffer b = a;
+
+  std::vector<std::vector<float> > ref = CopyChannels(a);
+
+  b.transform_volume(0.0f);
+
+  OLIVE_ASSERT(ChannelsMatch(a, ref));
+  OLIVE_ASSERT_EQUAL(b.peak(0), 0.0f);
+
+  OLIVE_TEST_END;
+}
+
+}
@@ -0,0 +1,238 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2022 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "testutil.h"
+
+#include <QFile>
+#include <QTemporaryDir>
+
+#include "render/framepackfile.h"
+
+namespace olive {
+
+static QByteArray ReadPackFrame(const QString &filename, const int64_t &timestamp)
+{
+  FramePackFile::Reader reader(filename, timestamp);
+
+  if (!reader.IsValid()) {
+    return QByteArray();
+  }
+
+  return QByteArray(reader.data(), reader.size());
+}
+
+OLIVE_ADD_TEST(StaleAppendDoesNotReplaceNewer)
+{
+  QTemporaryDir dir;
+  OLIVE_ASSERT(dir.isValid());
+
+  QString fn = FramePackFile::GetPackFilename(dir.path(), 3);
+
+  OLIVE_ASSERT(FramePackFile::Append(fn, 3, QByteArrayLiteral("new frame"), QByteArray(), 2));
+
+  // A render that started earlier finishing last must not replace the newer frame
+  OLIVE_ASSERT(!FramePackFile::Append(fn, 3, QByteArrayLiteral("old frame"), QByteArray(), 1));
+  OLIVE_ASSERT(ReadPackFrame(fn, 3) == QByteArrayLiteral("new frame"));
+
+  // The stale record comes after the newer one on disk, it mustn't win when the pack is rescanned
+  FramePackFile::Forget(fn);
+  OLIVE_ASSERT(ReadPackFrame(fn, 3) == QByteArrayLiteral("new frame"));
+
+  OLIVE_ASSERT(FramePackFile::Append(fn, 3, QByteArrayLiteral("newer frame"), QByteArray(), 3));
+  OLIVE_ASSERT(ReadPackFrame(fn, 3) == QByteArrayLiteral("newer frame"));
+
+  FramePackFile::Forget(fn);
+
+  OLIVE_TEST_END;
+}
+
+OLIVE_ADD_TEST(ReferenceResolvesToFingerprintedFrame)
+{
+  QTemporaryDir dir;
+  OLIVE_ASSERT(dir.isValid());
+
+  QString target_fn = FramePackFile::GetPackFilename(dir.path(), 3);
+  QString ref_fn = FramePackFile::GetPackFilename(dir.path(), 40);
+  OLIVE_ASSERT(target_fn != ref_fn);
+
+  // Nothing has this fingerprint yet
+  OLIVE_ASSERT(!FramePackFile::AppendReference(ref_fn, 40, QByteArrayLiteral("abc")));
+
+  OLIVE_ASSERT(FramePackFile::Append(target_fn, 3, QByteArrayLiteral("frame"), QByteArrayLiteral("abc")));
+  OLIVE_ASSERT(FramePackFile::AppendReference(ref_fn, 40, QByteArrayLiteral("abc")));
+
+  OLIVE_ASSERT(ReadPackFrame(ref_fn, 40) == QByteArrayLiteral("frame"));
+
+  // Deleting the target leaves the reference broken, and it must be reported as such
+  OLIVE_ASSERT(QFile::remove(target_fn));
+  FramePackFile::Forget(target_fn);
+
+  QVector<int64_t> refs = FramePackFile::GetReferencesTo(target_fn);
+  OLIVE_ASSERT(refs.size() == 1 && refs.first() == 40);
+
+  {
+    FramePackFile::Reader reader(ref_fn, 40);
+    OLIVE_ASSERT(!reader.IsValid());
+    OLIVE_ASSERT(reader.IsBrokenReference());
+  }
+
+  FramePackFile::Forget(ref_fn);
+
+  OLIVE_TEST_END;
+}
+
+OLIVE_ADD_TEST(IndexRebuiltFromDisk)
+{
+  QTemporaryDir dir;
+  OLIVE_ASSERT(dir.isValid());
+
+  QString fn = FramePackFile::GetPackFilename(dir.path(), 0);
+
+  OLIVE_ASSERT(FramePackFile::Append(fn, 0, QByteArrayLiteral("zero")));
+  OLIVE_ASSERT(FramePackFile::Append(fn, 1, QByteArrayLiteral("one")));
+  OLIVE_ASSERT(FramePackFile::Append(fn, 2, QByteArrayLiteral("two, with an unaligned length")));
+  OLIVE_ASSERT(FramePackFile::Append(fn, 1, QByteArrayLiteral("one again"), QByteArray(), 1));
+
+  // Drop the in-memory index as if this were a new session
+  FramePackFile::Forget(fn);
+
+  OLIVE_ASSERT(ReadPackFrame(fn, 0) == QByteArrayLiteral("zero"));
+  OLIVE_ASSERT(ReadPackFrame(fn, 1) == QByteArrayLiteral("one again"));
+  OLIVE_ASSERT(ReadPackFrame(fn, 2) == QByteArrayLiteral("two, with an unaligned length"));
+  OLIVE_ASSERT(ReadPackFrame(fn, 3).isEmpty());
+
+  FramePackFile::Forget(fn);
+
+  OLIVE_TEST_END;
+}
+
+OLIVE_ADD_TEST(ScanSkipsGapLeftByFailedAppend)
+{
+  QTemporaryDir dir;
+  OLIVE_ASSERT(dir.isValid());
+
+  QString fn = FramePackFile::GetPackFilename(dir.path(), 0);
+
+  OLIVE_ASSERT(FramePackFile::Append(fn, 0, QByteArrayLiteral("lost")));
+  OLIVE_ASSERT(FramePackFile::Append(fn, 1, QByteArrayLiteral("kept")));
+  FramePackFile::Forget(fn);
+
+  // Wipe the first record as if its append had failed after the second was already written
+  {
+    QFile f(fn);
+    OLIVE_ASSERT(f.open(QFile::ReadWrite));
+    OLIVE_ASSERT(f.write(QByteArray(32, 0)) == 32);
+  }
+
+  OLIVE_ASSERT(ReadPackFrame(fn, 0).isEmpty());
+  OLIVE_ASSERT(ReadPackFrame(fn, 1) == QByteArrayLiteral("kept"));
+
+  // Appends carry on after the last good record
+  OLIVE_ASSERT(FramePackFile::Append(fn, 2, QByteArrayLiteral("new")));
+  FramePackFile::Forget(fn);
+  OLIVE_ASSERT(ReadPackFrame(fn, 1) == QByteArrayLiteral("kept"));
+  OLIVE_ASSERT(ReadPackFrame(fn, 2) == QByteArrayLiteral("new"));
+
+  FramePackFile::Forget(fn);
+
+  OLIVE_TEST_END;
+}
+
+OLIVE_ADD_TEST(AppendToPackDeletedUnderneathIndex)
+{
+  QTemporaryDir dir;
+  OLIVE_ASSERT(dir.isValid());
+
+  QString fn = FramePackFile::GetPackFilename(dir.path(), 0);
+
+  OLIVE_ASSERT(FramePackFile::Append(fn, 0, QByteArrayLiteral("old")));
+
+  // Deleted before the DiskManager got to tell us, so the index still expects the old records
+  OLIVE_ASSERT(QFile::remove(fn));
+  OLIVE_ASSERT(FramePackFile::Append(fn, 1, QByteArrayLiteral("new")));
+
+  OLIVE_ASSERT(ReadPackFrame(fn, 0).isEmpty());
+  OLIVE_ASSERT(ReadPackFrame(fn, 1) == QByteArrayLiteral("new"));
+
+  // The record written after the hole must still be found once the pack is scanned again
+  FramePackFile::Forget(fn);
+  OLIVE_ASSERT(ReadPackFrame(fn, 0).isEmpty());
+  OLIVE_ASSERT(ReadPackFrame(fn, 1) == QByteArrayLiteral("new"));
+
+  FramePackFile::Forget(fn);
+
+  OLIVE_TEST_END;
+}
+
+OLIVE_ADD_TEST(FingerprintKnownAfterRescan)
+{
+  QTemporaryDir dir;
+  OLIVE_ASSERT(dir.isValid());
+
+  QString target_fn = FramePackFile::GetPackFilename(dir.path(), 3);
+  QString ref_fn = FramePackFile::GetPackFilename(dir.path(), 40);
+
+  OLIVE_ASSERT(FramePackFile::Append(target_fn, 3, QByteArrayLiteral("frame"), QByteArrayLiteral("abc")));
+
+  // Storing the same timestamp again as a reference to itself is a no-op
+  OLIVE_ASSERT(FramePackFile::AppendReference(target_fn, 3, QByteArrayLiteral("abc")));
+
+  // As if this were a new session, the fingerprint comes back once the pack is scanned
+  FramePackFile::Forget(target_fn);
+  OLIVE_ASSERT(ReadPackFrame(target_fn, 3) == QByteArrayLiteral("frame"));
+
+  OLIVE_ASSERT(FramePackFile::AppendReference(ref_fn, 40, QByteArrayLiteral("abc")));
+  OLIVE_ASSERT(ReadPackFrame(ref_fn, 40) == QByteArrayLiteral("frame"));
+
+  FramePackFile::Forget(target_fn);
+  FramePackFile::Forget(ref_fn);
+
+  OLIVE_TEST_END;
+}
+
+OLIVE_ADD_TEST(ReferenceToRewrittenTargetIsBroken)
+{
+  QTemporaryDir dir;
+  OLIVE_ASSERT(dir.isValid());
+
+  QString target_fn = FramePackFile::GetPackFilename(dir.path(), 3);
+  QString ref_fn = FramePackFile::GetPackFilename(dir.path(), 40);
+
+  OLIVE_ASSERT(FramePackFile::Append(target_fn, 3, QByteArrayLiteral("frame"), QByteArrayLiteral("abc")));
+  OLIVE_ASSERT(FramePackFile::AppendReference(ref_fn, 40, QByteArrayLiteral("abc")));
+
+  // Target pack evicted and re-rendered with different content at the same place
+  OLIVE_ASSERT(QFile::remove(target_fn));
+  FramePackFile::Forget(target_fn);
+  OLIVE_ASSERT(FramePackFile::Append(target_fn, 3, QByteArrayLiteral("other"), QByteArrayLiteral("xyz")));
+
+  {
+    FramePackFile::Reader reader(ref_fn, 40);
+    OLIVE_ASSERT(!reader.IsValid());
+    OLIVE_ASSERT(reader.IsBrokenReference());
+  }
+
+  FramePackFile::Forget(target_fn);
+  FramePackFile::Forget(ref_fn);
+
+  OLIVE_TEST_END;
+}
+
+}
@@ -0,0 +1,115 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2022 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+#include "testutil.h"
+
+#include "render/previewaudiodevice.h"
+
+namespace olive {
+
+static QByteArray MakeAudio(qint64 length)
+{
+  QByteArray b(length, Qt::Uninitialized);
+
+  for (qint64 i=0; i<length; i++) {
+    b[i] = char(i * 7 + i / 251);
+  }
+
+  return b;
+}
+
+static QByteArray PullAll(PreviewAudioDevice &device, qint64 chunk)
+{
+  QByteArray out;
+  QByteArray buf(chunk, Qt::Uninitialized);
+
+  forever {
+    qint64 r = device.PullSamples(buf.data(), chunk);
+    if (r <= 0) {
+      break;
+    }
+    out.append(buf.constData(), r);
+  }
+
+  return out;
+}
+
+OLIVE_ADD_TEST(OverflowIsQueuedNotDropped)
+{
+  PreviewAudioDevice device;
+  device.SetParams(AudioParams(48000, AV_CH_LAYOUT_STEREO, AudioParams::kFormatFloat32Packed));
+
+  // Far more than two seconds of audio, so the ring has to hold some of it back
+  QByteArray audio = MakeAudio(48000 * 8 * 5);
+  OLIVE_ASSERT_EQUAL(device.PushSamples(audio.constData(), audio.size()), qint64(audio.size()));
+
+  QByteArray played;
+
+  // Playback frees up space, and the producer refills from what it held back
+  forever {
+    QByteArray pulled = PullAll(device, 4096);
+    if (pulled.isEmpty()) {
+      break;
+    }
+    played.append(pulled);
+    device.PushSamples(nullptr, 0);
+  }
+
+  OLIVE_ASSERT(played == audio);
+
+  OLIVE_TEST_END;
+}
+
+OLIVE_ADD_TEST(PullNeverSplitsFrame)
+{
+  PreviewAudioDevice device;
+  device.SetParams(AudioParams(48000, AV_CH_LAYOUT_STEREO, AudioParams::kFormatFloat32Packed));
+
+  QByteArray audio = MakeAudio(8 * 10 + 5);
+  device.PushSamples(audio.constData(), audio.size());
+
+  char buf[64];
+  OLIVE_ASSERT_EQUAL(device.PullSamples(buf, 13), qint64(8));
+  OLIVE_ASSERT(QByteArray(buf, 8) == audio.left(8));
+
+  OLIVE_TEST_END;
+}
+
+OLIVE_ADD_TEST(ClearDiscardsQueuedAudio)
+{
+  PreviewAudioDevice device;
+  device.SetParams(AudioParams(48000, AV_CH_LAYOUT_STEREO, AudioParams::kFormatFloat32Packed));
+
+  QByteArray old_audio = MakeAudio(48000 * 8 * 3);
+  device.PushSamples(old_audio.constData(), old_audio.size());
+
+  device.clear();
+
+  char buf[64];
+  OLIVE_ASSERT_EQUAL(device.PullSamples(buf, sizeof(buf)), qint64(0));
+
+  // Held back audio must not resurface after a clear either
+  QByteArray new_audio = QByteArray(800, 'x');
+  device.PushSamples(new_audio.constData(), new_audio.size());
+  OLIVE_ASSERT(PullAll(device, 64) == new_audio);
+
+  OLIVE_TEST_END;
+}
+
+}